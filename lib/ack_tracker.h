@@ -35,6 +35,10 @@ struct _AckTracker
   Bookmark *(*request_bookmark)(AckTracker *self);
   void (*track_msg)(AckTracker *self, LogMessage *msg);
   void (*manage_msg_ack)(AckTracker *self, LogMessage *msg, AckType ack_type);
+  /* optional, called by log_source_init() and log_source_deinit() in the
+   * main thread, deinit persists whatever position information is pending */
+  void (*init)(AckTracker *self);
+  void (*deinit)(AckTracker *self);
 };
 
 struct _AckRecord
@@ -78,6 +82,20 @@ ack_tracker_track_msg(AckTracker *self, LogMessage *msg)
   self->track_msg(self, msg);
 }
 
+static inline void
+ack_tracker_init(AckTracker *self)
+{
+  if (self->init)
+    self->init(self);
+}
+
+static inline void
+ack_tracker_deinit(AckTracker *self)
+{
+  if (self->deinit)
+    self->deinit(self);
+}
+
 static inline void
 ack_tracker_manage_msg_ack(AckTracker *self, LogMessage *msg, AckType ack_type)
 {
@@ -26,9 +26,12 @@
 #include "messages.h"
 #include "children.h"
 #include "dnscache.h"
+#include "host-resolve.h"
 #include "alarms.h"
 #include "stats/stats-registry.h"
+#include "stats/stats-dynamic-cache.h"
 #include "logmsg/logmsg.h"
+#include "logmsg/logmsg-pool.h"
 #include "timeutils.h"
 #include "logsource.h"
 #include "logwriter.h"
@@ -195,6 +198,7 @@ app_shutdown(void)
   log_template_global_deinit();
   log_tags_global_deinit();
   log_msg_global_deinit();
+  nv_registry_thread_deinit();
 
   afinter_global_deinit();
   stats_destroy();
@@ -202,6 +206,7 @@ app_shutdown(void)
   g_list_foreach(application_hooks, (GFunc) g_free, NULL);
   g_list_free(application_hooks);
   dns_caching_thread_deinit();
+  host_resolve_global_deinit();
   dns_caching_global_deinit();
   hostname_global_deinit();
   crypto_deinit();
@@ -238,6 +243,9 @@ app_thread_start(void)
 void
 app_thread_stop(void)
 {
+  stats_dynamic_cache_thread_deinit();
+  nv_registry_thread_deinit();
+  log_msg_pool_thread_deinit();
   main_loop_call_thread_deinit();
   dns_caching_thread_deinit();
   scratch_buffers_allocator_deinit();
@@ -198,6 +198,7 @@ extern struct _StatsOptions *last_stats_options;
 %token KW_ENCODING                    10082
 %token KW_TYPE                        10083
 %token KW_STATS_MAX_DYNAMIC           10084
+%token KW_SEND_BUFFER_SIZE            10085
 
 %token KW_CHAIN_HOSTNAMES             10090
 %token KW_NORMALIZE_HOSTNAMES         10091
@@ -217,6 +218,7 @@ extern struct _StatsOptions *last_stats_options;
 %token KW_DNS_CACHE_EXPIRE            10130
 %token KW_DNS_CACHE_EXPIRE_FAILED     10131
 %token KW_DNS_CACHE_HOSTS             10132
+%token KW_DNS_CACHE_RESOLVE_TIMEOUT   10133
 
 %token KW_PERSIST_ONLY                10140
 %token KW_USE_RCPTID                  10141
@@ -240,6 +242,8 @@ extern struct _StatsOptions *last_stats_options;
 %token KW_PERSIST_NAME                10302
 
 %token KW_READ_OLD_RECORDS            10304
+%token KW_BOOKMARK_BATCH_SIZE         10305
+%token KW_BOOKMARK_BATCH_TIMEOUT      10306
 
 /* log statement options */
 %token KW_FLAGS                       10190
@@ -338,6 +342,12 @@ extern struct _StatsOptions *last_stats_options;
 
 %token KW_RETRIES                     10511
 
+%token KW_BATCH_LINES                 10512
+%token KW_BATCH_TIMEOUT               10513
+
+%token KW_PARALLELIZE                 10514
+%token KW_WORKERS                     10515
+
 /* END_DECLS */
 
 %code {
@@ -1001,6 +1011,8 @@ dns_cache_option
 	| KW_DNS_CACHE_EXPIRE_FAILED '(' positive_integer ')'
 	                                        { last_dns_cache_options->expire_failed = $3; }
 	| KW_DNS_CACHE_HOSTS '(' string ')'     { last_dns_cache_options->hosts = g_strdup($3); free($3); }
+	| KW_DNS_CACHE_RESOLVE_TIMEOUT '(' LL_NUMBER ')'
+	                                        { last_dns_cache_options->resolve_timeout = $3; }
         ;
 
 
@@ -1117,6 +1129,8 @@ source_option
 	| KW_LOG_PREFIX '(' string ')'	        { gchar *p = strrchr($3, ':'); if (p) *p = 0; last_source_options->program_override = g_strdup($3); free($3); }
 	| KW_KEEP_TIMESTAMP '(' yesno ')'	{ last_source_options->keep_timestamp = $3; }
 	| KW_READ_OLD_RECORDS '(' yesno ')'	{ last_source_options->read_old_records = $3; }
+	| KW_BOOKMARK_BATCH_SIZE '(' nonnegative_integer ')'	{ last_source_options->bookmark_batch_size = $3; }
+	| KW_BOOKMARK_BATCH_TIMEOUT '(' nonnegative_integer ')'	{ last_source_options->bookmark_batch_timeout = $3; }
         | KW_TAGS '(' string_list ')'		{ log_source_options_set_tags(last_source_options, $3); }
         | { last_host_resolve_options = &last_source_options->host_resolve_options; } host_resolve_option
         | driver_option
@@ -1169,11 +1183,24 @@ source_reader_option
 	| KW_FLAGS '(' source_reader_option_flags ')'
 	| KW_LOG_FETCH_LIMIT '(' positive_integer ')'	{ last_reader_options->fetch_limit = $3; }
         | KW_FORMAT '(' string ')'              { last_reader_options->parse_options.format = g_strdup($3); free($3); }
+	| KW_PARALLELIZE
+	  { cfg_lexer_push_context(lexer, cfg_lexer_get_context_type(lexer), parallelize_keywords, "parallelize options"); }
+	  '(' source_reader_parallelize_options ')'
+	  { cfg_lexer_pop_context(lexer); }
         | { last_source_options = &last_reader_options->super; } source_option
         | { last_proto_server_options = &last_reader_options->proto_options.super; } source_proto_option
         | { last_msg_format_options = &last_reader_options->parse_options; } msg_format_option
 	;
 
+source_reader_parallelize_options
+	: source_reader_parallelize_option source_reader_parallelize_options
+	|
+	;
+
+source_reader_parallelize_option
+	: KW_WORKERS '(' nonnegative_integer ')'	{ last_reader_options->parallelize_workers = $3; }
+	;
+
 source_reader_option_flags
         : string source_reader_option_flags     { CHECK_ERROR(log_reader_options_process_flag(last_reader_options, $1), @1, "Unknown flag %s", $1); free($1); }
         | KW_CHECK_HOSTNAME source_reader_option_flags     { log_reader_options_process_flag(last_reader_options, "check-hostname"); }
@@ -1189,6 +1216,15 @@ threaded_dest_driver_option
         {
           log_threaded_dest_driver_set_max_retries(last_driver, $3);
         }
+	| KW_BATCH_LINES '(' nonnegative_integer ')'
+        {
+          log_threaded_dest_driver_set_batch_lines(last_driver, $3);
+        }
+	| KW_BATCH_TIMEOUT '(' nonnegative_integer ')'
+        {
+          log_threaded_dest_driver_set_batch_timeout(last_driver, $3);
+        }
+	;
 
 dest_driver_option
         /* NOTE: plugins need to set "last_driver" in order to incorporate this rule in their grammar */
@@ -1248,6 +1284,18 @@ dest_writer_option
         | { last_template_options = &last_writer_options->template_options; } template_option
 	;
 
+/* options of LogWriter based destinations that talk to a stream
+ * (socket/pipe/program) through the text or framed LogProtoClient */
+dest_writer_stream_option
+        /* NOTE: plugins need to set "last_writer_options" in order to incorporate this rule in their grammar */
+
+	: { last_proto_client_options = &last_writer_options->proto_options.super; } dest_proto_option
+	;
+
+dest_proto_option
+	: KW_SEND_BUFFER_SIZE '(' nonnegative_integer ')'	{ last_proto_client_options->send_buffer_size = $3; }
+	;
+
 dest_writer_options_flags
 	: string dest_writer_options_flags      { $$ = log_writer_options_lookup_flag($1) | $2; free($1); }
 	|					{ $$ = 0; }
@@ -130,6 +130,7 @@ static CfgLexerKeyword main_keywords[] =
   { "log_fetch_limit",    KW_LOG_FETCH_LIMIT },
   { "log_iw_size",        KW_LOG_IW_SIZE },
   { "log_msg_size",       KW_LOG_MSG_SIZE },
+  { "send_buffer_size",   KW_SEND_BUFFER_SIZE },
   { "log_prefix",         KW_LOG_PREFIX, KWS_OBSOLETE, "program_override" },
   { "program_override",   KW_PROGRAM_OVERRIDE },
   { "host_override",      KW_HOST_OVERRIDE },
@@ -154,12 +155,18 @@ static CfgLexerKeyword main_keywords[] =
   { "dns_cache_size",     KW_DNS_CACHE_SIZE },
   { "dns_cache_expire",   KW_DNS_CACHE_EXPIRE },
   { "dns_cache_expire_failed", KW_DNS_CACHE_EXPIRE_FAILED },
+  { "dns_cache_resolve_timeout", KW_DNS_CACHE_RESOLVE_TIMEOUT },
   { "pass_unix_credentials",   KW_PASS_UNIX_CREDENTIALS },
   { "persist_name",            KW_PERSIST_NAME, VERSION_VALUE_3_8 },
 
   { "retries",            KW_RETRIES },
+  { "batch_lines",        KW_BATCH_LINES },
+  { "batch_timeout",      KW_BATCH_TIMEOUT },
+  { "parallelize",        KW_PARALLELIZE },
 
   { "read_old_records",   KW_READ_OLD_RECORDS},
+  { "bookmark_batch_size", KW_BOOKMARK_BATCH_SIZE },
+  { "bookmark_batch_timeout", KW_BOOKMARK_BATCH_TIMEOUT },
   /* filter items */
   { "type",               KW_TYPE },
   { "tags",               KW_TAGS },
@@ -172,6 +179,13 @@ static CfgLexerKeyword main_keywords[] =
   { NULL, 0 }
 };
 
+/* only recognized within parallelize(), so they don't collide with
+ * identifiers elsewhere */
+CfgLexerKeyword parallelize_keywords[] =
+{
+  { "workers",            KW_WORKERS },
+  { NULL, 0 }
+};
 
 CfgParser main_parser =
 {
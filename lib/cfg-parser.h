@@ -70,6 +70,7 @@ gboolean cfg_process_yesno(const gchar *yesno);
 
 
 extern CfgParser main_parser;
+extern CfgLexerKeyword parallelize_keywords[];
 
 #define CFG_PARSER_DECLARE_LEXER_BINDING(parser_prefix, root_type)             \
     int                                                                        \
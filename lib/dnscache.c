@@ -143,6 +143,20 @@ dns_cache_fill_key(DNSCacheKey *key, gint family, void *addr)
     }
 }
 
+/* drop the oldest dynamic entries until the cache fits into cache_size */
+static void
+dns_cache_enforce_size(DNSCache *self)
+{
+  /* persistent elements are not counted */
+  while ((gint) (g_hash_table_size(self->cache) - self->persistent_count) > self->options->cache_size)
+    {
+      DNSCacheEntry *entry_to_remove = iv_list_entry(self->cache_list.next, DNSCacheEntry, list);
+
+      /* remove oldest element */
+      g_hash_table_remove(self->cache, &entry_to_remove->key);
+    }
+}
+
 static void
 dns_cache_store(DNSCache *self, gboolean persistent, gint family, void *addr, const gchar *hostname, gboolean positive)
 {
@@ -172,14 +186,7 @@ dns_cache_store(DNSCache *self, gboolean persistent, gint family, void *addr, co
   if (persistent && hash_size != g_hash_table_size(self->cache))
     self->persistent_count++;
 
-  /* persistent elements are not counted */
-  if ((gint) (g_hash_table_size(self->cache) - self->persistent_count) > self->options->cache_size)
-    {
-      DNSCacheEntry *entry_to_remove = iv_list_entry(self->cache_list.next, DNSCacheEntry, list);
-
-      /* remove oldest element */
-      g_hash_table_remove(self->cache, &entry_to_remove->key);
-    }
+  dns_cache_enforce_size(self);
 }
 
 void
@@ -286,6 +293,29 @@ dns_cache_check_hosts(DNSCache *self, glong t)
     }
 }
 
+static DNSCacheEntry *
+dns_cache_lookup_entry(DNSCache *self, gint family, void *addr)
+{
+  DNSCacheKey key;
+  DNSCacheEntry *entry;
+  time_t now;
+
+  now = cached_g_current_time_sec();
+  dns_cache_check_hosts(self, now);
+
+  dns_cache_fill_key(&key, family, addr);
+  entry = g_hash_table_lookup(self->cache, &key);
+  if (entry &&
+      entry->resolved &&
+      ((entry->positive && entry->resolved < now - self->options->expire) ||
+       (!entry->positive && entry->resolved < now - self->options->expire_failed)))
+    {
+      /* the entry is not persistent and is too old */
+      return NULL;
+    }
+  return entry;
+}
+
 /*
  * @hostname        is set to the stored hostname,
  * @positive        is set whether the match was a DNS match or failure
@@ -297,36 +327,39 @@ gboolean
 dns_cache_lookup(DNSCache *self, gint family, void *addr, const gchar **hostname, gsize *hostname_len,
                  gboolean *positive)
 {
-  DNSCacheKey key;
-  DNSCacheEntry *entry;
-  time_t now;
+  DNSCacheEntry *entry = dns_cache_lookup_entry(self, family, addr);
 
-  now = cached_g_current_time_sec();
-  dns_cache_check_hosts(self, now);
-
-  dns_cache_fill_key(&key, family, addr);
-  entry = g_hash_table_lookup(self->cache, &key);
   if (entry)
     {
-      if (entry->resolved &&
-          ((entry->positive && entry->resolved < now - self->options->expire) ||
-           (!entry->positive && entry->resolved < now - self->options->expire_failed)))
-        {
-          /* the entry is not persistent and is too old */
-        }
-      else
-        {
-          *hostname = entry->hostname;
-          *hostname_len = entry->hostname_len;
-          *positive = entry->positive;
-          return TRUE;
-        }
+      *hostname = entry->hostname;
+      *hostname_len = entry->hostname_len;
+      *positive = entry->positive;
+      return TRUE;
     }
   *hostname = NULL;
   *positive = FALSE;
   return FALSE;
 }
 
+/* copy a dynamic entry from @src, keeping its original resolution time */
+static gboolean
+dns_cache_copy_entry(DNSCache *self, DNSCache *src, gint family, void *addr)
+{
+  DNSCacheEntry *src_entry, *entry;
+  DNSCacheKey key;
+
+  src_entry = dns_cache_lookup_entry(src, family, addr);
+  if (!src_entry || !src_entry->resolved)
+    return FALSE;
+
+  dns_cache_store_dynamic(self, family, addr, src_entry->hostname, src_entry->positive);
+
+  dns_cache_fill_key(&key, family, addr);
+  entry = g_hash_table_lookup(self->cache, &key);
+  entry->resolved = src_entry->resolved;
+  return TRUE;
+}
+
 DNSCache *
 dns_cache_new(const DNSCacheOptions *options)
 {
@@ -356,6 +389,7 @@ dns_cache_options_defaults(DNSCacheOptions *options)
   options->cache_size = 1007;
   options->expire = 3600;
   options->expire_failed = 60;
+  options->resolve_timeout = -1;
   options->hosts = NULL;
 }
 
@@ -414,15 +448,33 @@ TLS_BLOCK_END;
  * layer above GlobalConfig, a state that encapsulates per-execution state
  * of syslog-ng), however, right now that would be an overkill and I want to
  * get the DNSCache refactors into the master tree.
+ *
+ * The per-thread caches are backed by a process-wide shared cache,
+ * protected by a lock.  A miss in the per-thread cache is looked up in
+ * the shared one, so a name resolved by one thread (or by the resolver
+ * threads in host-resolve.c) is not resolved again by all the others.
  */
 
 static DNSCacheOptions effective_dns_cache_options;
 G_LOCK_DEFINE_STATIC(unused_dns_caches);
 static GList *unused_dns_caches;
+G_LOCK_DEFINE_STATIC(shared_dns_cache);
+static DNSCache *shared_dns_cache;
 
 gboolean
 dns_caching_lookup(gint family, void *addr, const gchar **hostname, gsize *hostname_len, gboolean *positive)
 {
+  gboolean found;
+
+  if (dns_cache_lookup(dns_cache, family, addr, hostname, hostname_len, positive))
+    return TRUE;
+
+  G_LOCK(shared_dns_cache);
+  found = dns_cache_copy_entry(dns_cache, shared_dns_cache, family, addr);
+  G_UNLOCK(shared_dns_cache);
+
+  if (!found)
+    return FALSE;
   return dns_cache_lookup(dns_cache, family, addr, hostname, hostname_len, positive);
 }
 
@@ -430,6 +482,22 @@ void
 dns_caching_store(gint family, void *addr, const gchar *hostname, gboolean positive)
 {
   dns_cache_store_dynamic(dns_cache, family, addr, hostname, positive);
+  dns_caching_store_shared(family, addr, hostname, positive);
+}
+
+/* can be called from any thread, even without dns_caching_thread_init() */
+void
+dns_caching_store_shared(gint family, void *addr, const gchar *hostname, gboolean positive)
+{
+  G_LOCK(shared_dns_cache);
+  dns_cache_store_dynamic(shared_dns_cache, family, addr, hostname, positive);
+  G_UNLOCK(shared_dns_cache);
+}
+
+gint
+dns_caching_get_resolve_timeout(void)
+{
+  return effective_dns_cache_options.resolve_timeout;
 }
 
 void
@@ -437,13 +505,21 @@ dns_caching_update_options(const DNSCacheOptions *new_options)
 {
   DNSCacheOptions *options = &effective_dns_cache_options;
 
+  /* the resolver threads use the options of the shared cache concurrently */
+  G_LOCK(shared_dns_cache);
   if (options->hosts)
     g_free(options->hosts);
 
   options->cache_size = new_options->cache_size;
   options->expire = new_options->expire;
   options->expire_failed = new_options->expire_failed;
+  options->resolve_timeout = new_options->resolve_timeout;
   options->hosts = g_strdup(new_options->hosts);
+
+  /* the per-thread caches shrink on their next store, the shared one may
+   * not see one for a while */
+  dns_cache_enforce_size(shared_dns_cache);
+  G_UNLOCK(shared_dns_cache);
 }
 
 void
@@ -478,6 +554,7 @@ void
 dns_caching_global_init(void)
 {
   dns_cache_options_defaults(&effective_dns_cache_options);
+  shared_dns_cache = dns_cache_new(&effective_dns_cache_options);
 }
 
 void
@@ -488,5 +565,9 @@ dns_caching_global_deinit(void)
   g_list_free(unused_dns_caches);
   unused_dns_caches = NULL;
   G_UNLOCK(unused_dns_caches);
+  G_LOCK(shared_dns_cache);
+  dns_cache_free(shared_dns_cache);
+  shared_dns_cache = NULL;
+  G_UNLOCK(shared_dns_cache);
   dns_cache_options_destroy(&effective_dns_cache_options);
 }
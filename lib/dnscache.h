@@ -33,6 +33,8 @@ typedef struct
   gint cache_size;
   gint expire;
   gint expire_failed;
+  /* msecs to wait for the resolver threads, -1 (default) to resolve synchronously */
+  gint resolve_timeout;
   gchar *hosts;
 } DNSCacheOptions;
 
@@ -50,6 +52,8 @@ void dns_cache_options_destroy(DNSCacheOptions *options);
 
 gboolean dns_caching_lookup(gint family, void *addr, const gchar **hostname, gsize *hostname_len, gboolean *positive);
 void dns_caching_store(gint family, void *addr, const gchar *hostname, gboolean positive);
+void dns_caching_store_shared(gint family, void *addr, const gchar *hostname, gboolean positive);
+gint dns_caching_get_resolve_timeout(void);
 void dns_caching_update_options(const DNSCacheOptions *dns_cache_options);
 
 void dns_caching_thread_init(void);
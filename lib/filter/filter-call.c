@@ -86,6 +86,8 @@ filter_call_init(FilterExprNode *s, GlobalConfig *cfg)
       stats_cluster_logpipe_key_set(&sc_key, SCS_FILTER, self->rule, NULL );
       stats_register_counter(1, &sc_key, SC_TYPE_MATCHED, &self->super.matched);
       stats_register_counter(1, &sc_key, SC_TYPE_NOT_MATCHED, &self->super.not_matched);
+      stats_counter_enable_sharding(self->super.matched);
+      stats_counter_enable_sharding(self->super.not_matched);
       stats_unlock();
     }
   else
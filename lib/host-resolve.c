@@ -302,6 +302,180 @@ sockaddr_to_dnscache_key(GSockAddr *saddr)
     }
 }
 
+static const gchar *
+resolve_address(GSockAddr *saddr, gchar *buf, gsize buf_len)
+{
+#ifdef SYSLOG_NG_HAVE_GETNAMEINFO
+  return resolve_address_using_getnameinfo(saddr, buf, buf_len);
+#else
+  return resolve_address_using_gethostbyaddr(saddr, buf, buf_len);
+#endif
+}
+
+/****************************************************************************
+ * Resolver threads
+ *
+ * When the DNS cache is enabled and dns-cache-resolve-timeout() is set,
+ * reverse lookups are performed by a pool of resolver threads instead of
+ * the thread processing the message.  The caller waits for the result at
+ * most dns-cache-resolve-timeout() milliseconds (0 means not at all), after
+ * that the message gets the IP address and the lookup continues in the
+ * background.  Once it finishes, the result is stored in the shared DNS
+ * cache, so subsequent messages from the same host get the resolved name,
+ * without any of the input threads being blocked by a slow DNS server.
+ * Concurrent lookups of the same address are merged into a single request.
+ *
+ * By default (-1) the lookup is performed synchronously, as before.
+ ****************************************************************************/
+
+#define RESOLVER_THREADS_MAX 4
+
+typedef struct _HostResolveRequest
+{
+  gint ref_cnt;
+  gchar *key;
+  GSockAddr *saddr;
+  gboolean done;
+  gboolean positive;
+  gchar hostname[256];
+} HostResolveRequest;
+
+static GStaticMutex resolver_lock = G_STATIC_MUTEX_INIT;
+static GCond *resolver_cond;
+static GThreadPool *resolver_pool;
+static GHashTable *pending_requests;
+
+static void
+host_resolve_request_unref(HostResolveRequest *self)
+{
+  if (--self->ref_cnt == 0)
+    {
+      g_sockaddr_unref(self->saddr);
+      g_free(self->key);
+      g_free(self);
+    }
+}
+
+static void
+_resolver_thread_func(gpointer data, gpointer user_data)
+{
+  HostResolveRequest *request = (HostResolveRequest *) data;
+  gchar buf[256];
+  const gchar *hname;
+  gboolean positive;
+  void *dnscache_key;
+
+  hname = resolve_address(request->saddr, buf, sizeof(buf));
+  positive = (hname != NULL);
+  if (!hname)
+    hname = g_sockaddr_format(request->saddr, buf, sizeof(buf), GSA_ADDRESS_ONLY);
+
+  dnscache_key = sockaddr_to_dnscache_key(request->saddr);
+  if (dnscache_key)
+    dns_caching_store_shared(request->saddr->sa.sa_family, dnscache_key, hname, positive);
+
+  g_static_mutex_lock(&resolver_lock);
+  g_strlcpy(request->hostname, hname, sizeof(request->hostname));
+  request->positive = positive;
+  request->done = TRUE;
+  g_hash_table_remove(pending_requests, request->key);
+  g_cond_broadcast(resolver_cond);
+  host_resolve_request_unref(request);
+  g_static_mutex_unlock(&resolver_lock);
+}
+
+/* must be called with resolver_lock held */
+static HostResolveRequest *
+_submit_request(GSockAddr *saddr)
+{
+  HostResolveRequest *request;
+  gchar key[MAX_SOCKADDR_STRING];
+
+  if (!resolver_pool)
+    {
+      resolver_cond = g_cond_new();
+      pending_requests = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                                               (GDestroyNotify) host_resolve_request_unref);
+      resolver_pool = g_thread_pool_new(_resolver_thread_func, NULL, RESOLVER_THREADS_MAX, FALSE, NULL);
+    }
+
+  g_sockaddr_format(saddr, key, sizeof(key), GSA_ADDRESS_ONLY);
+  request = g_hash_table_lookup(pending_requests, key);
+  if (!request)
+    {
+      request = g_new0(HostResolveRequest, 1);
+      request->key = g_strdup(key);
+      request->saddr = g_sockaddr_ref(saddr);
+      /* one ref for pending_requests, one for the resolver thread */
+      request->ref_cnt = 2;
+      g_hash_table_insert(pending_requests, request->key, request);
+      g_thread_pool_push(resolver_pool, request, NULL);
+    }
+  request->ref_cnt++;
+  return request;
+}
+
+/*
+ * Returns TRUE if the lookup has finished (either successfully or not)
+ * within @timeout milliseconds, in which case *hname is set to the
+ * resolved name or NULL.
+ */
+static gboolean
+resolve_address_using_resolver_threads(GSockAddr *saddr, gchar *buf, gsize buf_len, gint timeout,
+                                       const gchar **hname)
+{
+  HostResolveRequest *request;
+  GTimeVal end_time;
+  gboolean done;
+
+  g_get_current_time(&end_time);
+  g_time_val_add(&end_time, timeout * 1000);
+
+  g_static_mutex_lock(&resolver_lock);
+  request = _submit_request(saddr);
+  while (!request->done && timeout > 0)
+    {
+      if (!g_cond_timed_wait(resolver_cond, g_static_mutex_get_mutex(&resolver_lock), &end_time))
+        break;
+    }
+
+  done = request->done;
+  *hname = NULL;
+  if (done && request->positive)
+    {
+      g_strlcpy(buf, request->hostname, buf_len);
+      *hname = buf;
+    }
+  host_resolve_request_unref(request);
+  g_static_mutex_unlock(&resolver_lock);
+  return done;
+}
+
+static void
+_drop_queued_request(gpointer key, gpointer value, gpointer user_data)
+{
+  /* the reference the resolver thread would have released */
+  host_resolve_request_unref((HostResolveRequest *) value);
+}
+
+void
+host_resolve_global_deinit(void)
+{
+  if (!resolver_pool)
+    return;
+
+  /* drop queued lookups, but wait for the ones in progress.  Finished
+   * requests remove themselves from pending_requests, so whatever remains
+   * there was never picked up by a resolver thread. */
+  g_thread_pool_free(resolver_pool, TRUE, TRUE);
+  resolver_pool = NULL;
+  g_hash_table_foreach(pending_requests, _drop_queued_request, NULL);
+  g_hash_table_destroy(pending_requests);
+  pending_requests = NULL;
+  g_cond_free(resolver_cond);
+  resolver_cond = NULL;
+}
+
 static const gchar *
 resolve_sockaddr_to_inet_or_inet6_hostname(gsize *result_len, GSockAddr *saddr,
                                            const HostResolveOptions *host_resolve_options)
@@ -311,6 +485,8 @@ resolve_sockaddr_to_inet_or_inet6_hostname(gsize *result_len, GSockAddr *saddr,
   gboolean positive;
   void *dnscache_key;
 
+  gboolean cacheable = TRUE;
+
   dnscache_key = sockaddr_to_dnscache_key(saddr);
 
   hname = NULL;
@@ -324,11 +500,19 @@ resolve_sockaddr_to_inet_or_inet6_hostname(gsize *result_len, GSockAddr *saddr,
 
   if (!hname && host_resolve_options->use_dns && host_resolve_options->use_dns != 2)
     {
-#ifdef SYSLOG_NG_HAVE_GETNAMEINFO
-      hname = resolve_address_using_getnameinfo(saddr, hostname_buffer, sizeof(hostname_buffer));
-#else
-      hname = resolve_address_using_gethostbyaddr(saddr, hostname_buffer, sizeof(hostname_buffer));
-#endif
+      gint resolve_timeout = dns_caching_get_resolve_timeout();
+
+      if (host_resolve_options->use_dns_cache && dnscache_key && resolve_timeout >= 0)
+        {
+          /* the resolver thread stores the result in the shared cache once
+           * finished, a timed out lookup must not be cached as a failure */
+          cacheable = resolve_address_using_resolver_threads(saddr, hostname_buffer, sizeof(hostname_buffer),
+                                                             resolve_timeout, &hname);
+        }
+      else
+        {
+          hname = resolve_address(saddr, hostname_buffer, sizeof(hostname_buffer));
+        }
       positive = (hname != NULL);
     }
 
@@ -337,7 +521,7 @@ resolve_sockaddr_to_inet_or_inet6_hostname(gsize *result_len, GSockAddr *saddr,
       hname = g_sockaddr_format(saddr, hostname_buffer, sizeof(hostname_buffer), GSA_ADDRESS_ONLY);
       positive = FALSE;
     }
-  if (host_resolve_options->use_dns_cache)
+  if (host_resolve_options->use_dns_cache && cacheable)
     dns_caching_store(saddr->sa.sa_family, dnscache_key, hname, positive);
 
   return hostname_apply_options_fqdn(-1, result_len, hname, positive, host_resolve_options);
@@ -46,4 +46,6 @@ void host_resolve_options_init_globals(HostResolveOptions *options);
 void host_resolve_options_init(HostResolveOptions *options, HostResolveOptions *global_options);
 void host_resolve_options_destroy(HostResolveOptions *options);
 
+void host_resolve_global_deinit(void);
+
 #endif
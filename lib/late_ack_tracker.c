@@ -26,6 +26,10 @@
 #include "bookmark.h"
 #include "ringbuffer.h"
 #include "syslog-ng.h"
+#include "timeutils.h"
+
+#include <iv.h>
+#include <iv_event.h>
 
 typedef struct _LateAckRecord
 {
@@ -40,6 +44,26 @@ typedef struct LateAckTracker
   LateAckRecord *pending_ack_record;
   RingBuffer ack_record_storage;
   GStaticMutex storage_mutex;
+
+  /* bookmark of the last acknowledged range, not saved yet */
+  Bookmark unsaved_bookmark;
+  guint32 unsaved_acks;
+  GTimeVal last_save;
+  gint bookmark_batch_size;
+  gint bookmark_batch_timeout;
+  /* between init and deinit; acks arriving at other times save their
+   * bookmark right away, while the persist state is still around */
+  gboolean running;
+
+  /* saves the bookmark left unsaved by the last acknowledgement once
+   * bookmark-batch-timeout() expires, so that idle sources persist their
+   * position too.  Acks arrive in any thread, they request the timer via
+   * save_timer_requested, both live in the main thread between init and
+   * deinit. */
+  struct iv_event save_timer_requested;
+  struct iv_timer save_timer;
+  gboolean save_timer_registered;
+  gboolean save_timer_pending;
 } LateAckTracker;
 
 static inline void
@@ -94,6 +118,104 @@ _drop_range(LateAckTracker *self, guint32 n)
   ring_buffer_drop(&self->ack_record_storage, n);
 }
 
+static gboolean
+_bookmark_save_is_due(LateAckTracker *self)
+{
+  GTimeVal now;
+
+  if (!self->running)
+    return TRUE;
+
+  if (self->bookmark_batch_size <= 0 && self->bookmark_batch_timeout <= 0)
+    return TRUE;
+
+  if (self->bookmark_batch_size > 0 && self->unsaved_acks >= self->bookmark_batch_size)
+    return TRUE;
+
+  if (self->bookmark_batch_timeout > 0)
+    {
+      cached_g_current_time(&now);
+      if (g_time_val_diff(&now, &self->last_save) / 1000 >= self->bookmark_batch_timeout)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+static void
+_save_unsaved_bookmark(LateAckTracker *self)
+{
+  Bookmark *bookmark = &self->unsaved_bookmark;
+
+  if (!bookmark->save)
+    return;
+
+  bookmark->save(bookmark);
+  if (bookmark->destroy)
+    bookmark->destroy(bookmark);
+  bookmark_init(bookmark);
+
+  self->unsaved_acks = 0;
+  cached_g_current_time(&self->last_save);
+}
+
+static void
+_request_save_timer(LateAckTracker *self)
+{
+  if (!self->save_timer_registered || self->save_timer_pending || !self->unsaved_bookmark.save)
+    return;
+
+  self->save_timer_pending = TRUE;
+  iv_event_post(&self->save_timer_requested);
+}
+
+static void
+_save_timer_expired(gpointer s)
+{
+  LateAckTracker *self = (LateAckTracker *) s;
+
+  _late_tracker_lock(self);
+  _save_unsaved_bookmark(self);
+  self->save_timer_pending = FALSE;
+  _late_tracker_unlock(self);
+}
+
+static void
+_arm_save_timer(gpointer s)
+{
+  LateAckTracker *self = (LateAckTracker *) s;
+  GTimeVal now;
+  glong elapsed_msec;
+
+  if (iv_timer_registered(&self->save_timer))
+    return;
+
+  _late_tracker_lock(self);
+  g_get_current_time(&now);
+  elapsed_msec = g_time_val_diff(&now, &self->last_save) / 1000;
+  _late_tracker_unlock(self);
+
+  iv_validate_now();
+  self->save_timer.expires = iv_now;
+  timespec_add_msec(&self->save_timer.expires, MAX(self->bookmark_batch_timeout - elapsed_msec, 0));
+  iv_timer_register(&self->save_timer);
+}
+
+/* takes over the bookmark of @ack_rec, superseding the one not saved yet */
+static void
+_update_unsaved_bookmark(LateAckTracker *self, LateAckRecord *ack_rec, guint32 acked)
+{
+  Bookmark *bookmark = &self->unsaved_bookmark;
+
+  if (bookmark->destroy)
+    bookmark->destroy(bookmark);
+
+  *bookmark = ack_rec->bookmark;
+  ack_rec->bookmark.save = NULL;
+  ack_rec->bookmark.destroy = NULL;
+
+  self->unsaved_acks += acked;
+}
+
 static void
 late_ack_tracker_track_msg(AckTracker *s, LogMessage *msg)
 {
@@ -135,8 +257,11 @@ late_ack_tracker_manage_msg_ack(AckTracker *s, LogMessage *msg, AckType ack_type
         last_in_range = ring_buffer_element_at(&self->ack_record_storage, ack_range_length - 1);
         if (ack_type != AT_ABORTED)
           {
-            Bookmark *bookmark = &(last_in_range->bookmark);
-            bookmark->save(bookmark);
+            _update_unsaved_bookmark(self, last_in_range, ack_range_length);
+            if (_bookmark_save_is_due(self))
+              _save_unsaved_bookmark(self);
+            else
+              _request_save_timer(self);
           }
         _drop_range(self, ack_range_length);
 
@@ -175,6 +300,55 @@ late_ack_tracker_request_bookmark(AckTracker *s)
   return NULL;
 }
 
+static void
+late_ack_tracker_init(AckTracker *s)
+{
+  LateAckTracker *self = (LateAckTracker *)s;
+
+  _late_tracker_lock(self);
+  self->running = TRUE;
+  _late_tracker_unlock(self);
+
+  if (self->bookmark_batch_timeout <= 0)
+    return;
+
+  IV_EVENT_INIT(&self->save_timer_requested);
+  self->save_timer_requested.cookie = self;
+  self->save_timer_requested.handler = _arm_save_timer;
+  iv_event_register(&self->save_timer_requested);
+
+  IV_TIMER_INIT(&self->save_timer);
+  self->save_timer.cookie = self;
+  self->save_timer.handler = _save_timer_expired;
+
+  _late_tracker_lock(self);
+  self->save_timer_registered = TRUE;
+  self->save_timer_pending = FALSE;
+  _request_save_timer(self);
+  _late_tracker_unlock(self);
+}
+
+static void
+late_ack_tracker_deinit(AckTracker *s)
+{
+  LateAckTracker *self = (LateAckTracker *)s;
+  gboolean save_timer_registered;
+
+  _late_tracker_lock(self);
+  save_timer_registered = self->save_timer_registered;
+  self->save_timer_registered = FALSE;
+  self->running = FALSE;
+  _save_unsaved_bookmark(self);
+  _late_tracker_unlock(self);
+
+  if (save_timer_registered)
+    {
+      iv_event_unregister(&self->save_timer_requested);
+      if (iv_timer_registered(&self->save_timer))
+        iv_timer_unregister(&self->save_timer);
+    }
+}
+
 static void
 late_ack_tracker_init_instance(LateAckTracker *self, LogSource *source)
 {
@@ -184,6 +358,12 @@ late_ack_tracker_init_instance(LateAckTracker *self, LogSource *source)
   self->super.request_bookmark = late_ack_tracker_request_bookmark;
   self->super.track_msg = late_ack_tracker_track_msg;
   self->super.manage_msg_ack = late_ack_tracker_manage_msg_ack;
+  self->super.init = late_ack_tracker_init;
+  self->super.deinit = late_ack_tracker_deinit;
+  self->bookmark_batch_size = source->options->bookmark_batch_size;
+  self->bookmark_batch_timeout = source->options->bookmark_batch_timeout;
+  bookmark_init(&self->unsaved_bookmark);
+  cached_g_current_time(&self->last_save);
   ring_buffer_alloc(&self->ack_record_storage, sizeof(LateAckRecord), log_source_get_init_window_size(source));
   g_static_mutex_init(&self->storage_mutex);
 }
@@ -206,6 +386,10 @@ late_ack_tracker_free(AckTracker *s)
 
   g_static_mutex_free(&self->storage_mutex);
 
+  /* the persist state may be freed already, the bookmarks are saved by
+   * deinit or by the acks themselves */
+  if (self->unsaved_bookmark.destroy)
+    self->unsaved_bookmark.destroy(&self->unsaved_bookmark);
   _drop_range(self, count);
 
   ring_buffer_free(&self->ack_record_storage);
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logmsg/logmsg-pool.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-cluster-single.h"
+#include "tls-support.h"
+
+/* each pool keeps at most this many bytes cached per size class */
+#define LOG_MSG_POOL_CLASS_BUDGET (1024 * 1024)
+#define LOG_MSG_POOL_NUM_CLASSES  7
+
+static const gsize log_msg_pool_class_sizes[LOG_MSG_POOL_NUM_CLASSES] =
+{
+  64, 512, 1024, 2048, 4096, 8192, 16384
+};
+
+typedef struct _LogMsgPool LogMsgPool;
+typedef struct _LogMsgPoolBlock LogMsgPoolBlock;
+
+/* precedes the memory returned to the caller, the size is a multiple of 8 */
+struct _LogMsgPoolBlock
+{
+  LogMsgPool *owner;
+  LogMsgPoolBlock *next;
+  gint32 size_class;
+  gint32 __padding;
+};
+
+typedef struct _LogMsgPoolFreeList
+{
+  LogMsgPoolBlock *head;
+  gint count;
+} LogMsgPoolFreeList;
+
+/*
+ * Pools are never freed: the pool of an exiting thread is orphaned and
+ * adopted by the next thread that needs one, so blocks may always be
+ * returned to their owner.
+ */
+struct _LogMsgPool
+{
+  LogMsgPoolFreeList local[LOG_MSG_POOL_NUM_CLASSES];
+
+  GStaticMutex return_lock;
+  LogMsgPoolFreeList returned[LOG_MSG_POOL_NUM_CLASSES];
+
+  LogMsgPool *next_orphan;
+};
+
+TLS_BLOCK_START
+{
+  LogMsgPool *msg_pool;
+}
+TLS_BLOCK_END;
+
+#define msg_pool  __tls_deref(msg_pool)
+
+static GStaticMutex orphaned_pools_lock = G_STATIC_MUTEX_INIT;
+static LogMsgPool *orphaned_pools;
+
+static StatsCounterItem *count_pool_hits;
+static StatsCounterItem *count_pool_misses;
+
+static inline gint
+_class_capacity(gint size_class)
+{
+  return LOG_MSG_POOL_CLASS_BUDGET / log_msg_pool_class_sizes[size_class];
+}
+
+static inline gint
+_lookup_size_class(gsize size)
+{
+  gint i;
+
+  for (i = 0; i < LOG_MSG_POOL_NUM_CLASSES; i++)
+    {
+      if (size <= log_msg_pool_class_sizes[i])
+        return i;
+    }
+  return -1;
+}
+
+static inline void
+_free_list_push(LogMsgPoolFreeList *list, LogMsgPoolBlock *block)
+{
+  block->next = list->head;
+  list->head = block;
+  list->count++;
+}
+
+static inline LogMsgPoolBlock *
+_free_list_pop(LogMsgPoolFreeList *list)
+{
+  LogMsgPoolBlock *block = list->head;
+
+  list->head = block->next;
+  list->count--;
+  return block;
+}
+
+static LogMsgPool *
+_get_thread_pool(void)
+{
+  LogMsgPool *pool = msg_pool;
+
+  if (pool)
+    return pool;
+
+  g_static_mutex_lock(&orphaned_pools_lock);
+  pool = orphaned_pools;
+  if (pool)
+    orphaned_pools = pool->next_orphan;
+  g_static_mutex_unlock(&orphaned_pools_lock);
+
+  if (!pool)
+    {
+      pool = g_new0(LogMsgPool, 1);
+      g_static_mutex_init(&pool->return_lock);
+    }
+  msg_pool = pool;
+  return pool;
+}
+
+/* moves the blocks freed by other threads to our local list */
+static void
+_reclaim_returned_blocks(LogMsgPool *pool, gint size_class)
+{
+  LogMsgPoolFreeList *returned = &pool->returned[size_class];
+  LogMsgPoolFreeList *local = &pool->local[size_class];
+
+  g_static_mutex_lock(&pool->return_lock);
+  while (returned->head)
+    _free_list_push(local, _free_list_pop(returned));
+  g_static_mutex_unlock(&pool->return_lock);
+}
+
+gpointer
+log_msg_pool_alloc(gsize size)
+{
+  gint size_class = _lookup_size_class(size + sizeof(LogMsgPoolBlock));
+  LogMsgPoolBlock *block;
+  LogMsgPool *pool;
+
+  if (size_class < 0)
+    {
+      block = g_malloc(size + sizeof(LogMsgPoolBlock));
+      block->owner = NULL;
+      block->size_class = -1;
+      stats_counter_inc(count_pool_misses);
+      return block + 1;
+    }
+
+  pool = _get_thread_pool();
+
+  /* unlocked peek, we'll find the returned blocks next time if we miss them */
+  if (!pool->local[size_class].head && pool->returned[size_class].head)
+    _reclaim_returned_blocks(pool, size_class);
+
+  if (pool->local[size_class].head)
+    {
+      block = _free_list_pop(&pool->local[size_class]);
+      stats_counter_inc(count_pool_hits);
+    }
+  else
+    {
+      block = g_malloc(log_msg_pool_class_sizes[size_class]);
+      block->owner = pool;
+      block->size_class = size_class;
+      stats_counter_inc(count_pool_misses);
+    }
+  return block + 1;
+}
+
+void
+log_msg_pool_free(gpointer p)
+{
+  LogMsgPoolBlock *block = ((LogMsgPoolBlock *) p) - 1;
+  LogMsgPool *owner = block->owner;
+  gint size_class = block->size_class;
+  gboolean cached = FALSE;
+
+  if (size_class < 0)
+    {
+      g_free(block);
+      return;
+    }
+
+  if (owner == msg_pool)
+    {
+      if (owner->local[size_class].count < _class_capacity(size_class))
+        {
+          _free_list_push(&owner->local[size_class], block);
+          cached = TRUE;
+        }
+    }
+  else
+    {
+      g_static_mutex_lock(&owner->return_lock);
+      if (owner->returned[size_class].count < _class_capacity(size_class))
+        {
+          _free_list_push(&owner->returned[size_class], block);
+          cached = TRUE;
+        }
+      g_static_mutex_unlock(&owner->return_lock);
+    }
+
+  if (!cached)
+    g_free(block);
+}
+
+void
+log_msg_pool_thread_deinit(void)
+{
+  LogMsgPool *pool = msg_pool;
+
+  if (!pool)
+    return;
+
+  g_static_mutex_lock(&orphaned_pools_lock);
+  pool->next_orphan = orphaned_pools;
+  orphaned_pools = pool;
+  g_static_mutex_unlock(&orphaned_pools_lock);
+  msg_pool = NULL;
+}
+
+void
+log_msg_pool_stats_init(void)
+{
+  StatsClusterKey sc_key;
+
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "msg_pool_hits", NULL);
+  stats_register_counter(1, &sc_key, SC_TYPE_SINGLE_VALUE, &count_pool_hits);
+  stats_counter_enable_sharding(count_pool_hits);
+
+  stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "msg_pool_misses", NULL);
+  stats_register_counter(1, &sc_key, SC_TYPE_SINGLE_VALUE, &count_pool_misses);
+  stats_counter_enable_sharding(count_pool_misses);
+}
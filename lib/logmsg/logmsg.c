@@ -23,6 +23,7 @@
  */
 
 #include "logmsg/logmsg.h"
+#include "logmsg/logmsg-pool.h"
 #include "str-utils.h"
 #include "str-repr/encode.h"
 #include "messages.h"
@@ -471,7 +472,7 @@ log_msg_alloc_queue_node(LogMessage *msg, const LogPathOptions *path_options)
        */
       if (nodes < 32 && nodes <= msg->num_nodes)
         logmsg_queue_node_max = msg->num_nodes + 1;
-      node = g_slice_new(LogMessageQueueNode);
+      node = log_msg_pool_alloc(sizeof(LogMessageQueueNode));
       node->embedded = FALSE;
     }
   log_msg_init_queue_node(msg, node, path_options);
@@ -482,7 +483,7 @@ LogMessageQueueNode *
 log_msg_alloc_dynamic_queue_node(LogMessage *msg, const LogPathOptions *path_options)
 {
   LogMessageQueueNode *node;
-  node = g_slice_new(LogMessageQueueNode);
+  node = log_msg_pool_alloc(sizeof(LogMessageQueueNode));
   node->embedded = FALSE;
   log_msg_init_queue_node(msg, node, path_options);
   return node;
@@ -492,7 +493,7 @@ void
 log_msg_free_queue_node(LogMessageQueueNode *node)
 {
   if (!node->embedded)
-    g_slice_free(LogMessageQueueNode, node);
+    log_msg_pool_free(node);
 }
 
 static gboolean
@@ -1149,7 +1150,7 @@ log_msg_alloc(gsize payload_size)
       payload_ofs = alloc_size;
       alloc_size += payload_space;
     }
-  msg = g_malloc(alloc_size);
+  msg = log_msg_pool_alloc(alloc_size);
 
   memset(msg, 0, sizeof(LogMessage));
 
@@ -1370,7 +1371,7 @@ log_msg_free(LogMessage *self)
 
   stats_counter_sub(count_allocated_bytes, self->allocated_bytes);
 
-  g_free(self);
+  log_msg_pool_free(self);
 }
 
 /**
@@ -1819,6 +1820,9 @@ log_msg_stats_global_init(void)
 
   stats_cluster_single_key_set(&sc_key, SCS_GLOBAL, "msg_allocated_bytes", NULL);
   stats_register_counter(1, &sc_key, SC_TYPE_SINGLE_VALUE, &count_allocated_bytes);
+  stats_counter_enable_sharding(count_allocated_bytes);
+
+  log_msg_pool_stats_init();
   stats_unlock();
 }
 
@@ -23,6 +23,8 @@
  */
 #include "logmsg/nvtable.h"
 #include "messages.h"
+#include "tls-support.h"
+#include "atomic.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -31,6 +33,67 @@ GStaticMutex nv_registry_lock = G_STATIC_MUTEX_INIT;
 
 const gchar *null_string = "";
 
+/*
+ * Per-thread handle lookup cache.
+ *
+ * Parsers and rewrite rules resolve names to handles for every message
+ * (e.g. dynamic names coming from kv-parser or json-parser), which used to
+ * take nv_registry_lock even when the name was registered a long time
+ * ago.  Handles are never released while the registry is alive, so a
+ * name -> handle mapping, once seen, can be cached by each thread and
+ * looked up without any locking.  The lock is only taken on a cache miss,
+ * which is either the first lookup of a name in the given thread or the
+ * allocation of a new name.
+ *
+ * The cache keys point to the strings owned by the registry's name_map,
+ * so the cache has to be dropped whenever the registry it was populated
+ * from goes away or changes an existing mapping (aliases).  This is
+ * tracked by a generation number, which is unique for each registry and
+ * is bumped by nv_registry_add_alias().
+ */
+static GAtomicCounter nv_registry_generation_counter;
+
+TLS_BLOCK_START
+{
+  GHashTable *handle_cache;
+  gint handle_cache_generation;
+}
+TLS_BLOCK_END;
+
+#define handle_cache  __tls_deref(handle_cache)
+#define handle_cache_generation  __tls_deref(handle_cache_generation)
+
+static gint
+_next_generation(void)
+{
+  return g_atomic_counter_exchange_and_add(&nv_registry_generation_counter, 1) + 1;
+}
+
+static inline GHashTable *
+_get_handle_cache(NVRegistry *self)
+{
+  gint generation = g_atomic_int_get(&self->generation);
+
+  if (G_UNLIKELY(handle_cache_generation != generation))
+    {
+      /* keys are not owned by the cache, so this does not touch them */
+      if (handle_cache)
+        g_hash_table_destroy(handle_cache);
+      handle_cache = g_hash_table_new(g_str_hash, g_str_equal);
+      handle_cache_generation = generation;
+    }
+  return handle_cache;
+}
+
+void
+nv_registry_thread_deinit(void)
+{
+  if (handle_cache)
+    g_hash_table_destroy(handle_cache);
+  handle_cache = NULL;
+  handle_cache_generation = 0;
+}
+
 NVHandle
 nv_registry_get_handle(NVRegistry *self, const gchar *name)
 {
@@ -45,16 +108,22 @@ nv_registry_get_handle(NVRegistry *self, const gchar *name)
 NVHandle
 nv_registry_alloc_handle(NVRegistry *self, const gchar *name)
 {
-  gpointer p;
+  GHashTable *cache;
+  gpointer p, stored_name;
   NVHandleDesc stored;
   gsize len;
   NVHandle res = 0;
 
-  g_static_mutex_lock(&nv_registry_lock);
-  p = g_hash_table_lookup(self->name_map, name);
+  cache = _get_handle_cache(self);
+  p = g_hash_table_lookup(cache, name);
   if (p)
+    return GPOINTER_TO_UINT(p);
+
+  g_static_mutex_lock(&nv_registry_lock);
+  if (g_hash_table_lookup_extended(self->name_map, name, &stored_name, &p))
     {
       res = GPOINTER_TO_UINT(p);
+      g_hash_table_insert(cache, stored_name, p);
       goto exit;
     }
 
@@ -87,6 +156,7 @@ nv_registry_alloc_handle(NVRegistry *self, const gchar *name)
   nvhandle_desc_array_append(self->names, &stored);
   g_hash_table_insert(self->name_map, stored.name, GUINT_TO_POINTER(self->names->len));
   res = self->names->len;
+  g_hash_table_insert(cache, stored.name, GUINT_TO_POINTER(res));
 exit:
   g_static_mutex_unlock(&nv_registry_lock);
   return res;
@@ -102,6 +172,8 @@ nv_registry_add_alias(NVRegistry *self, NVHandle handle, const gchar *alias)
 {
   g_static_mutex_lock(&nv_registry_lock);
   g_hash_table_insert(self->name_map, g_strdup(alias), GUINT_TO_POINTER((glong) handle));
+  /* an alias may remap an existing name, invalidate per-thread caches */
+  g_atomic_int_set(&self->generation, _next_generation());
   g_static_mutex_unlock(&nv_registry_lock);
 }
 
@@ -130,6 +202,7 @@ nv_registry_new(const gchar **static_names, guint32 nvhandle_max_value)
   gint i;
 
   self->nvhandle_max_value = nvhandle_max_value;
+  self->generation = _next_generation();
   self->name_map = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
   self->names = nvhandle_desc_array_new(NVHANDLE_DESC_ARRAY_INITIAL_SIZE);
   for (i = 0; static_names[i]; i++)
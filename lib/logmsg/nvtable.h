@@ -62,6 +62,8 @@ struct _NVRegistry
   NVHandleDescArray *names;
   GHashTable *name_map;
   guint32 nvhandle_max_value;
+  /* identifies the current state of name_map for per-thread lookup caches */
+  gint generation;
 };
 
 extern const gchar *null_string;
@@ -73,6 +75,7 @@ void nv_registry_set_handle_flags(NVRegistry *self, NVHandle handle, guint16 fla
 void nv_registry_foreach(NVRegistry *self, GHFunc callback, gpointer user_data);
 NVRegistry *nv_registry_new(const gchar **static_names, guint32 nvhandle_max_value);
 void nv_registry_free(NVRegistry *self);
+void nv_registry_thread_deinit(void);
 
 static inline guint16
 nv_registry_get_handle_flags(NVRegistry *self, NVHandle handle)
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logmsg/logmsg-pool.h"
+#include "apphook.h"
+
+#include <criterion/criterion.h>
+#include <string.h>
+
+static gpointer
+_free_block(gpointer block)
+{
+  log_msg_pool_free(block);
+  return NULL;
+}
+
+static gpointer
+_alloc_and_free_then_exit(gpointer user_data)
+{
+  gpointer *block = (gpointer *) user_data;
+
+  *block = log_msg_pool_alloc(1000);
+  log_msg_pool_free(*block);
+  log_msg_pool_thread_deinit();
+  return NULL;
+}
+
+static gpointer
+_alloc_block(gpointer user_data)
+{
+  return log_msg_pool_alloc(1000);
+}
+
+Test(logmsg_pool, freed_blocks_are_reused_by_the_same_thread)
+{
+  gpointer block = log_msg_pool_alloc(100);
+
+  memset(block, 'x', 100);
+  log_msg_pool_free(block);
+  cr_assert_eq(log_msg_pool_alloc(100), block);
+  log_msg_pool_free(block);
+}
+
+Test(logmsg_pool, blocks_freed_by_another_thread_are_returned_to_the_owner)
+{
+  gpointer block = log_msg_pool_alloc(3000);
+  GThread *thread;
+
+  thread = g_thread_create(_free_block, block, TRUE, NULL);
+  g_thread_join(thread);
+
+  cr_assert_eq(log_msg_pool_alloc(3000), block);
+  log_msg_pool_free(block);
+}
+
+Test(logmsg_pool, pool_of_an_exited_thread_is_adopted_by_a_new_thread)
+{
+  gpointer freed_block, block;
+  GThread *thread;
+
+  thread = g_thread_create(_alloc_and_free_then_exit, &freed_block, TRUE, NULL);
+  g_thread_join(thread);
+
+  thread = g_thread_create(_alloc_block, NULL, TRUE, NULL);
+  block = g_thread_join(thread);
+
+  cr_assert_eq(block, freed_block);
+  log_msg_pool_free(block);
+}
+
+Test(logmsg_pool, large_blocks_are_allocated_from_the_heap)
+{
+  gpointer block = log_msg_pool_alloc(1024 * 1024);
+
+  memset(block, 'x', 1024 * 1024);
+  log_msg_pool_free(block);
+}
+
+TestSuite(logmsg_pool, .init = app_startup, .fini = app_shutdown);
@@ -140,6 +140,29 @@ Test(nvtable, test_nv_registry)
   nv_registry_free(reg);
 }
 
+Test(nvtable, test_nv_registry_handle_cache_is_dropped_with_the_registry)
+{
+  NVRegistry *reg;
+  const gchar *builtins[] = { "BUILTIN1", NULL };
+  const gchar *other_builtins[] = { "BUILTIN2", "BUILTIN1", NULL };
+
+  reg = nv_registry_new(builtins, TEST_NVHANDLE_MAX_VALUE);
+  cr_assert_eq(nv_registry_alloc_handle(reg, "BUILTIN1"), 1);
+  cr_assert_eq(nv_registry_alloc_handle(reg, "DYN"), 2);
+  cr_assert_eq(nv_registry_alloc_handle(reg, "DYN"), 2);
+  nv_registry_free(reg);
+
+  /* the same names map to different handles in the new registry */
+  reg = nv_registry_new(other_builtins, TEST_NVHANDLE_MAX_VALUE);
+  cr_assert_eq(nv_registry_alloc_handle(reg, "BUILTIN1"), 2);
+  cr_assert_eq(nv_registry_alloc_handle(reg, "DYN"), 3);
+
+  /* remapping a cached name through an alias is visible right away */
+  nv_registry_add_alias(reg, 1, "DYN");
+  cr_assert_eq(nv_registry_alloc_handle(reg, "DYN"), 1);
+  nv_registry_free(reg);
+}
+
 /*
  *  - NVTable direct values
  *    - set/get static NV entries
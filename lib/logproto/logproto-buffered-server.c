@@ -550,7 +550,8 @@ log_proto_buffered_server_prepare(LogProtoServer *s, GIOCondition *cond)
   if (*cond == 0)
     *cond = G_IO_IN;
 
-  return FALSE;
+  /* datagrams already received by the transport would not wake up poll() */
+  return log_transport_has_buffered_data(self->super.transport);
 }
 
 static gint
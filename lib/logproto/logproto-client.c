@@ -61,6 +61,7 @@ log_proto_client_init(LogProtoClient *self, LogTransport *transport, const LogPr
 void
 log_proto_client_options_defaults(LogProtoClientOptions *options)
 {
+  options->send_buffer_size = 0;
 }
 
 void
@@ -34,6 +34,8 @@ typedef struct _LogProtoClient LogProtoClient;
 
 typedef struct _LogProtoClientOptions
 {
+  /* coalesce messages into writes of up to this many bytes, 0 disables buffering */
+  gint send_buffer_size;
 } LogProtoClientOptions;
 
 typedef union _LogProtoClientOptionsStorage
@@ -44,11 +46,14 @@ typedef union _LogProtoClientOptionsStorage
 
 typedef void (*LogProtoClientAckCallback)(gint num_msg_acked, gpointer user_data);
 typedef void (*LogProtoClientRewindCallback)(gpointer user_data);
+typedef void (*LogProtoClientWakeupCallback)(gpointer user_data);
 
 typedef struct
 {
   LogProtoClientAckCallback ack_callback;
   LogProtoClientRewindCallback rewind_callback;
+  /* runs in the main thread, asks for prepare() to be called again */
+  LogProtoClientWakeupCallback wakeup_callback;
   gpointer user_data;
 } LogProtoClientFlowControlFuncs;
 
@@ -68,6 +73,8 @@ struct _LogProtoClient
   gboolean (*validate_options)(LogProtoClient *s);
   gboolean (*handshake_in_progess)(LogProtoClient *s);
   LogProtoStatus (*handshake)(LogProtoClient *s);
+  /* optional, acks every message still held back by the proto (e.g. until it is synced) */
+  void (*ack_pending)(LogProtoClient *s);
   void (*free_fn)(LogProtoClient *s);
   LogProtoClientFlowControlFuncs flow_control_funcs;
 };
@@ -77,6 +84,7 @@ log_proto_client_set_client_flow_control(LogProtoClient *self, LogProtoClientFlo
 {
   self->flow_control_funcs.ack_callback = flow_control_funcs->ack_callback;
   self->flow_control_funcs.rewind_callback = flow_control_funcs->rewind_callback;
+  self->flow_control_funcs.wakeup_callback = flow_control_funcs->wakeup_callback;
   self->flow_control_funcs.user_data = flow_control_funcs->user_data;
 }
 static inline void
@@ -93,6 +101,13 @@ log_proto_client_msg_rewind(LogProtoClient *self)
     self->flow_control_funcs.rewind_callback(self->flow_control_funcs.user_data);
 }
 
+static inline void
+log_proto_client_wakeup(LogProtoClient *self)
+{
+  if (self->flow_control_funcs.wakeup_callback)
+    self->flow_control_funcs.wakeup_callback(self->flow_control_funcs.user_data);
+}
+
 static inline gboolean
 log_proto_client_validate_options(LogProtoClient *self)
 {
@@ -119,6 +134,17 @@ log_proto_client_handshake(LogProtoClient *s)
   return LPS_SUCCESS;
 }
 
+/*
+ * Called by the LogWriter before it stops using the proto (deinit,
+ * reopen), while its queue is still there to receive the acks.
+ */
+static inline void
+log_proto_client_ack_pending(LogProtoClient *s)
+{
+  if (s->ack_pending)
+    s->ack_pending(s);
+}
+
 static inline gboolean
 log_proto_client_prepare(LogProtoClient *s, gint *fd, GIOCondition *cond)
 {
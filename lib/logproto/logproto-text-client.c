@@ -37,13 +37,23 @@ log_proto_text_client_prepare(LogProtoClient *s, gint *fd, GIOCondition *cond)
   /* if there's no pending I/O in the transport layer, then we want to do a write */
   if (*cond == 0)
     *cond = G_IO_OUT;
-  return self->partial != NULL;
+  return self->partial != NULL || self->send_buffer_msgs > 0;
+}
+
+static void
+_start_send_buffer_write(LogProtoTextClient *self)
+{
+  self->partial = (guchar *) self->send_buffer->str;
+  self->partial_len = self->send_buffer->len;
+  self->partial_pos = 0;
+  self->partial_free = NULL;
+  self->partial_msgs = self->send_buffer_msgs;
+  self->send_buffer_msgs = 0;
 }
 
 static LogProtoStatus
-log_proto_text_client_flush(LogProtoClient *s)
+_flush_partial(LogProtoTextClient *self)
 {
-  LogProtoTextClient *self = (LogProtoTextClient *) s;
   gint rc;
 
   /* attempt to flush previously buffered data */
@@ -72,6 +82,8 @@ log_proto_text_client_flush(LogProtoClient *s)
         {
           if (self->partial_free)
             self->partial_free(self->partial);
+          else if (self->send_buffer && self->partial == (guchar *) self->send_buffer->str)
+            g_string_truncate(self->send_buffer, 0);
           self->partial = NULL;
           if (self->next_state >= 0)
             {
@@ -79,7 +91,7 @@ log_proto_text_client_flush(LogProtoClient *s)
               self->next_state = -1;
             }
 
-          log_proto_client_msg_ack(&self->super, 1);
+          log_proto_client_msg_ack(&self->super, self->partial_msgs);
 
           /* NOTE: we return here to give a chance to the framed protocol to send the frame header. */
           return LPS_SUCCESS;
@@ -88,6 +100,17 @@ log_proto_text_client_flush(LogProtoClient *s)
   return LPS_SUCCESS;
 }
 
+static LogProtoStatus
+log_proto_text_client_flush(LogProtoClient *s)
+{
+  LogProtoTextClient *self = (LogProtoTextClient *) s;
+
+  if (!self->partial && self->send_buffer_msgs > 0)
+    _start_send_buffer_write(self);
+
+  return _flush_partial(self);
+}
+
 LogProtoStatus
 log_proto_text_client_submit_write(LogProtoClient *s, guchar *msg, gsize msg_len, GDestroyNotify msg_free,
                                    gint next_state)
@@ -99,10 +122,46 @@ log_proto_text_client_submit_write(LogProtoClient *s, guchar *msg, gsize msg_len
   self->partial_len = msg_len;
   self->partial_pos = 0;
   self->partial_free = msg_free;
+  self->partial_msgs = 1;
   self->next_state = next_state;
   return log_proto_text_client_flush(s);
 }
 
+/*
+ * Appends the message to the send buffer, which is written out in one go
+ * once it fills up or the LogWriter flushes us at the end of its batch.
+ * The messages are acked after the whole buffer has been written.
+ */
+LogProtoStatus
+log_proto_text_client_post_buffered(LogProtoClient *s, const guchar *frame_hdr, gsize frame_hdr_len,
+                                    guchar *msg, gsize msg_len, gboolean *consumed)
+{
+  LogProtoTextClient *self = (LogProtoTextClient *) s;
+  gint rc;
+
+  /* only finish a write already in progress, the rest of the buffer is
+   * kept until it fills up or we get flushed */
+  *consumed = FALSE;
+  rc = _flush_partial(self);
+  if (rc == LPS_ERROR)
+    return rc;
+
+  /* the send buffer is still being written, it must not change until then */
+  if (self->partial)
+    return rc;
+
+  if (frame_hdr_len)
+    g_string_append_len(self->send_buffer, (const gchar *) frame_hdr, frame_hdr_len);
+  g_string_append_len(self->send_buffer, (const gchar *) msg, msg_len);
+  self->send_buffer_msgs++;
+  g_free(msg);
+  *consumed = TRUE;
+
+  if (self->send_buffer->len >= self->super.options->send_buffer_size)
+    return log_proto_text_client_flush(s);
+  return LPS_SUCCESS;
+}
+
 
 /*
  * log_proto_text_client_post:
@@ -121,6 +180,9 @@ log_proto_text_client_post(LogProtoClient *s, LogMessage *logmsg, guchar *msg, g
   LogProtoTextClient *self = (LogProtoTextClient *) s;
   gint rc;
 
+  if (log_proto_text_client_is_buffered(self))
+    return log_proto_text_client_post_buffered(s, NULL, 0, msg, msg_len, consumed);
+
   /* try to flush already buffered data */
   *consumed = FALSE;
   rc = log_proto_text_client_flush(s);
@@ -157,6 +219,8 @@ log_proto_text_client_free(LogProtoClient *s)
   if (self->partial_free)
     self->partial_free(self->partial);
   self->partial = NULL;
+  if (self->send_buffer)
+    g_string_free(self->send_buffer, TRUE);
   log_proto_client_free_method(s);
 };
 
@@ -170,6 +234,8 @@ log_proto_text_client_init(LogProtoTextClient *self, LogTransport *transport, co
   self->super.free_fn = log_proto_text_client_free;
   self->super.transport = transport;
   self->next_state = -1;
+  if (options->send_buffer_size > 0)
+    self->send_buffer = g_string_sized_new(options->send_buffer_size + 1024);
 }
 
 LogProtoClient *
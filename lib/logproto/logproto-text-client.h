@@ -33,10 +33,24 @@ typedef struct _LogProtoTextClient
   guchar *partial;
   GDestroyNotify partial_free;
   gsize partial_len, partial_pos;
+  /* number of messages to ack once partial is written out */
+  gint partial_msgs;
+
+  /* used instead of writing messages one-by-one if send-buffer-size() is set */
+  GString *send_buffer;
+  gint send_buffer_msgs;
 } LogProtoTextClient;
 
 LogProtoStatus log_proto_text_client_submit_write(LogProtoClient *s, guchar *msg, gsize msg_len,
                                                   GDestroyNotify msg_free, gint next_state);
+LogProtoStatus log_proto_text_client_post_buffered(LogProtoClient *s, const guchar *frame_hdr, gsize frame_hdr_len,
+                                                   guchar *msg, gsize msg_len, gboolean *consumed);
+
+static inline gboolean
+log_proto_text_client_is_buffered(LogProtoTextClient *self)
+{
+  return self->send_buffer != NULL;
+}
 void log_proto_text_client_init(LogProtoTextClient *self, LogTransport *transport,
                                 const LogProtoClientOptions *options);
 LogProtoClient *log_proto_text_client_new(LogTransport *transport, const LogProtoClientOptions *options);
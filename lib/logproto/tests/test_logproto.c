@@ -30,9 +30,13 @@
 #include "logproto/logproto-framed-server.h"
 #include "logproto/logproto-dgram-server.h"
 #include "logproto/logproto-record-server.h"
+#include "logproto/logproto-text-client.h"
+#include "logproto/logproto-framed-client.h"
 
 #include "apphook.h"
 
+#include <string.h>
+
 static void
 test_log_proto_base(void)
 {
@@ -63,6 +67,149 @@ test_log_proto_base(void)
   log_proto_server_options_destroy(&proto_server_options);
 }
 
+
+static gint client_msgs_acked;
+
+static void
+_client_ack_callback(gint num_msg_acked, gpointer user_data)
+{
+  client_msgs_acked += num_msg_acked;
+}
+
+static LogProtoClient *
+_construct_buffered_client(LogProtoClient *(*construct)(LogTransport *, const LogProtoClientOptions *),
+                           LogTransport *transport, LogProtoClientOptions *options, gint send_buffer_size)
+{
+  LogProtoClientFlowControlFuncs flow_control_funcs = { .ack_callback = _client_ack_callback };
+  LogProtoClient *proto;
+
+  log_proto_client_options_defaults(options);
+  options->send_buffer_size = send_buffer_size;
+  proto = construct(transport, options);
+  log_proto_client_set_client_flow_control(proto, &flow_control_funcs);
+  client_msgs_acked = 0;
+  return proto;
+}
+
+static void
+assert_proto_client_post(LogProtoClient *proto, const gchar *msg, gboolean expected_consumed)
+{
+  guchar *buf = (guchar *) g_strdup(msg);
+  gboolean consumed;
+
+  assert_gint(log_proto_client_post(proto, NULL, buf, strlen(msg), &consumed), LPS_SUCCESS,
+              "posting a message failed: %s", msg);
+  assert_gboolean(consumed, expected_consumed, "unexpected consumed state for message: %s", msg);
+  if (!consumed)
+    g_free(buf);
+}
+
+static void
+test_log_proto_text_client_buffered_flushes_when_full(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(0);
+  LogProtoClientOptions options;
+  LogProtoClient *proto;
+
+  proto = _construct_buffered_client(log_proto_text_client_new, transport, &options, 16);
+
+  assert_proto_client_post(proto, "aaaa\n", TRUE);
+  assert_proto_client_post(proto, "bbbb\n", TRUE);
+  assert_proto_client_post(proto, "cccc\n", TRUE);
+  assert_gint(log_transport_mock_writer_get_num_writes(transport), 0, "messages were written before the buffer filled up");
+  assert_gint(client_msgs_acked, 0, "messages were acked before being written");
+
+  assert_proto_client_post(proto, "dddd\n", TRUE);
+  assert_gint(log_transport_mock_writer_get_num_writes(transport), 1, "a full buffer should be written in one go");
+  assert_string(log_transport_mock_writer_get_written(transport), "aaaa\nbbbb\ncccc\ndddd\n", "written data mismatch");
+  assert_gint(client_msgs_acked, 4, "all messages in the buffer should be acked");
+
+  log_proto_client_free(proto);
+}
+
+static void
+test_log_proto_text_client_buffered_flush_writes_partial_buffer(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(0);
+  LogProtoClientOptions options;
+  LogProtoClient *proto;
+
+  proto = _construct_buffered_client(log_proto_text_client_new, transport, &options, 1024);
+
+  assert_proto_client_post(proto, "aaaa\n", TRUE);
+  assert_proto_client_post(proto, "bbbb\n", TRUE);
+  assert_gint(log_transport_mock_writer_get_num_writes(transport), 0, "messages were written before flush");
+
+  assert_gint(log_proto_client_flush(proto), LPS_SUCCESS, "flush failed");
+  assert_gint(log_transport_mock_writer_get_num_writes(transport), 1, "flush should write the buffer in one go");
+  assert_string(log_transport_mock_writer_get_written(transport), "aaaa\nbbbb\n", "written data mismatch");
+  assert_gint(client_msgs_acked, 2, "flushed messages should be acked");
+
+  log_proto_client_free(proto);
+}
+
+static void
+test_log_proto_text_client_buffered_partial_writes(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(4);
+  LogProtoClientOptions options;
+  LogProtoClient *proto;
+
+  proto = _construct_buffered_client(log_proto_text_client_new, transport, &options, 10);
+
+  assert_proto_client_post(proto, "aaaa\n", TRUE);
+  assert_proto_client_post(proto, "bbbb\n", TRUE);
+  assert_string(log_transport_mock_writer_get_written(transport), "aaaa", "written data mismatch");
+  assert_gint(client_msgs_acked, 0, "messages were acked before the whole buffer was written");
+
+  /* the buffer is still being written, the new message must not be appended to it */
+  assert_proto_client_post(proto, "cccc\n", FALSE);
+  assert_string(log_transport_mock_writer_get_written(transport), "aaaa\nbbb", "written data mismatch");
+  assert_gint(client_msgs_acked, 0, "messages were acked before the whole buffer was written");
+
+  assert_gint(log_proto_client_flush(proto), LPS_SUCCESS, "flush failed");
+  assert_string(log_transport_mock_writer_get_written(transport), "aaaa\nbbbb\n", "written data mismatch");
+  assert_gint(client_msgs_acked, 2, "messages of the written buffer should be acked");
+
+  assert_proto_client_post(proto, "cccc\n", TRUE);
+  assert_gint(log_proto_client_flush(proto), LPS_SUCCESS, "flush failed");
+  assert_gint(client_msgs_acked, 2, "message was acked before it was completely written");
+  assert_gint(log_proto_client_flush(proto), LPS_SUCCESS, "flush failed");
+  assert_string(log_transport_mock_writer_get_written(transport), "aaaa\nbbbb\ncccc\n", "written data mismatch");
+  assert_gint(client_msgs_acked, 3, "message should be acked once written");
+
+  log_proto_client_free(proto);
+}
+
+static void
+test_log_proto_framed_client_buffered(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(0);
+  LogProtoClientOptions options;
+  LogProtoClient *proto;
+
+  proto = _construct_buffered_client(log_proto_framed_client_new, transport, &options, 1024);
+
+  assert_proto_client_post(proto, "hello", TRUE);
+  assert_proto_client_post(proto, "world!", TRUE);
+  assert_gint(log_proto_client_flush(proto), LPS_SUCCESS, "flush failed");
+  assert_gint(log_transport_mock_writer_get_num_writes(transport), 1,
+              "frame headers and payloads should be written in one go");
+  assert_string(log_transport_mock_writer_get_written(transport), "5 hello6 world!", "written data mismatch");
+  assert_gint(client_msgs_acked, 2, "framed messages should be acked");
+
+  log_proto_client_free(proto);
+}
+
+static void
+test_log_proto_buffered_client(void)
+{
+  PROTO_TESTCASE(test_log_proto_text_client_buffered_flushes_when_full);
+  PROTO_TESTCASE(test_log_proto_text_client_buffered_flush_writes_partial_buffer);
+  PROTO_TESTCASE(test_log_proto_text_client_buffered_partial_writes);
+  PROTO_TESTCASE(test_log_proto_framed_client_buffered);
+}
+
 static void
 test_log_proto(void)
 {
@@ -95,6 +242,7 @@ test_log_proto(void)
   test_log_proto_regexp_multiline_server();
   test_log_proto_dgram_server();
   test_log_proto_framed_server();
+  test_log_proto_buffered_client();
 }
 
 int
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logreader-workers.h"
+#include "apphook.h"
+#include "scratch-buffers.h"
+
+/*
+ * The items of a batch are split into contiguous chunks, one per worker
+ * thread plus one processed by the caller itself, so a batch costs a
+ * single queue push per thread and one wakeup of the caller, independently
+ * of the number of items.
+ */
+typedef struct _LogReaderWorkersBatch
+{
+  LogReaderWorkersFunc func;
+  gpointer user_data;
+  gpointer *items;
+  /* chunks not yet completed, protected by LogReaderWorkers->lock */
+  gint pending;
+} LogReaderWorkersBatch;
+
+typedef struct _LogReaderWorkersJob
+{
+  /* NULL batch asks the worker to exit */
+  LogReaderWorkersBatch *batch;
+  gint first;
+  gint last;
+} LogReaderWorkersJob;
+
+struct _LogReaderWorkers
+{
+  GAsyncQueue *jobs;
+  GThread **threads;
+  gint num_threads;
+
+  /* shared by all batches, as several readers may run batches concurrently */
+  GStaticMutex lock;
+  GCond *batch_completed;
+};
+
+static LogReaderWorkersJob quit_job;
+
+static void
+_process_chunk(LogReaderWorkersJob *job)
+{
+  LogReaderWorkersBatch *batch = job->batch;
+  gint i;
+
+  for (i = job->first; i < job->last; i++)
+    {
+      ScratchBuffersMarker mark;
+
+      scratch_buffers_mark(&mark);
+      batch->func(batch->items[i], batch->user_data);
+      scratch_buffers_reclaim_marked(mark);
+    }
+}
+
+static void
+_complete_job(LogReaderWorkers *self, LogReaderWorkersJob *job)
+{
+  g_static_mutex_lock(&self->lock);
+  job->batch->pending--;
+  if (job->batch->pending == 0)
+    g_cond_broadcast(self->batch_completed);
+  g_static_mutex_unlock(&self->lock);
+}
+
+/*
+ * NOTE: these threads are not main loop workers, they have no worker
+ * thread id (main_loop_worker_get_thread_id() returns -1), so state
+ * indexed by the thread id (e.g. the per-thread argument buffers of
+ * templates or the per-thread input queues of LogQueueFifo) must not be
+ * used by the functions they run.  LogReader only parses messages here,
+ * everything else happens in the reader's own thread when the messages
+ * are posted.
+ */
+static gpointer
+_worker_thread(gpointer s)
+{
+  LogReaderWorkers *self = (LogReaderWorkers *) s;
+  LogReaderWorkersJob *job;
+
+  app_thread_start();
+  while ((job = g_async_queue_pop(self->jobs))->batch)
+    {
+      _process_chunk(job);
+      _complete_job(self, job);
+    }
+  app_thread_stop();
+  return NULL;
+}
+
+void
+log_reader_workers_run(LogReaderWorkers *self, LogReaderWorkersFunc func, gpointer user_data,
+                       gpointer *items, gint num_items)
+{
+  LogReaderWorkersBatch batch;
+  LogReaderWorkersJob *jobs;
+  gint num_chunks;
+  gint i;
+
+  if (num_items == 0)
+    return;
+
+  batch.func = func;
+  batch.user_data = user_data;
+  batch.items = items;
+
+  num_chunks = MIN(self->num_threads + 1, num_items);
+  jobs = g_newa(LogReaderWorkersJob, num_chunks);
+  for (i = 0; i < num_chunks; i++)
+    {
+      jobs[i].batch = &batch;
+      jobs[i].first = (gint64) num_items * i / num_chunks;
+      jobs[i].last = (gint64) num_items * (i + 1) / num_chunks;
+    }
+
+  /* the first chunk is processed by the caller */
+  batch.pending = num_chunks - 1;
+  for (i = 1; i < num_chunks; i++)
+    g_async_queue_push(self->jobs, &jobs[i]);
+
+  _process_chunk(&jobs[0]);
+
+  if (num_chunks == 1)
+    return;
+
+  g_static_mutex_lock(&self->lock);
+  while (batch.pending > 0)
+    g_cond_wait(self->batch_completed, g_static_mutex_get_mutex(&self->lock));
+  g_static_mutex_unlock(&self->lock);
+}
+
+LogReaderWorkers *
+log_reader_workers_new(gint num_workers)
+{
+  LogReaderWorkers *self = g_new0(LogReaderWorkers, 1);
+  gint i;
+
+  g_static_mutex_init(&self->lock);
+  self->batch_completed = g_cond_new();
+  self->jobs = g_async_queue_new();
+  self->threads = g_new0(GThread *, num_workers);
+  for (i = 0; i < num_workers; i++)
+    {
+      self->threads[i] = g_thread_create(_worker_thread, self, TRUE, NULL);
+      if (!self->threads[i])
+        break;
+    }
+  self->num_threads = i;
+  return self;
+}
+
+void
+log_reader_workers_free(LogReaderWorkers *self)
+{
+  gint i;
+
+  for (i = 0; i < self->num_threads; i++)
+    g_async_queue_push(self->jobs, &quit_job);
+  for (i = 0; i < self->num_threads; i++)
+    g_thread_join(self->threads[i]);
+
+  g_async_queue_unref(self->jobs);
+  g_free(self->threads);
+  g_cond_free(self->batch_completed);
+  g_static_mutex_free(&self->lock);
+  g_free(self);
+}
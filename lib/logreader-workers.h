@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef LOGREADER_WORKERS_H_INCLUDED
+#define LOGREADER_WORKERS_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/*
+ * A fixed set of threads that process the items of a batch in parallel,
+ * used by LogReader to parse the messages fetched in a single run on
+ * multiple cores.  Each thread, including the caller, processes a
+ * contiguous chunk of the items, it is up to the caller to consume the
+ * results in order.
+ */
+typedef struct _LogReaderWorkers LogReaderWorkers;
+
+typedef void (*LogReaderWorkersFunc)(gpointer item, gpointer user_data);
+
+LogReaderWorkers *log_reader_workers_new(gint num_workers);
+void log_reader_workers_free(LogReaderWorkers *self);
+
+/* blocks until func() has been called for each of the items */
+void log_reader_workers_run(LogReaderWorkers *self, LogReaderWorkersFunc func, gpointer user_data,
+                            gpointer *items, gint num_items);
+
+#endif
@@ -27,9 +27,17 @@
 #include "mainloop-call.h"
 #include "ack_tracker.h"
 #include "scratch-buffers.h"
+#include "str-utils.h"
 
 #include <iv_event.h>
 
+typedef struct _LogReaderParseItem
+{
+  GString *line;
+  LogTransportAuxData aux;
+  LogMessage *msg;
+} LogReaderParseItem;
+
 struct _LogReader
 {
   LogSource super;
@@ -59,6 +67,11 @@ struct _LogReader
   GStaticMutex pending_proto_lock;
   LogProtoServer *pending_proto;
   PollEvents *pending_poll_events;
+
+  /* messages fetched in a single run, parsed by options->workers */
+  LogReaderParseItem *parse_items;
+  gpointer *parse_item_ptrs;
+  gint num_parse_items;
 };
 
 static gboolean log_reader_fetch_log(LogReader *self);
@@ -339,6 +352,130 @@ log_reader_handle_line(LogReader *self, const guchar *line, gint length, LogTran
   return log_source_free_to_send(&self->super);
 }
 
+static void
+log_reader_parse_item(gpointer s, gpointer user_data)
+{
+  LogReaderParseItem *item = (LogReaderParseItem *) s;
+  LogReader *self = (LogReader *) user_data;
+
+  msg_debug("Incoming log entry",
+            evt_tag_printf("line", "%.*s", (gint) item->line->len, item->line->str));
+  item->msg = log_msg_new(item->line->str, item->line->len,
+                          item->aux.peer_addr ? : self->peer_addr,
+                          &self->options->parse_options);
+  log_transport_aux_data_foreach(&item->aux, _add_aux_nvpair, item->msg);
+}
+
+static void
+log_reader_alloc_parse_items(LogReader *self)
+{
+  gint i;
+
+  if (self->num_parse_items >= self->options->fetch_limit)
+    return;
+
+  self->parse_items = g_renew(LogReaderParseItem, self->parse_items, self->options->fetch_limit);
+  self->parse_item_ptrs = g_renew(gpointer, self->parse_item_ptrs, self->options->fetch_limit);
+  for (i = self->num_parse_items; i < self->options->fetch_limit; i++)
+    {
+      self->parse_items[i].line = g_string_sized_new(128);
+      log_transport_aux_data_init(&self->parse_items[i].aux);
+      self->parse_items[i].msg = NULL;
+    }
+  /* the array may have been moved */
+  for (i = 0; i < self->options->fetch_limit; i++)
+    self->parse_item_ptrs[i] = &self->parse_items[i];
+  self->num_parse_items = self->options->fetch_limit;
+}
+
+static void
+log_reader_free_parse_items(LogReader *self)
+{
+  gint i;
+
+  for (i = 0; i < self->num_parse_items; i++)
+    g_string_free(self->parse_items[i].line, TRUE);
+  g_free(self->parse_items);
+  g_free(self->parse_item_ptrs);
+}
+
+/*
+ * Fetches a batch of messages first, has them parsed by the worker
+ * threads, then posts them in the original order.  Only used with
+ * sources that don't track positions, as the late ack tracker hands out
+ * a single bookmark at a time.
+ */
+static gint
+log_reader_fetch_log_parallel(LogReader *self)
+{
+  gint msg_count = 0;
+  gint batch_limit;
+  gint notify_code = 0;
+  gboolean may_read = TRUE;
+  LogTransportAuxData aux;
+  gint i;
+
+  log_reader_alloc_parse_items(self);
+
+  /* don't fetch more than what the window allows, as the whole batch is
+   * posted at once */
+  batch_limit = MIN(self->options->fetch_limit, g_atomic_counter_get(&self->super.window_size));
+  batch_limit = MAX(batch_limit, 1);
+
+  log_transport_aux_data_init(&aux);
+  while (msg_count < batch_limit && !main_loop_worker_job_quit())
+    {
+      Bookmark *bookmark;
+      const guchar *msg = NULL;
+      gsize msg_len;
+      LogProtoStatus status;
+
+      log_transport_aux_data_reinit(&aux);
+      bookmark = ack_tracker_request_bookmark(self->super.ack_tracker);
+      status = log_proto_server_fetch(self->proto, &msg, &msg_len, &may_read, &aux, bookmark);
+      if (status == LPS_EOF || status == LPS_ERROR)
+        {
+          notify_code = status == LPS_ERROR ? NC_READ_ERROR : NC_CLOSE;
+          break;
+        }
+      g_assert(status == LPS_SUCCESS);
+
+      if (!msg)
+        break;
+
+      if (msg_len > 0 || (self->options->flags & LR_EMPTY_LINES))
+        {
+          LogReaderParseItem *item = &self->parse_items[msg_count++];
+
+          g_string_assign_len(item->line, (const gchar *) msg, msg_len);
+          log_transport_aux_data_copy(&item->aux, &aux);
+        }
+    }
+  log_transport_aux_data_destroy(&aux);
+
+  log_reader_workers_run(self->options->workers, log_reader_parse_item, self,
+                         self->parse_item_ptrs, msg_count);
+
+  for (i = 0; i < msg_count; i++)
+    {
+      LogReaderParseItem *item = &self->parse_items[i];
+      ScratchBuffersMarker mark;
+
+      scratch_buffers_mark(&mark);
+      log_msg_refcache_start_producer(item->msg);
+      log_source_post(&self->super, item->msg);
+      log_msg_refcache_stop();
+      scratch_buffers_reclaim_marked(mark);
+
+      item->msg = NULL;
+      log_transport_aux_data_reinit(&item->aux);
+    }
+
+  if (notify_code == 0 && msg_count == self->options->fetch_limit)
+    self->immediate_check = TRUE;
+  return notify_code;
+}
+
 /* returns: notify_code (NC_XXXX) or 0 for success */
 static gint
 log_reader_fetch_log(LogReader *self)
@@ -353,6 +490,9 @@ log_reader_fetch_log(LogReader *self)
       return log_reader_process_handshake(self);
     }
 
+  if (self->options->workers && !ack_tracker_is_late(self->super.ack_tracker))
+    return log_reader_fetch_log_parallel(self);
+
   /* NOTE: this loop is here to decrease the load on the main loop, we try
    * to fetch a couple of messages in a single run (but only up to
    * fetch_limit).
@@ -475,6 +615,7 @@ log_reader_free(LogPipe *s)
   g_sockaddr_unref(self->peer_addr);
   g_static_mutex_free(&self->pending_proto_lock);
   g_cond_free(self->pending_proto_cond);
+  log_reader_free_parse_items(self);
   log_source_free(s);
 }
 
@@ -644,6 +785,8 @@ log_reader_options_init(LogReaderOptions *options, GlobalConfig *cfg, const gcha
     options->parse_options.flags |= LP_ASSUME_UTF8;
   if (cfg->threaded)
     options->flags |= LR_THREADED;
+  if (options->parallelize_workers > 0)
+    options->workers = log_reader_workers_new(options->parallelize_workers);
   options->initialized = TRUE;
 }
 
@@ -653,6 +796,11 @@ log_reader_options_destroy(LogReaderOptions *options)
   log_source_options_destroy(&options->super);
   log_proto_server_options_destroy(&options->proto_options.super);
   msg_format_options_destroy(&options->parse_options);
+  if (options->workers)
+    {
+      log_reader_workers_free(options->workers);
+      options->workers = NULL;
+    }
   options->initialized = FALSE;
 }
 
@@ -29,6 +29,7 @@
 #include "logproto/logproto-server.h"
 #include "poll-events.h"
 #include "timeutils.h"
+#include "logreader-workers.h"
 
 /* flags */
 #define LR_KERNEL          0x0002
@@ -47,6 +48,9 @@ typedef struct _LogReaderOptions
   gint fetch_limit;
   const gchar *group_name;
   gboolean check_hostname;
+  /* number of threads parsing the fetched messages, 0 parses them in the reader */
+  gint parallelize_workers;
+  LogReaderWorkers *workers;
 } LogReaderOptions;
 
 typedef struct _LogReader LogReader;
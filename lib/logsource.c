@@ -28,6 +28,7 @@
 #include "timeutils.h"
 #include "stats/stats-registry.h"
 #include "stats/stats-syslog.h"
+#include "stats/stats-dynamic-cache.h"
 #include "logmsg/tags.h"
 #include "ack_tracker.h"
 
@@ -217,7 +218,11 @@ log_source_init(LogPipe *s)
   stats_register_counter(self->options->stats_level, &sc_key,
                          SC_TYPE_PROCESSED, &self->recvd_messages);
   stats_register_counter(self->options->stats_level, &sc_key, SC_TYPE_STAMP, &self->last_message_seen);
+  stats_counter_enable_sharding(self->recvd_messages);
   stats_unlock();
+
+  if (self->ack_tracker)
+    ack_tracker_init(self->ack_tracker);
   return TRUE;
 }
 
@@ -232,6 +237,9 @@ log_source_deinit(LogPipe *s)
   stats_unregister_counter(&sc_key, SC_TYPE_PROCESSED, &self->recvd_messages);
   stats_unregister_counter(&sc_key, SC_TYPE_STAMP, &self->last_message_seen);
   stats_unlock();
+
+  if (self->ack_tracker)
+    ack_tracker_deinit(self->ack_tracker);
   return TRUE;
 }
 
@@ -333,21 +341,17 @@ log_source_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options
   /* stats counters */
   if (stats_check_level(2))
     {
-      stats_lock();
-
       StatsClusterKey sc_key;
       stats_cluster_logpipe_key_set(&sc_key, SCS_HOST | SCS_SOURCE, NULL,  log_msg_get_value(msg, LM_V_HOST, NULL) );
 
-      stats_register_and_increment_dynamic_counter(2, &sc_key, msg->timestamps[LM_TS_RECVD].tv_sec);
+      stats_dynamic_cache_increment(2, &sc_key, msg->timestamps[LM_TS_RECVD].tv_sec);
       if (stats_check_level(3))
         {
           stats_cluster_logpipe_key_set(&sc_key, SCS_SENDER | SCS_SOURCE, NULL, log_msg_get_value(msg, LM_V_HOST_FROM, NULL) );
-          stats_register_and_increment_dynamic_counter(3, &sc_key, msg->timestamps[LM_TS_RECVD].tv_sec);
+          stats_dynamic_cache_increment(3, &sc_key, msg->timestamps[LM_TS_RECVD].tv_sec);
           stats_cluster_logpipe_key_set(&sc_key, SCS_PROGRAM | SCS_SOURCE, NULL, log_msg_get_value(msg, LM_V_PROGRAM, NULL) );
-          stats_register_and_increment_dynamic_counter(3, &sc_key, msg->timestamps[LM_TS_RECVD].tv_sec);
+          stats_dynamic_cache_increment(3, &sc_key, msg->timestamps[LM_TS_RECVD].tv_sec);
         }
-
-      stats_unlock();
     }
   stats_syslog_process_message_pri(msg->pri);
 
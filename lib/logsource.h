@@ -42,6 +42,8 @@ typedef struct _LogSourceOptions
   gint host_override_len;
   LogTagId source_group_tag;
   gboolean read_old_records;
+  gint bookmark_batch_size;
+  gint bookmark_batch_timeout;
   GArray *tags;
   GList *source_queue_callbacks;
   gint stats_level;
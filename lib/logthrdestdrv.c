@@ -96,6 +96,8 @@ log_threaded_dest_driver_shutdown(gpointer data)
 {
   LogThrDestDriver *self = (LogThrDestDriver *)data;
   log_threaded_dest_driver_stop_watches(self);
+  if (iv_timer_registered(&self->timer_flush))
+    iv_timer_unregister(&self->timer_flush);
   iv_quit();
 }
 
@@ -132,15 +134,204 @@ __disconnect(LogThrDestDriver *self)
 
 
 
+/* a do_work task registered before the failure would reconnect right
+ * away, instead of waiting for time_reopen */
 static void
 _disconnect_and_suspend(LogThrDestDriver *self)
 {
   self->suspended = TRUE;
+  log_threaded_dest_driver_stop_watches(self);
   __disconnect(self);
   log_queue_reset_parallel_push(self->queue);
   log_threaded_dest_driver_suspend(self);
 }
 
+static void
+_release_batch_head(LogThrDestDriver *self, gint num_messages)
+{
+  gint i;
+
+  for (i = 0; i < num_messages; i++)
+    {
+      log_msg_unref((LogMessage *) g_queue_pop_head(&self->batch_messages));
+      step_sequence_number(&self->batch_seq_num);
+    }
+  self->batch_size -= num_messages;
+}
+
+static void
+_accept_batch(LogThrDestDriver *self)
+{
+  self->retries.counter = 0;
+  stats_counter_add(self->written_messages, self->batch_size);
+  log_queue_ack_backlog(self->queue, self->batch_size);
+  _release_batch_head(self, self->batch_size);
+}
+
+static void
+_drop_batch(LogThrDestDriver *self)
+{
+  self->retries.counter = 0;
+  stats_counter_add(self->dropped_messages, self->batch_size);
+  log_queue_ack_backlog(self->queue, self->batch_size);
+  _release_batch_head(self, self->batch_size);
+}
+
+static void
+_rewind_batch(LogThrDestDriver *self)
+{
+  if (self->batch_size > 0)
+    self->seq_num = self->batch_seq_num;
+  log_queue_rewind_backlog(self->queue, self->batch_size);
+  _release_batch_head(self, self->batch_size);
+}
+
+static void
+_retry_over_batch(LogThrDestDriver *self)
+{
+  GList *l;
+
+  if (!self->messages.retry_over)
+    return;
+
+  for (l = self->batch_messages.head; l; l = l->next)
+    self->messages.retry_over(self, (LogMessage *) l->data);
+}
+
+/*
+ * $SEQNUM is stepped for each message that leaves the queue for good:
+ * delivered, added to the batch or dropped.  A rewound batch steps it
+ * back, so that its messages keep their number for the next attempt.
+ */
+static gboolean
+_is_message_consumed(LogThrDestDriver *self, worker_insert_result_t result)
+{
+  switch (result)
+    {
+    case WORKER_INSERT_RESULT_SUCCESS:
+    case WORKER_INSERT_RESULT_QUEUED:
+    case WORKER_INSERT_RESULT_DROP:
+      return TRUE;
+
+    case WORKER_INSERT_RESULT_ERROR:
+      return self->retries.counter + 1 >= self->retries.max;
+
+    default:
+      return FALSE;
+    }
+}
+
+/*
+ * The result of an insert() or flush() call applies to every message in
+ * the current batch, including the one just inserted (if any).
+ */
+static void
+_process_result(LogThrDestDriver *self, worker_insert_result_t result)
+{
+  switch (result)
+    {
+    case WORKER_INSERT_RESULT_DROP:
+      msg_error("Message(s) dropped while sending message to destination",
+                evt_tag_str("driver", self->super.super.id),
+                evt_tag_int("batch_size", self->batch_size));
+
+      _drop_batch(self);
+      _disconnect_and_suspend(self);
+      break;
+
+    case WORKER_INSERT_RESULT_ERROR:
+      self->retries.counter++;
+
+      if (self->retries.counter >= self->retries.max)
+        {
+          _retry_over_batch(self);
+
+          msg_error("Multiple failures while sending message(s) to destination, message(s) dropped",
+                    evt_tag_str("driver", self->super.super.id),
+                    evt_tag_int("number_of_retries", self->retries.max),
+                    evt_tag_int("batch_size", self->batch_size));
+
+          _drop_batch(self);
+        }
+      else
+        {
+          _rewind_batch(self);
+          _disconnect_and_suspend(self);
+        }
+      break;
+
+    case WORKER_INSERT_RESULT_NOT_CONNECTED:
+      _rewind_batch(self);
+      _disconnect_and_suspend(self);
+      break;
+
+    case WORKER_INSERT_RESULT_REWIND:
+      _rewind_batch(self);
+      break;
+
+    case WORKER_INSERT_RESULT_SUCCESS:
+      _accept_batch(self);
+      break;
+
+    case WORKER_INSERT_RESULT_QUEUED:
+    default:
+      break;
+    }
+}
+
+static void
+_perform_flush(LogThrDestDriver *self)
+{
+  if (iv_timer_registered(&self->timer_flush))
+    iv_timer_unregister(&self->timer_flush);
+
+  if (self->batch_size == 0)
+    return;
+
+  worker_insert_result_t result = WORKER_INSERT_RESULT_SUCCESS;
+
+  if (self->worker.flush)
+    {
+      msg_trace("Flushing batch",
+                evt_tag_str("driver", self->super.super.id),
+                evt_tag_int("batch_size", self->batch_size));
+
+      ScratchBuffersMarker mark;
+      scratch_buffers_mark(&mark);
+      result = self->worker.flush(self);
+      scratch_buffers_reclaim_marked(mark);
+    }
+
+  _process_result(self, result);
+}
+
+static gboolean
+_should_flush_now(LogThrDestDriver *self)
+{
+  return self->batch_lines > 0 && self->batch_size >= self->batch_lines;
+}
+
+static void
+_schedule_flush(LogThrDestDriver *self)
+{
+  if (self->batch_size == 0)
+    return;
+
+  if (self->batch_timeout <= 0)
+    {
+      _perform_flush(self);
+      return;
+    }
+
+  if (iv_timer_registered(&self->timer_flush))
+    return;
+
+  iv_validate_now();
+  self->timer_flush.expires = iv_now;
+  timespec_add_msec(&self->timer_flush.expires, self->batch_timeout);
+  iv_timer_register(&self->timer_flush);
+}
+
 static void
 log_threaded_dest_driver_do_insert(LogThrDestDriver *self)
 {
@@ -155,65 +346,32 @@ log_threaded_dest_driver_do_insert(LogThrDestDriver *self)
       msg_set_context(msg);
       log_msg_refcache_start_consumer(msg, &path_options);
 
+      /* the batch keeps the reference returned by pop_head() until the
+       * message is acknowledged or rewound */
+      if (self->batch_size == 0)
+        self->batch_seq_num = self->seq_num;
+      g_queue_push_tail(&self->batch_messages, msg);
+      self->batch_size++;
+
       ScratchBuffersMarker mark;
       scratch_buffers_mark(&mark);
       result = self->worker.insert(self, msg);
       scratch_buffers_reclaim_marked(mark);
 
-      switch (result)
-        {
-        case WORKER_INSERT_RESULT_DROP:
-          msg_error("Message dropped while sending message to destination",
-                    evt_tag_str("driver", self->super.super.id));
+      if (_is_message_consumed(self, result))
+        step_sequence_number(&self->seq_num);
 
-          log_threaded_dest_driver_message_drop(self, msg);
-          _disconnect_and_suspend(self);
-          break;
-
-        case WORKER_INSERT_RESULT_ERROR:
-          self->retries.counter++;
-
-          if (self->retries.counter >= self->retries.max)
-            {
-              if (self->messages.retry_over)
-                self->messages.retry_over(self, msg);
-
-              msg_error("Multiple failures while sending message to destination, message dropped",
-                        evt_tag_str("driver", self->super.super.id),
-                        evt_tag_int("number_of_retries", self->retries.max));
-
-              log_threaded_dest_driver_message_drop(self, msg);
-            }
-          else
-            {
-              log_threaded_dest_driver_message_rewind(self, msg);
-              _disconnect_and_suspend(self);
-            }
-          break;
-
-        case WORKER_INSERT_RESULT_NOT_CONNECTED:
-          log_threaded_dest_driver_message_rewind(self, msg);
-          _disconnect_and_suspend(self);
-          break;
+      _process_result(self, result);
 
-        case WORKER_INSERT_RESULT_REWIND:
-          log_threaded_dest_driver_message_rewind(self, msg);
-          break;
-
-        case WORKER_INSERT_RESULT_SUCCESS:
-          stats_counter_inc(self->written_messages);
-          log_threaded_dest_driver_message_accept(self, msg);
-          break;
-
-        default:
-          break;
-        }
+      if (_should_flush_now(self))
+        _perform_flush(self);
 
       msg_set_context(NULL);
       log_msg_refcache_stop();
     }
   if (!self->suspended)
     {
+      _schedule_flush(self);
       if (self->worker.worker_message_queue_empty)
         {
           self->worker.worker_message_queue_empty(self);
@@ -221,6 +379,17 @@ log_threaded_dest_driver_do_insert(LogThrDestDriver *self)
     }
 }
 
+static void
+log_threaded_dest_driver_flush_timer_expired(gpointer data)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)data;
+
+  if (!self->worker.connected)
+    return;
+
+  _perform_flush(self);
+}
+
 static void
 log_threaded_dest_driver_do_work(gpointer data)
 {
@@ -275,6 +444,10 @@ log_threaded_dest_driver_init_watches(LogThrDestDriver *self)
   self->timer_throttle.cookie = self;
   self->timer_throttle.handler = log_threaded_dest_driver_do_work;
 
+  IV_TIMER_INIT(&self->timer_flush);
+  self->timer_flush.cookie = self;
+  self->timer_flush.handler = log_threaded_dest_driver_flush_timer_expired;
+
   IV_TASK_INIT(&self->do_work);
   self->do_work.cookie = self;
   self->do_work.handler = log_threaded_dest_driver_do_work;
@@ -301,6 +474,10 @@ log_threaded_dest_driver_worker_thread_main(gpointer arg)
 
   iv_main();
 
+  if (self->worker.connected)
+    _perform_flush(self);
+  _rewind_batch(self);
+
   __disconnect(self);
   if (self->worker.thread_deinit)
     self->worker.thread_deinit(self);
@@ -363,6 +540,8 @@ log_threaded_dest_driver_start(LogPipe *s)
   stats_register_counter(0, &sc_key, SC_TYPE_PROCESSED, &self->processed_messages);
   stats_register_counter_and_index(1, &sc_key, SC_TYPE_MEMORY_USAGE, &self->memory_usage);
   stats_register_counter(1, &sc_key, SC_TYPE_WRITTEN, &self->written_messages);
+  stats_counter_enable_sharding(self->queued_messages);
+  stats_counter_enable_sharding(self->memory_usage);
   stats_unlock();
 
   log_queue_set_counters(self->queue, self->queued_messages,
@@ -456,6 +635,46 @@ log_threaded_dest_driver_init_instance(LogThrDestDriver *self, GlobalConfig *cfg
   self->time_reopen = -1;
 
   self->retries.max = MAX_RETRIES_OF_FAILED_INSERT_DEFAULT;
+  self->batch_lines = 0;
+  self->batch_timeout = 0;
+}
+
+/*
+ * Acknowledges the first @num_messages of the current batch, for drivers
+ * that learn about the partial success of a batch.  The result returned
+ * by the pending insert() or flush() call applies to the rest of the
+ * batch only.
+ */
+void
+log_threaded_dest_driver_accept_batch_head(LogThrDestDriver *self, gint num_messages)
+{
+  g_assert(num_messages <= self->batch_size);
+
+  if (num_messages == 0)
+    return;
+
+  self->retries.counter = 0;
+  stats_counter_add(self->written_messages, num_messages);
+  log_queue_ack_backlog(self->queue, num_messages);
+  _release_batch_head(self, num_messages);
+}
+
+/*
+ * Same as log_threaded_dest_driver_accept_batch_head(), but the messages
+ * are counted as dropped, e.g. when the destination rejected them.
+ */
+void
+log_threaded_dest_driver_drop_batch_head(LogThrDestDriver *self, gint num_messages)
+{
+  g_assert(num_messages <= self->batch_size);
+
+  if (num_messages == 0)
+    return;
+
+  self->retries.counter = 0;
+  stats_counter_add(self->dropped_messages, num_messages);
+  log_queue_ack_backlog(self->queue, num_messages);
+  _release_batch_head(self, num_messages);
 }
 
 void
@@ -491,3 +710,19 @@ log_threaded_dest_driver_set_max_retries(LogDriver *s, gint max_retries)
 
   self->retries.max = max_retries;
 }
+
+void
+log_threaded_dest_driver_set_batch_lines(LogDriver *s, gint batch_lines)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)s;
+
+  self->batch_lines = batch_lines;
+}
+
+void
+log_threaded_dest_driver_set_batch_timeout(LogDriver *s, gint batch_timeout)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)s;
+
+  self->batch_timeout = batch_timeout;
+}
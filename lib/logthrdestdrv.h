@@ -39,7 +39,10 @@ typedef enum
   WORKER_INSERT_RESULT_ERROR,
   WORKER_INSERT_RESULT_REWIND,
   WORKER_INSERT_RESULT_SUCCESS,
-  WORKER_INSERT_RESULT_NOT_CONNECTED
+  WORKER_INSERT_RESULT_NOT_CONNECTED,
+  /* the message was added to the current batch, it will be acknowledged or
+   * rewound together with the rest of the batch */
+  WORKER_INSERT_RESULT_QUEUED
 } worker_insert_result_t;
 
 typedef struct _LogThrDestDriver LogThrDestDriver;
@@ -66,6 +69,7 @@ struct _LogThrDestDriver
     void (*thread_init) (LogThrDestDriver *s);
     void (*thread_deinit) (LogThrDestDriver *s);
     worker_insert_result_t (*insert) (LogThrDestDriver *s, LogMessage *msg);
+    worker_insert_result_t (*flush) (LogThrDestDriver *s);
     gboolean (*connect) (LogThrDestDriver *s);
     void (*worker_message_queue_empty)(LogThrDestDriver *s);
     void (*disconnect) (LogThrDestDriver *s);
@@ -89,12 +93,22 @@ struct _LogThrDestDriver
     gint max;
   } retries;
 
+  gint batch_lines;
+  gint batch_timeout;
+  /* number of messages inserted since the last acknowledge/rewind */
+  gint batch_size;
+  /* the messages of the current batch, in insertion order, referenced */
+  GQueue batch_messages;
+  /* the $SEQNUM of the first message in the current batch */
+  gint32 batch_seq_num;
+
   void (*queue_method) (LogThrDestDriver *s);
   WorkerOptions worker_options;
   struct iv_event wake_up_event;
   struct iv_event shutdown_event;
   struct iv_timer timer_reopen;
   struct iv_timer timer_throttle;
+  struct iv_timer timer_flush;
   struct iv_task  do_work;
 };
 
@@ -111,6 +125,11 @@ void log_threaded_dest_driver_message_drop(LogThrDestDriver *self,
 void log_threaded_dest_driver_message_rewind(LogThrDestDriver *self,
                                              LogMessage *msg);
 
+void log_threaded_dest_driver_accept_batch_head(LogThrDestDriver *self, gint num_messages);
+void log_threaded_dest_driver_drop_batch_head(LogThrDestDriver *self, gint num_messages);
+
 void log_threaded_dest_driver_set_max_retries(LogDriver *s, gint max_retries);
+void log_threaded_dest_driver_set_batch_lines(LogDriver *s, gint batch_lines);
+void log_threaded_dest_driver_set_batch_timeout(LogDriver *s, gint batch_timeout);
 
 #endif
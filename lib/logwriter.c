@@ -126,6 +126,7 @@ static void log_writer_stop_watches(LogWriter *self);
 static void log_writer_update_watches(LogWriter *self);
 static void log_writer_suspend(LogWriter *self);
 static void log_writer_free_proto(LogWriter *self);
+static void log_writer_ack_pending_proto(LogWriter *self);
 static void log_writer_set_proto(LogWriter *self, LogProtoClient *proto);
 static void log_writer_set_pending_proto(LogWriter *self, LogProtoClient *proto, gboolean present);
 
@@ -200,6 +201,7 @@ log_writer_work_finished(gpointer s)
        * non-main thread. */
 
       g_static_mutex_lock(&self->pending_proto_lock);
+      log_writer_ack_pending_proto(self);
       log_writer_free_proto(self);
 
       log_writer_set_proto(self, self->pending_proto);
@@ -1298,7 +1300,11 @@ _register_counters(LogWriter *self)
     stats_register_counter(self->options->stats_level, &sc_key, SC_TYPE_PROCESSED, &self->processed_messages);
     stats_register_counter(self->options->stats_level, &sc_key, SC_TYPE_QUEUED, &self->queued_messages);
     stats_register_counter(self->options->stats_level, &sc_key, SC_TYPE_WRITTEN, &self->written_messages);
+    stats_counter_enable_sharding(self->processed_messages);
+    stats_counter_enable_sharding(self->written_messages);
     stats_register_counter_and_index(STATS_LEVEL1, &sc_key, SC_TYPE_MEMORY_USAGE, &self->memory_usage);
+    stats_counter_enable_sharding(self->queued_messages);
+    stats_counter_enable_sharding(self->memory_usage);
 
   }
   stats_unlock();
@@ -1386,6 +1392,8 @@ log_writer_deinit(LogPipe *s)
 
   log_queue_reset_parallel_push(self->queue);
   log_writer_flush(self, LW_FLUSH_FORCE);
+  /* acks must be done here, the queue may be gone by the time we are freed */
+  log_writer_ack_pending_proto(self);
   /* FIXME: by the time we arrive here, it must be guaranteed that no
    * _queue() call is running in a different thread, otherwise we'd need
    * some kind of locking. */
@@ -1443,6 +1451,13 @@ log_writer_opened(LogWriter *self)
 }
 
 
+static void
+log_writer_ack_pending_proto(LogWriter *self)
+{
+  if (self->proto)
+    log_proto_client_ack_pending(self->proto);
+}
+
 static void
 log_writer_free_proto(LogWriter *self)
 {
@@ -1462,6 +1477,7 @@ log_writer_set_proto(LogWriter *self, LogProtoClient *proto)
       LogProtoClientFlowControlFuncs flow_control_funcs;
       flow_control_funcs.ack_callback = log_writer_msg_ack;
       flow_control_funcs.rewind_callback = log_writer_msg_rewind;
+      flow_control_funcs.wakeup_callback = log_writer_queue_filled;
       flow_control_funcs.user_data = self;
 
       log_proto_client_set_client_flow_control(self->proto, &flow_control_funcs);
@@ -1510,6 +1526,7 @@ log_writer_reopen_deferred(gpointer s)
 
   log_writer_stop_watches(self);
 
+  log_writer_ack_pending_proto(self);
   log_writer_free_proto(self);
   log_writer_set_proto(self, proto);
 
@@ -1617,6 +1634,7 @@ log_writer_options_defaults(LogWriterOptions *options)
   options->mark_mode = MM_GLOBAL;
   options->mark_freq = -1;
   host_resolve_options_defaults(&options->host_resolve_options);
+  log_proto_client_options_defaults(&options->proto_options.super);
 }
 
 void
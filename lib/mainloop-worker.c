@@ -124,6 +124,14 @@ main_loop_worker_get_thread_id(void)
   return main_loop_worker_id - 1;
 }
 
+/* thread ids returned by main_loop_worker_get_thread_id() are always below
+ * this value, so they can be used to index per-thread arrays */
+gint
+main_loop_worker_get_max_number_of_thread_ids(void)
+{
+  return MAIN_LOOP_WORKER_TYPE_MAX * MAIN_LOOP_MAX_WORKER_THREADS;
+}
+
 typedef struct _WorkerExitNotification
 {
   WorkerExitNotificationFunc func;
@@ -68,6 +68,7 @@ typedef void (*WorkerExitNotificationFunc)(gpointer user_data);
 
 void main_loop_worker_set_thread_id(gint id);
 gint main_loop_worker_get_thread_id(void);
+gint main_loop_worker_get_max_number_of_thread_ids(void);
 
 void main_loop_worker_job_start(void);
 void main_loop_worker_job_complete(void);
@@ -24,6 +24,53 @@
 #include "stats/stats-counter.h"
 #include "stats/stats-cluster.h"
 #include "stats/stats-registry.h"
+#include "tls-support.h"
+#include "atomic.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+TLS_BLOCK_START
+{
+  /* 1 based, 0 means not assigned yet */
+  gint shard_index;
+}
+TLS_BLOCK_END;
+
+#define shard_index   __tls_deref(shard_index)
+
+static GAtomicCounter next_shard_index;
+
+gint
+stats_counter_get_shard_index(void)
+{
+  if (G_UNLIKELY(shard_index == 0))
+    shard_index = (g_atomic_counter_exchange_and_add(&next_shard_index, 1) % STATS_COUNTER_MAX_SHARDS) + 1;
+  return shard_index - 1;
+}
+
+/*
+ * Spreads the updates of a hot counter over per-thread slots, instead of
+ * having all threads hit the same cache line.  Readers sum the slots up
+ * in stats_counter_get().  Should be called with the stats lock held,
+ * usually right after the counter is registered.
+ */
+void
+stats_counter_enable_sharding(StatsCounterItem *counter)
+{
+  gpointer shards;
+
+  if (!counter || counter->shards)
+    return;
+
+  /* malloc() only aligns to 16 bytes, the shards would straddle cache
+   * lines; without memory the counter simply stays unsharded */
+  if (posix_memalign(&shards, STATS_COUNTER_CACHE_LINE_SIZE, sizeof(StatsCounterShard) * STATS_COUNTER_MAX_SHARDS) != 0)
+    return;
+  memset(shards, 0, sizeof(StatsCounterShard) * STATS_COUNTER_MAX_SHARDS);
+
+  g_atomic_pointer_set(&counter->shards, shards);
+}
 
 static void
 _reset_counter(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointer user_data)
@@ -57,4 +104,5 @@ stats_counter_free(StatsCounterItem *counter)
 {
   if (counter->name)
     g_free(counter->name);
+  free(counter->shards);
 }
@@ -26,40 +26,64 @@
 
 #include "syslog-ng.h"
 
+#define STATS_COUNTER_MAX_SHARDS 16
+#define STATS_COUNTER_CACHE_LINE_SIZE 64
+
+/* each shard sits on its own cache line, so that threads updating
+ * different shards don't compete for the same line */
+typedef union _StatsCounterShard
+{
+  gssize value;
+  gchar __pad[STATS_COUNTER_CACHE_LINE_SIZE];
+} StatsCounterShard;
+
 typedef struct _StatsCounterItem
 {
   gssize value;
   gchar *name;
   gint type;
+  /* NULL unless the counter was made sharded with stats_counter_enable_sharding() */
+  StatsCounterShard *shards;
 } StatsCounterItem;
 
+gint stats_counter_get_shard_index(void);
+
+static inline gssize *
+_stats_counter_get_slot(StatsCounterItem *counter)
+{
+  StatsCounterShard *shards = counter->shards;
+
+  if (shards)
+    return &shards[stats_counter_get_shard_index()].value;
+  return &counter->value;
+}
 
 static inline void
 stats_counter_add(StatsCounterItem *counter, gssize add)
 {
   if (counter)
-    g_atomic_pointer_add(&counter->value, add);
+    g_atomic_pointer_add(_stats_counter_get_slot(counter), add);
 }
 
 static inline void
 stats_counter_sub(StatsCounterItem *counter, gssize sub)
 {
   if (counter)
-    g_atomic_pointer_add(&counter->value, -1 * sub);
+    g_atomic_pointer_add(_stats_counter_get_slot(counter), -1 * sub);
 }
 
 static inline void
 stats_counter_inc(StatsCounterItem *counter)
 {
   if (counter)
-    g_atomic_pointer_add(&counter->value, 1);
+    g_atomic_pointer_add(_stats_counter_get_slot(counter), 1);
 }
 
 static inline void
 stats_counter_dec(StatsCounterItem *counter)
 {
   if (counter)
-    g_atomic_pointer_add(&counter->value, -1);
+    g_atomic_pointer_add(_stats_counter_get_slot(counter), -1);
 }
 
 /* NOTE: this is _not_ atomic and doesn't have to be as sets would race anyway */
@@ -67,7 +91,17 @@ static inline void
 stats_counter_set(StatsCounterItem *counter, gsize value)
 {
   if (counter)
-    counter->value = value;
+    {
+      StatsCounterShard *shards = counter->shards;
+      gint i;
+
+      if (shards)
+        {
+          for (i = 0; i < STATS_COUNTER_MAX_SHARDS; i++)
+            shards[i].value = 0;
+        }
+      counter->value = value;
+    }
 }
 
 /* NOTE: this is _not_ atomic and doesn't have to be as sets would race anyway */
@@ -77,7 +111,17 @@ stats_counter_get(StatsCounterItem *counter)
   gssize result = 0;
 
   if (counter)
-    result = counter->value;
+    {
+      StatsCounterShard *shards = counter->shards;
+      gint i;
+
+      result = counter->value;
+      if (shards)
+        {
+          for (i = 0; i < STATS_COUNTER_MAX_SHARDS; i++)
+            result += shards[i].value;
+        }
+    }
   return result;
 }
 
@@ -89,6 +133,7 @@ stats_counter_get_name(StatsCounterItem *counter)
   return NULL;
 }
 
+void stats_counter_enable_sharding(StatsCounterItem *counter);
 void stats_reset_counters(void);
 void stats_counter_free(StatsCounterItem *counter);
 
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "stats/stats-dynamic-cache.h"
+#include "stats/stats-registry.h"
+#include "mainloop-worker.h"
+#include "tls-support.h"
+
+/*
+ * Per-thread cache of dynamic counter increments.
+ *
+ * Dynamic counters (per host, sender, program, etc) are looked up by
+ * their key in the global registry, which requires the stats_lock().
+ * Doing that for every message makes the stats lock the most contended
+ * lock in the process, as every input thread increments the same
+ * dynamic counters.
+ *
+ * Instead, worker threads accumulate increments in a thread-local hash,
+ * which requires no locking at all, and merge them into the registry
+ * once per batch, using a single stats_lock() round for all keys seen in
+ * the batch.  Threads that are not worker threads (e.g. the main thread)
+ * update the registry directly, just like before.
+ *
+ * The cache keeps its entries between batches to avoid cloning the keys
+ * again for recurring hosts/programs, but it is emptied whenever it grows
+ * above STATS_DYNAMIC_CACHE_MAX_ENTRIES, so that high-cardinality keys
+ * cannot blow up per-thread memory usage.
+ */
+
+#define STATS_DYNAMIC_CACHE_MAX_ENTRIES 1024
+
+typedef struct _StatsDynamicCacheEntry
+{
+  StatsClusterKey key;
+  gint stats_level;
+  gssize pending;
+  time_t timestamp;
+} StatsDynamicCacheEntry;
+
+TLS_BLOCK_START
+{
+  GHashTable *dynamic_cache;
+  WorkerBatchCallback dynamic_cache_flush_cb;
+  gboolean dynamic_cache_flush_cb_registered;
+}
+TLS_BLOCK_END;
+
+#define dynamic_cache  __tls_deref(dynamic_cache)
+#define dynamic_cache_flush_cb  __tls_deref(dynamic_cache_flush_cb)
+#define dynamic_cache_flush_cb_registered  __tls_deref(dynamic_cache_flush_cb_registered)
+
+static guint
+_key_hash(const StatsClusterKey *key)
+{
+  return g_str_hash(key->id) + g_str_hash(key->instance) + key->component;
+}
+
+static gboolean
+_key_equal(const StatsClusterKey *key1, const StatsClusterKey *key2)
+{
+  return stats_cluster_key_equal(key1, key2);
+}
+
+static void
+_entry_free(StatsDynamicCacheEntry *entry)
+{
+  g_free((gchar *) entry->key.id);
+  g_free((gchar *) entry->key.instance);
+  g_free(entry);
+}
+
+static StatsDynamicCacheEntry *
+_entry_new(gint stats_level, const StatsClusterKey *sc_key)
+{
+  StatsDynamicCacheEntry *entry = g_new0(StatsDynamicCacheEntry, 1);
+
+  entry->key = *sc_key;
+  entry->key.id = g_strdup(sc_key->id);
+  entry->key.instance = g_strdup(sc_key->instance);
+  entry->stats_level = stats_level;
+  entry->timestamp = -1;
+  return entry;
+}
+
+static void
+_flush_entry(gpointer key, gpointer value, gpointer user_data)
+{
+  StatsDynamicCacheEntry *entry = (StatsDynamicCacheEntry *) value;
+
+  if (entry->pending == 0)
+    return;
+
+  stats_register_and_add_dynamic_counter(entry->stats_level, &entry->key, entry->timestamp, entry->pending);
+  entry->pending = 0;
+}
+
+static void
+_flush_batch_callback(gpointer user_data)
+{
+  dynamic_cache_flush_cb_registered = FALSE;
+  stats_dynamic_cache_flush();
+}
+
+static void
+_register_flush_callback(void)
+{
+  if (dynamic_cache_flush_cb_registered)
+    return;
+
+  worker_batch_callback_init(&dynamic_cache_flush_cb);
+  dynamic_cache_flush_cb.func = _flush_batch_callback;
+  dynamic_cache_flush_cb.user_data = NULL;
+  main_loop_worker_register_batch_callback(&dynamic_cache_flush_cb);
+  dynamic_cache_flush_cb_registered = TRUE;
+}
+
+void
+stats_dynamic_cache_flush(void)
+{
+  if (!dynamic_cache)
+    return;
+
+  stats_lock();
+  g_hash_table_foreach(dynamic_cache, _flush_entry, NULL);
+  stats_unlock();
+
+  if (g_hash_table_size(dynamic_cache) > STATS_DYNAMIC_CACHE_MAX_ENTRIES)
+    g_hash_table_remove_all(dynamic_cache);
+}
+
+/*
+ * stats_dynamic_cache_increment:
+ * @timestamp: if non-negative, an associated timestamp will be created and set
+ *
+ * Same as stats_register_and_increment_dynamic_counter(), except that it
+ * does not need the stats lock to be held, the increment becomes visible
+ * in the registry at the end of the current worker batch.
+ */
+void
+stats_dynamic_cache_increment(gint stats_level, const StatsClusterKey *sc_key, time_t timestamp)
+{
+  if (!stats_check_level(stats_level))
+    return;
+
+  if (main_loop_worker_get_thread_id() < 0)
+    {
+      stats_lock();
+      stats_register_and_increment_dynamic_counter(stats_level, sc_key, timestamp);
+      stats_unlock();
+      return;
+    }
+
+  if (!dynamic_cache)
+    dynamic_cache = g_hash_table_new_full((GHashFunc) _key_hash, (GEqualFunc) _key_equal,
+                                         NULL, (GDestroyNotify) _entry_free);
+
+  StatsDynamicCacheEntry *entry = g_hash_table_lookup(dynamic_cache, sc_key);
+  if (!entry)
+    {
+      entry = _entry_new(stats_level, sc_key);
+      g_hash_table_insert(dynamic_cache, &entry->key, entry);
+    }
+
+  entry->pending++;
+  if (timestamp > entry->timestamp)
+    entry->timestamp = timestamp;
+
+  _register_flush_callback();
+}
+
+void
+stats_dynamic_cache_thread_deinit(void)
+{
+  if (dynamic_cache_flush_cb_registered)
+    {
+      iv_list_del_init(&dynamic_cache_flush_cb.list);
+      dynamic_cache_flush_cb_registered = FALSE;
+    }
+
+  if (!dynamic_cache)
+    return;
+
+  stats_dynamic_cache_flush();
+  g_hash_table_destroy(dynamic_cache);
+  dynamic_cache = NULL;
+}
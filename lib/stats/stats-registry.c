@@ -192,14 +192,14 @@ stats_register_dynamic_counter(gint stats_level, const StatsClusterKey *sc_key,
 }
 
 /*
- * stats_instant_inc_dynamic_counter
+ * stats_register_and_add_dynamic_counter
  * @timestamp: if non-negative, an associated timestamp will be created and set
  *
- * Instantly create (if not exists) and increment a dynamic counter.
+ * Instantly create (if not exists) and add @add to a dynamic counter.
  */
 void
-stats_register_and_increment_dynamic_counter(gint stats_level, const StatsClusterKey *sc_key,
-                                             time_t timestamp)
+stats_register_and_add_dynamic_counter(gint stats_level, const StatsClusterKey *sc_key,
+                                       time_t timestamp, gssize add)
 {
   StatsCounterItem *counter, *stamp;
   StatsCluster *handle;
@@ -208,7 +208,7 @@ stats_register_and_increment_dynamic_counter(gint stats_level, const StatsCluste
   handle = stats_register_dynamic_counter(stats_level, sc_key, SC_TYPE_PROCESSED, &counter);
   if (!handle)
     return;
-  stats_counter_inc(counter);
+  stats_counter_add(counter, add);
   if (timestamp >= 0)
     {
       stats_register_associated_counter(handle, SC_TYPE_STAMP, &stamp);
@@ -218,6 +218,19 @@ stats_register_and_increment_dynamic_counter(gint stats_level, const StatsCluste
   stats_unregister_dynamic_counter(handle, SC_TYPE_PROCESSED, &counter);
 }
 
+/*
+ * stats_instant_inc_dynamic_counter
+ * @timestamp: if non-negative, an associated timestamp will be created and set
+ *
+ * Instantly create (if not exists) and increment a dynamic counter.
+ */
+void
+stats_register_and_increment_dynamic_counter(gint stats_level, const StatsClusterKey *sc_key,
+                                             time_t timestamp)
+{
+  stats_register_and_add_dynamic_counter(stats_level, sc_key, timestamp, 1);
+}
+
 /**
  * stats_register_associated_counter:
  * @sc: the dynamic counter that was registered with stats_register_dynamic_counter
@@ -39,6 +39,8 @@ StatsCluster *stats_register_counter_and_index(gint level, const StatsClusterKey
 StatsCluster *stats_register_dynamic_counter(gint stats_level, const StatsClusterKey *sc_key, gint type,
                                              StatsCounterItem **counter);
 void stats_register_and_increment_dynamic_counter(gint stats_level, const StatsClusterKey *sc_key, time_t timestamp);
+void stats_register_and_add_dynamic_counter(gint stats_level, const StatsClusterKey *sc_key, time_t timestamp,
+                                            gssize add);
 void stats_register_associated_counter(StatsCluster *handle, gint type, StatsCounterItem **counter);
 void stats_unregister_counter(const StatsClusterKey *sc_key, gint type, StatsCounterItem **counter);
 void stats_unregister_dynamic_counter(StatsCluster *handle, gint type, StatsCounterItem **counter);
@@ -27,9 +27,11 @@
 #include "stats/stats-cluster.h"
 #include "stats/stats-cluster-single.h"
 #include "stats/stats-counter.h"
+#include "stats/stats-dynamic-cache.h"
 #include "stats/stats-query.h"
 #include "stats/stats-registry.h"
 #include "syslog-ng.h"
+#include "mainloop-worker.h"
 
 #include <criterion/criterion.h>
 #include <criterion/parameterized.h>
@@ -83,3 +85,74 @@ Test(stats_dynamic_clusters, register_limited)
   stats_unlock();
 }
 
+
+static gssize
+_get_dynamic_counter_value(StatsClusterKey *sc_key, gint type)
+{
+  StatsCounterItem *counter = NULL;
+  gssize value;
+
+  stats_lock();
+  StatsCluster *sc = stats_register_dynamic_counter(1, sc_key, SC_TYPE_PROCESSED, &counter);
+  cr_assert_not_null(sc);
+  StatsCounterItem *item = &sc->counter_group.counters[type];
+  value = stats_counter_get(item);
+  stats_unregister_dynamic_counter(sc, SC_TYPE_PROCESSED, &counter);
+  stats_unlock();
+
+  return value;
+}
+
+static gpointer
+_increment_cached_counters_in_worker_thread(gpointer user_data)
+{
+  StatsClusterKey *sc_key = (StatsClusterKey *) user_data;
+
+  main_loop_worker_thread_start(NULL);
+
+  stats_dynamic_cache_increment(2, sc_key, 10);
+  stats_dynamic_cache_increment(2, sc_key, 20);
+  stats_dynamic_cache_increment(2, sc_key, 15);
+
+  main_loop_worker_invoke_batch_callbacks();
+
+  cr_assert_eq(_get_dynamic_counter_value(sc_key, SC_TYPE_PROCESSED), 3);
+  cr_assert_eq(_get_dynamic_counter_value(sc_key, SC_TYPE_STAMP), 20);
+
+  /* pending increments are merged when the thread stops */
+  stats_dynamic_cache_increment(2, sc_key, 30);
+
+  main_loop_worker_thread_stop();
+  return NULL;
+}
+
+Test(stats_dynamic_clusters, cached_increments_are_merged_at_the_end_of_the_batch)
+{
+  StatsOptions stats_opts;
+  stats_options_defaults(&stats_opts);
+  stats_opts.level = 3;
+  stats_reinit(&stats_opts);
+
+  StatsClusterKey sc_key;
+  stats_cluster_logpipe_key_set(&sc_key, SCS_HOST | SCS_SOURCE, NULL, "cachedhost");
+
+  GThread *thread = g_thread_create(_increment_cached_counters_in_worker_thread, &sc_key, TRUE, NULL);
+  g_thread_join(thread);
+
+  cr_assert_eq(_get_dynamic_counter_value(&sc_key, SC_TYPE_PROCESSED), 4);
+  cr_assert_eq(_get_dynamic_counter_value(&sc_key, SC_TYPE_STAMP), 30);
+}
+
+Test(stats_dynamic_clusters, increments_are_immediate_outside_of_worker_threads)
+{
+  StatsOptions stats_opts;
+  stats_options_defaults(&stats_opts);
+  stats_opts.level = 3;
+  stats_reinit(&stats_opts);
+
+  StatsClusterKey sc_key;
+  stats_cluster_logpipe_key_set(&sc_key, SCS_HOST | SCS_SOURCE, NULL, "uncachedhost");
+  stats_dynamic_cache_increment(2, &sc_key, 10);
+
+  cr_assert_eq(_get_dynamic_counter_value(&sc_key, SC_TYPE_PROCESSED), 1);
+}
@@ -231,6 +231,33 @@ test_get_component_name_translates_component_to_name_properly(void)
   assert_stats_component_name(SCS_DESTINATION | SCS_GROUP, "destination");
 }
 
+static void
+test_sharded_counter_sums_up_its_shards(void)
+{
+  StatsCluster *sc;
+  StatsClusterKey sc_key;
+  StatsCounterItem *counter;
+
+  stats_cluster_logpipe_key_set(&sc_key, SCS_SOURCE | SCS_FILE, "id", "instance");
+  sc = stats_cluster_new(&sc_key);
+  counter = stats_cluster_track_counter(sc, SC_TYPE_PROCESSED);
+
+  stats_counter_add(counter, 5);
+  stats_counter_enable_sharding(counter);
+  assert_gint(GPOINTER_TO_SIZE(counter->shards) % STATS_COUNTER_CACHE_LINE_SIZE, 0,
+              "Shards are not aligned to cache lines");
+  stats_counter_inc(counter);
+  stats_counter_add(counter, 10);
+  stats_counter_dec(counter);
+  assert_gint(stats_counter_get(counter), 15, "Sharded counter value mismatch");
+
+  stats_counter_set(counter, 3);
+  assert_gint(stats_counter_get(counter), 3, "Setting a sharded counter should drop the shards");
+
+  stats_cluster_untrack_counter(sc, SC_TYPE_PROCESSED, &counter);
+  stats_cluster_free(sc);
+}
+
 static void
 test_stats_cluster(void)
 {
@@ -242,6 +269,7 @@ test_stats_cluster(void)
   STATS_CLUSTER_TESTCASE(test_stats_cluster_single);
   STATS_CLUSTER_TESTCASE(test_stats_cluster_key_not_equal_when_custom_tags_are_different);
   STATS_CLUSTER_TESTCASE(test_stats_cluster_key_equal_when_custom_tags_are_the_same);
+  STATS_CLUSTER_TESTCASE(test_sharded_counter_sums_up_its_shards);
 }
 
 int
@@ -23,6 +23,9 @@
  */
 
 #include "template/repr.h"
+#include "template/macros.h"
+
+#include <string.h>
 
 void
 log_template_elem_free(LogTemplateElem *e)
@@ -59,3 +62,106 @@ log_template_elem_free_list(GList *l)
     }
   g_list_free(l);
 }
+
+/* rough guess for the length of a single expanded value/macro/function */
+#define LOG_TEMPLATE_EXPECTED_VALUE_LEN 16
+
+static gboolean
+_elem_is_pure_text(LogTemplateElem *e)
+{
+  return e->type == LTE_MACRO && e->macro == M_NONE;
+}
+
+static void
+_append_text(LogTemplateProgram *self, GArray *instrs, GString *literals, const gchar *text, gsize text_len)
+{
+  LogTemplateInstr *last;
+
+  if (!text || text_len == 0)
+    return;
+
+  last = instrs->len > 0 ? &g_array_index(instrs, LogTemplateInstr, instrs->len - 1) : NULL;
+  if (last && last->op == LTI_TEXT)
+    {
+      last->text.len += text_len;
+    }
+  else
+    {
+      LogTemplateInstr instr = { .op = LTI_TEXT };
+
+      instr.text.ofs = literals->len;
+      instr.text.len = text_len;
+      g_array_append_val(instrs, instr);
+    }
+  g_string_append_len(literals, text, text_len);
+}
+
+static void
+_append_elem(LogTemplateProgram *self, GArray *instrs, LogTemplateElem *e)
+{
+  LogTemplateInstr instr = { .msg_ref = e->msg_ref, .default_value = e->default_value };
+
+  switch (e->type)
+    {
+    case LTE_VALUE:
+    {
+      guint16 flags = nv_registry_get_handle_flags(logmsg_registry, e->value_handle);
+
+      if (flags & LM_VF_MACRO)
+        {
+          instr.op = LTI_VALUE_MACRO;
+          instr.macro = flags >> 8;
+        }
+      else
+        {
+          instr.op = LTI_VALUE;
+          instr.value_handle = e->value_handle;
+        }
+      break;
+    }
+    case LTE_MACRO:
+      instr.op = LTI_MACRO;
+      instr.macro = e->macro;
+      break;
+    case LTE_FUNC:
+      instr.op = LTI_FUNC;
+      instr.func_elem = e;
+      break;
+    default:
+      g_assert_not_reached();
+      break;
+    }
+  g_array_append_val(instrs, instr);
+  self->expected_len += LOG_TEMPLATE_EXPECTED_VALUE_LEN;
+}
+
+void
+log_template_program_build(LogTemplateProgram *self, GList *compiled_template)
+{
+  GArray *instrs = g_array_new(FALSE, TRUE, sizeof(LogTemplateInstr));
+  GString *literals = g_string_sized_new(64);
+  GList *p;
+
+  log_template_program_clear(self);
+  for (p = compiled_template; p; p = g_list_next(p))
+    {
+      LogTemplateElem *e = (LogTemplateElem *) p->data;
+
+      _append_text(self, instrs, literals, e->text, e->text_len);
+      if (!_elem_is_pure_text(e))
+        _append_elem(self, instrs, e);
+    }
+
+  self->expected_len += literals->len;
+  self->num_instrs = instrs->len;
+  self->instrs = (LogTemplateInstr *) g_array_free(instrs, FALSE);
+  self->literals = g_string_free(literals, FALSE);
+}
+
+void
+log_template_program_clear(LogTemplateProgram *self)
+{
+  g_free(self->instrs);
+  g_free(self->literals);
+  memset(self, 0, sizeof(*self));
+}
@@ -25,6 +25,7 @@
 #ifndef TEMPLATE_REPR_H_INCLUDED
 #define TEMPLATE_REPR_H_INCLUDED
 
+#include "template/templates.h"
 #include "template/function.h"
 #include "logmsg/logmsg.h"
 
@@ -56,5 +57,40 @@ typedef struct _LogTemplateElem
 
 void log_template_elem_free_list(GList *el);
 
+/* The compiled list of LogTemplateElem instances is flattened into a
+ * contiguous array of instructions before use: adjacent literals are
+ * merged into a single LTI_TEXT instruction and name-value pairs backed
+ * by macros are resolved to their macro id, so that expansion needs
+ * neither list traversal nor registry lookups. */
+enum
+{
+  LTI_TEXT,
+  LTI_VALUE,
+  LTI_VALUE_MACRO,
+  LTI_MACRO,
+  LTI_FUNC
+};
+
+struct _LogTemplateInstr
+{
+  guint8 op;
+  guint16 msg_ref;
+  union
+  {
+    struct
+    {
+      guint32 ofs;
+      guint32 len;
+    } text;
+    guint macro;
+    NVHandle value_handle;
+    LogTemplateElem *func_elem;
+  };
+  const gchar *default_value;
+};
+
+void log_template_program_build(LogTemplateProgram *self, GList *compiled_template);
+void log_template_program_clear(LogTemplateProgram *self);
+
 
 #endif
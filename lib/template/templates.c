@@ -27,14 +27,42 @@
 #include "template/macros.h"
 #include "template/escaping.h"
 #include "cfg.h"
+#include "mainloop-worker.h"
 
 static void
 log_template_reset_compiled(LogTemplate *self)
 {
+  log_template_program_clear(&self->program);
   log_template_elem_free_list(self->compiled_template);
   self->compiled_template = NULL;
 }
 
+static gboolean
+log_template_has_functions(LogTemplate *self)
+{
+  gint i;
+
+  for (i = 0; i < self->program.num_instrs; i++)
+    {
+      if (self->program.instrs[i].op == LTI_FUNC)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+static void
+log_template_free_arg_bufs(GPtrArray *arg_bufs)
+{
+  gint i;
+
+  if (!arg_bufs)
+    return;
+
+  for (i = 0; i < arg_bufs->len; i++)
+    g_string_free(g_ptr_array_index(arg_bufs, i), TRUE);
+  g_ptr_array_free(arg_bufs, TRUE);
+}
+
 gboolean
 log_template_compile(LogTemplate *self, const gchar *template, GError **error)
 {
@@ -51,6 +79,13 @@ log_template_compile(LogTemplate *self, const gchar *template, GError **error)
   log_template_compiler_init(&compiler, self);
   result = log_template_compiler_compile(&compiler, &self->compiled_template, error);
   log_template_compiler_clear(&compiler);
+
+  log_template_program_build(&self->program, self->compiled_template);
+
+  /* allocated at compile time, so that worker threads can use their own
+   * slot without any locking */
+  if (!self->thread_arg_bufs && log_template_has_functions(self))
+    self->thread_arg_bufs = g_new0(GPtrArray *, main_loop_worker_get_max_number_of_thread_ids());
   return result;
 }
 
@@ -69,24 +104,66 @@ log_template_set_type_hint(LogTemplate *self, const gchar *type_hint, GError **e
 }
 
 
+static void
+log_template_invoke_function(LogTemplateElem *e, GPtrArray *arg_bufs, LogMessage **messages, gint num_messages,
+                             gint msg_ndx, const LogTemplateOptions *opts, gint tz, gint32 seq_num,
+                             const gchar *context_id, GString *result)
+{
+  LogTemplateInvokeArgs args =
+  {
+    arg_bufs,
+    e->msg_ref ? &messages[msg_ndx] : messages,
+    e->msg_ref ? 1 : num_messages,
+    opts,
+    tz,
+    seq_num,
+    context_id
+  };
+
+  /* if a function call is called with an msg_ref, we only
+   * pass that given logmsg to argument resolution, otherwise
+   * we pass the whole set so the arguments can individually
+   * specify which message they want to resolve from
+   */
+  if (e->func.ops->eval)
+    e->func.ops->eval(e->func.ops, e->func.state, &args);
+  e->func.ops->call(e->func.ops, e->func.state, &args, result);
+}
+
+static inline void
+log_template_reserve_output(LogTemplate *self, GString *result)
+{
+  gsize required_len = result->len + self->program.expected_len;
+
+  if (result->allocated_len <= required_len)
+    {
+      gsize len = result->len;
+
+      g_string_set_size(result, required_len);
+      g_string_truncate(result, len);
+    }
+}
+
 void
 log_template_append_format_with_context(LogTemplate *self, LogMessage **messages, gint num_messages,
                                         const LogTemplateOptions *opts, gint tz, gint32 seq_num, const gchar *context_id, GString *result)
 {
-  GList *p;
-  LogTemplateElem *e;
+  const LogTemplateProgram *program = &self->program;
+  gint i;
 
   if (!opts)
     opts = &self->cfg->template_options;
 
-  for (p = self->compiled_template; p; p = g_list_next(p))
+  log_template_reserve_output(self, result);
+  for (i = 0; i < program->num_instrs; i++)
     {
+      const LogTemplateInstr *instr = &program->instrs[i];
       gint msg_ndx;
 
-      e = (LogTemplateElem *) p->data;
-      if (e->text)
+      if (instr->op == LTI_TEXT)
         {
-          g_string_append_len(result, e->text, e->text_len);
+          g_string_append_len(result, program->literals + instr->text.ofs, instr->text.len);
+          continue;
         }
 
       /* NOTE: msg_ref is 1 larger than the index specified by the user in
@@ -95,71 +172,66 @@ log_template_append_format_with_context(LogTemplate *self, LogMessage **messages
        *
        * msg_ref == 0 means that the user didn't specify msg_ref
        * msg_ref >= 1 means that the user supplied the given msg_ref, 1 is equal to @0 */
-      if (e->msg_ref > num_messages)
+      if (instr->msg_ref > num_messages)
         continue;
-      msg_ndx = num_messages - e->msg_ref;
+      msg_ndx = num_messages - instr->msg_ref;
 
       /* value and macro can't understand a context, assume that no msg_ref means @0 */
-      if (e->msg_ref == 0)
+      if (instr->msg_ref == 0)
         msg_ndx--;
 
-      switch (e->type)
+      switch (instr->op)
         {
-        case LTE_VALUE:
+        case LTI_VALUE:
+        case LTI_VALUE_MACRO:
         {
           const gchar *value = NULL;
           gssize value_len = -1;
 
-          value = log_msg_get_value(messages[msg_ndx], e->value_handle, &value_len);
+          if (instr->op == LTI_VALUE)
+            value = nv_table_get_value(messages[msg_ndx]->payload, instr->value_handle, &value_len);
+          else
+            value = log_msg_get_macro_value(messages[msg_ndx], instr->macro, &value_len);
+
           if (value && value[0])
             result_append(result, value, value_len, self->escape);
-          else if (e->default_value)
-            result_append(result, e->default_value, -1, self->escape);
+          else if (instr->default_value)
+            result_append(result, instr->default_value, -1, self->escape);
           break;
         }
-        case LTE_MACRO:
+        case LTI_MACRO:
         {
           gint len = result->len;
 
-          if (e->macro)
-            {
-              log_macro_expand(result, e->macro, self->escape, opts ? opts : &self->cfg->template_options, tz, seq_num, context_id,
-                               messages[msg_ndx]);
-              if (len == result->len && e->default_value)
-                g_string_append(result, e->default_value);
-            }
+          log_macro_expand(result, instr->macro, self->escape, opts ? opts : &self->cfg->template_options, tz, seq_num, context_id,
+                           messages[msg_ndx]);
+          if (len == result->len && instr->default_value)
+            g_string_append(result, instr->default_value);
           break;
         }
-        case LTE_FUNC:
+        case LTI_FUNC:
         {
-          g_static_mutex_lock(&self->arg_lock);
-          if (!self->arg_bufs)
-            self->arg_bufs = g_ptr_array_sized_new(0);
+          LogTemplateElem *e = instr->func_elem;
+          gint thread_id = main_loop_worker_get_thread_id();
+
+          if (self->thread_arg_bufs && thread_id >= 0 && thread_id < main_loop_worker_get_max_number_of_thread_ids())
+            {
+              GPtrArray **arg_bufs = &self->thread_arg_bufs[thread_id];
 
-          if (1)
+              if (!(*arg_bufs))
+                *arg_bufs = g_ptr_array_sized_new(0);
+              log_template_invoke_function(e, *arg_bufs, messages, num_messages, msg_ndx,
+                                           opts, tz, seq_num, context_id, result);
+            }
+          else
             {
-              LogTemplateInvokeArgs args =
-              {
-                self->arg_bufs,
-                e->msg_ref ? &messages[msg_ndx] : messages,
-                e->msg_ref ? 1 : num_messages,
-                opts,
-                tz,
-                seq_num,
-                context_id
-              };
-
-
-              /* if a function call is called with an msg_ref, we only
-               * pass that given logmsg to argument resolution, otherwise
-               * we pass the whole set so the arguments can individually
-               * specify which message they want to resolve from
-               */
-              if (e->func.ops->eval)
-                e->func.ops->eval(e->func.ops, e->func.state, &args);
-              e->func.ops->call(e->func.ops, e->func.state, &args, result);
+              g_static_mutex_lock(&self->arg_lock);
+              if (!self->arg_bufs)
+                self->arg_bufs = g_ptr_array_sized_new(0);
+              log_template_invoke_function(e, self->arg_bufs, messages, num_messages, msg_ndx,
+                                           opts, tz, seq_num, context_id, result);
+              g_static_mutex_unlock(&self->arg_lock);
             }
-          g_static_mutex_unlock(&self->arg_lock);
           break;
         }
         default:
@@ -239,14 +311,15 @@ log_template_new(GlobalConfig *cfg, const gchar *name)
 static void
 log_template_free(LogTemplate *self)
 {
-  if (self->arg_bufs)
+  if (self->thread_arg_bufs)
     {
       gint i;
 
-      for (i = 0; i < self->arg_bufs->len; i++)
-        g_string_free(g_ptr_array_index(self->arg_bufs, i), TRUE);
-      g_ptr_array_free(self->arg_bufs, TRUE);
+      for (i = 0; i < main_loop_worker_get_max_number_of_thread_ids(); i++)
+        log_template_free_arg_bufs(self->thread_arg_bufs[i]);
+      g_free(self->thread_arg_bufs);
     }
+  log_template_free_arg_bufs(self->arg_bufs);
   log_template_reset_compiled(self);
   g_free(self->name);
   g_free(self->template);
@@ -53,6 +53,18 @@ typedef enum
   ON_ERROR_SILENT              = 0x08
 } LogTemplateOnError;
 
+typedef struct _LogTemplateInstr LogTemplateInstr;
+
+/* executable form of compiled_template, see template/repr.h */
+typedef struct _LogTemplateProgram
+{
+  LogTemplateInstr *instrs;
+  gint num_instrs;
+  gchar *literals;
+  /* estimated length of the expanded template, used to pre-size the output */
+  gsize expected_len;
+} LogTemplateProgram;
+
 /* structure that represents an expandable syslog-ng template */
 typedef struct _LogTemplate
 {
@@ -60,9 +72,13 @@ typedef struct _LogTemplate
   gchar *name;
   gchar *template;
   GList *compiled_template;
+  LogTemplateProgram program;
   gboolean escape;
   gboolean def_inline;
   GlobalConfig *cfg;
+  /* argument buffers of template functions, indexed by worker thread id,
+   * arg_bufs protected by arg_lock is used by non-worker threads */
+  GPtrArray **thread_arg_bufs;
   GStaticMutex arg_lock;
   GPtrArray *arg_bufs;
   TypeHint type_hint;
@@ -34,6 +34,7 @@
 #include "cfg.h"
 #include "timeutils.h"
 #include "plugin.h"
+#include "mainloop-worker.h"
 
 #include <time.h>
 #include <stdlib.h>
@@ -51,9 +52,15 @@ format_template_thread(gpointer s)
   LogMessage *msg = args[0];
   LogTemplate *templ = args[1];
   const gchar *expected = args[2];
+  gint thread_id = GPOINTER_TO_INT(args[3]);
   GString *result;
   gint i;
 
+  /* emulate worker threads in half of the threads, the rest uses the
+   * shared, locked argument buffers */
+  if (thread_id % 2 == 0)
+    main_loop_worker_set_thread_id(thread_id);
+
   g_mutex_lock(thread_lock);
   while (!thread_start)
     g_cond_wait(thread_ping, thread_lock);
@@ -74,23 +81,23 @@ assert_template_format_multi_thread(const gchar *template, const gchar *expected
 {
   LogTemplate *templ;
   LogMessage *msg;
-  gpointer args[3];
+  gpointer args[16][4];
   GThread *threads[16];
   gint i;
 
   msg = create_sample_message();
   templ = compile_template(template, FALSE);
-  args[0] = msg;
-  args[1] = templ;
-  args[2] = (gpointer) expected;
 
   thread_start = FALSE;
   thread_ping = g_cond_new();
   thread_lock = g_mutex_new();
-  args[1] = templ;
   for (i = 0; i < 16; i++)
     {
-      threads[i] = g_thread_create(format_template_thread, args, TRUE, NULL);
+      args[i][0] = msg;
+      args[i][1] = templ;
+      args[i][2] = (gpointer) expected;
+      args[i][3] = GINT_TO_POINTER(i);
+      threads[i] = g_thread_create(format_template_thread, args[i], TRUE, NULL);
     }
 
   thread_start = TRUE;
@@ -406,6 +406,41 @@ test_template_compile_func(void)
   TEMPLATE_TESTCASE(test_qouted_string_in_name_template_function);
 }
 
+static void
+test_literals_are_stored_as_text_instructions_in_the_program(void)
+{
+  assert_template_compile("foo $$ ${MESSAGE} bar");
+
+  assert_gint(template->program.num_instrs, 3, ASSERTION_ERROR("Bad number of program instructions"));
+  assert_gint(template->program.instrs[0].op, LTI_TEXT, ASSERTION_ERROR("Bad instruction"));
+  assert_nstring(template->program.literals + template->program.instrs[0].text.ofs, template->program.instrs[0].text.len,
+                 "foo $ ", -1, ASSERTION_ERROR("Bad literal"));
+  assert_gint(template->program.instrs[1].op, LTI_MACRO, ASSERTION_ERROR("Bad instruction"));
+  assert_gint(template->program.instrs[1].macro, M_MESSAGE, ASSERTION_ERROR("Bad macro id"));
+  assert_gint(template->program.instrs[2].op, LTI_TEXT, ASSERTION_ERROR("Bad instruction"));
+  assert_nstring(template->program.literals + template->program.instrs[2].text.ofs, template->program.instrs[2].text.len,
+                 " bar", -1, ASSERTION_ERROR("Bad literal"));
+}
+
+static void
+test_value_and_function_instructions_in_the_program(void)
+{
+  assert_template_compile("${VALUE_NAME}$(hello)");
+
+  assert_gint(template->program.num_instrs, 2, ASSERTION_ERROR("Bad number of program instructions"));
+  assert_gint(template->program.instrs[0].op, LTI_VALUE, ASSERTION_ERROR("Bad instruction"));
+  assert_gint(template->program.instrs[0].value_handle, log_msg_get_value_handle("VALUE_NAME"),
+              ASSERTION_ERROR("Bad value handle"));
+  assert_gint(template->program.instrs[1].op, LTI_FUNC, ASSERTION_ERROR("Bad instruction"));
+}
+
+static void
+test_template_compile_program(void)
+{
+  TEMPLATE_TESTCASE(test_literals_are_stored_as_text_instructions_in_the_program);
+  TEMPLATE_TESTCASE(test_value_and_function_instructions_in_the_program);
+}
+
 static void
 test_invalid_macro(void)
 {
@@ -482,6 +517,7 @@ int main(int argc, char **argv)
   test_template_compile_macro();
   test_template_compile_value();
   test_template_compile_func();
+  test_template_compile_program();
   test_template_compile_negativ_tests();
 
   log_msg_registry_deinit();
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "ack_tracker.h"
+#include "bookmark.h"
+#include "logsource.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "logmsg/logmsg.h"
+
+#include <iv.h>
+
+static GlobalConfig *cfg;
+static LogSourceOptions source_options;
+static LogSource *source;
+static gint num_saves;
+static gint last_saved_position;
+
+static void
+_save_bookmark(Bookmark *bookmark)
+{
+  num_saves++;
+  last_saved_position = *(gint *) &bookmark->container;
+}
+
+static void
+_create_source(gint batch_size, gint batch_timeout)
+{
+  log_source_options_defaults(&source_options);
+  source_options.init_window_size = 100;
+  source_options.bookmark_batch_size = batch_size;
+  source_options.bookmark_batch_timeout = batch_timeout;
+  log_source_options_init(&source_options, cfg, "test");
+
+  source = g_new0(LogSource, 1);
+  log_source_init_instance(source, cfg);
+  log_source_set_options(source, &source_options, "test", "test", FALSE, TRUE, NULL);
+}
+
+/* the source has no next pipe, so the message is acked as soon as it is posted */
+static void
+_post_message(gint position)
+{
+  Bookmark *bookmark = ack_tracker_request_bookmark(source->ack_tracker);
+
+  bookmark->save = _save_bookmark;
+  *(gint *) &bookmark->container = position;
+  log_source_post(source, log_msg_new_empty());
+}
+
+static void
+_quit(gpointer user_data)
+{
+  iv_quit();
+}
+
+static void
+_run_main_loop(gint msec)
+{
+  struct iv_timer quit_timer;
+
+  IV_TIMER_INIT(&quit_timer);
+  quit_timer.handler = _quit;
+  iv_validate_now();
+  quit_timer.expires = iv_now;
+  timespec_add_msec(&quit_timer.expires, msec);
+  iv_timer_register(&quit_timer);
+
+  iv_main();
+}
+
+Test(late_ack_tracker, bookmark_is_saved_on_every_ack_by_default)
+{
+  _create_source(0, 0);
+  cr_assert(log_pipe_init(&source->super));
+
+  _post_message(1);
+  cr_assert_eq(num_saves, 1);
+  _post_message(2);
+  cr_assert_eq(num_saves, 2);
+  cr_assert_eq(last_saved_position, 2);
+
+  log_pipe_deinit(&source->super);
+  log_pipe_unref(&source->super);
+}
+
+Test(late_ack_tracker, bookmark_is_saved_after_batch_size_acks)
+{
+  _create_source(3, 0);
+  cr_assert(log_pipe_init(&source->super));
+
+  _post_message(1);
+  _post_message(2);
+  cr_assert_eq(num_saves, 0);
+  _post_message(3);
+  cr_assert_eq(num_saves, 1);
+  cr_assert_eq(last_saved_position, 3);
+
+  log_pipe_deinit(&source->super);
+  log_pipe_unref(&source->super);
+}
+
+Test(late_ack_tracker, unsaved_bookmark_is_saved_on_deinit)
+{
+  _create_source(100, 0);
+  cr_assert(log_pipe_init(&source->super));
+
+  _post_message(1);
+  _post_message(2);
+  cr_assert_eq(num_saves, 0);
+
+  log_pipe_deinit(&source->super);
+  cr_assert_eq(num_saves, 1);
+  cr_assert_eq(last_saved_position, 2);
+
+  log_pipe_unref(&source->super);
+  cr_assert_eq(num_saves, 1);
+}
+
+Test(late_ack_tracker, bookmark_acked_after_deinit_is_saved_right_away)
+{
+  _create_source(100, 0);
+  cr_assert(log_pipe_init(&source->super));
+  log_pipe_deinit(&source->super);
+
+  _post_message(1);
+  cr_assert_eq(num_saves, 1);
+  cr_assert_eq(last_saved_position, 1);
+
+  log_pipe_unref(&source->super);
+  cr_assert_eq(num_saves, 1);
+}
+
+Test(late_ack_tracker, idle_source_saves_its_bookmark_after_batch_timeout)
+{
+  _create_source(100, 50);
+  cr_assert(log_pipe_init(&source->super));
+
+  _post_message(1);
+  _post_message(2);
+  cr_assert_eq(num_saves, 0);
+
+  _run_main_loop(500);
+  cr_assert_eq(num_saves, 1, "the bookmark was not saved by the batch timeout timer");
+  cr_assert_eq(last_saved_position, 2);
+
+  log_pipe_deinit(&source->super);
+  cr_assert_eq(num_saves, 1);
+  log_pipe_unref(&source->super);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  cfg = cfg_new_snippet();
+  num_saves = 0;
+  last_saved_position = 0;
+}
+
+static void
+teardown(void)
+{
+  log_source_options_destroy(&source_options);
+  cfg_free(cfg);
+  app_shutdown();
+}
+
+TestSuite(late_ack_tracker, .init = setup, .fini = teardown);
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "logreader-workers.h"
+#include "mainloop-worker.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "cfg-lexer.h"
+#include "cfg-parser.h"
+#include "cfg-grammar.h"
+#include "timeutils.h"
+
+#include <string.h>
+
+#define MAX_ITEMS 1000
+#define CALLER_THREAD_ID 3
+
+typedef struct _TestItem
+{
+  gint times_processed;
+  gint thread_id;
+} TestItem;
+
+static TestItem items[MAX_ITEMS];
+static gpointer item_ptrs[MAX_ITEMS];
+
+static void
+_process_item(gpointer s, gpointer user_data)
+{
+  TestItem *item = (TestItem *) s;
+
+  g_atomic_int_inc(&item->times_processed);
+  item->thread_id = main_loop_worker_get_thread_id();
+}
+
+static void
+_reset_items(void)
+{
+  gint i;
+
+  memset(items, 0, sizeof(items));
+  for (i = 0; i < MAX_ITEMS; i++)
+    item_ptrs[i] = &items[i];
+}
+
+static void
+_assert_each_item_processed_once(gint num_items)
+{
+  gint i;
+
+  for (i = 0; i < num_items; i++)
+    cr_assert_eq(items[i].times_processed, 1, "item %d was processed %d times", i, items[i].times_processed);
+  for (; i < MAX_ITEMS; i++)
+    cr_assert_eq(items[i].times_processed, 0, "item %d outside of the batch was processed", i);
+}
+
+static void
+_run_batch(gint num_workers, gint num_items)
+{
+  LogReaderWorkers *workers = log_reader_workers_new(num_workers);
+
+  _reset_items();
+  log_reader_workers_run(workers, _process_item, NULL, item_ptrs, num_items);
+  _assert_each_item_processed_once(num_items);
+  log_reader_workers_free(workers);
+}
+
+Test(logreader_workers, each_item_is_processed_exactly_once)
+{
+  gint num_items[] = { 0, 1, 2, 3, 5, 7, 100, MAX_ITEMS };
+  gint num_workers[] = { 0, 1, 4 };
+  gint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS(num_workers); i++)
+    for (j = 0; j < G_N_ELEMENTS(num_items); j++)
+      _run_batch(num_workers[i], num_items[j]);
+}
+
+Test(logreader_workers, worker_threads_have_no_main_loop_worker_thread_id)
+{
+  LogReaderWorkers *workers = log_reader_workers_new(4);
+  gint i;
+
+  main_loop_worker_set_thread_id(CALLER_THREAD_ID);
+  _reset_items();
+  log_reader_workers_run(workers, _process_item, NULL, item_ptrs, MAX_ITEMS);
+  _assert_each_item_processed_once(MAX_ITEMS);
+
+  /* the caller processes the first chunk */
+  cr_assert_eq(items[0].thread_id, CALLER_THREAD_ID);
+  for (i = 0; i < MAX_ITEMS; i++)
+    cr_assert(items[i].thread_id == CALLER_THREAD_ID || items[i].thread_id < 0,
+              "item %d was processed on a thread with a worker thread id: %d", i, items[i].thread_id);
+
+  log_reader_workers_free(workers);
+}
+
+#define NUM_CONCURRENT_READERS 4
+#define NUM_BATCHES 200
+#define ITEMS_PER_READER (MAX_ITEMS / NUM_CONCURRENT_READERS)
+
+typedef struct _ReaderArgs
+{
+  LogReaderWorkers *workers;
+  gint first;
+} ReaderArgs;
+
+static gpointer
+_run_batches(gpointer s)
+{
+  ReaderArgs *args = (ReaderArgs *) s;
+  gint i;
+
+  for (i = 0; i < NUM_BATCHES; i++)
+    log_reader_workers_run(args->workers, _process_item, NULL, &item_ptrs[args->first], ITEMS_PER_READER);
+  return NULL;
+}
+
+Test(logreader_workers, concurrent_readers_can_share_the_workers)
+{
+  LogReaderWorkers *workers = log_reader_workers_new(4);
+  ReaderArgs args[NUM_CONCURRENT_READERS];
+  GThread *threads[NUM_CONCURRENT_READERS];
+  gint i;
+
+  _reset_items();
+  for (i = 0; i < NUM_CONCURRENT_READERS; i++)
+    {
+      args[i].workers = workers;
+      args[i].first = i * ITEMS_PER_READER;
+      threads[i] = g_thread_create(_run_batches, &args[i], TRUE, NULL);
+    }
+  for (i = 0; i < NUM_CONCURRENT_READERS; i++)
+    g_thread_join(threads[i]);
+
+  for (i = 0; i < NUM_CONCURRENT_READERS * ITEMS_PER_READER; i++)
+    cr_assert_eq(items[i].times_processed, NUM_BATCHES, "item %d was processed %d times", i, items[i].times_processed);
+
+  log_reader_workers_free(workers);
+}
+
+static gint
+_lex_keyword(CfgLexerKeyword *context_keywords, const gchar *input)
+{
+  GlobalConfig *cfg = cfg_new_snippet();
+  CfgLexer *lexer = cfg_lexer_new_buffer(cfg, input, strlen(input));
+  YYSTYPE yylval;
+  YYLTYPE yylloc;
+  gint token;
+
+  memset(&yylval, 0, sizeof(yylval));
+  memset(&yylloc, 0, sizeof(yylloc));
+  yylloc.level = &lexer->include_stack[0];
+
+  cfg_lexer_push_context(lexer, LL_CONTEXT_ROOT, main_parser.keywords, "config");
+  if (context_keywords)
+    cfg_lexer_push_context(lexer, LL_CONTEXT_ROOT, context_keywords, "parallelize options");
+  token = cfg_lexer_lex(lexer, &yylval, &yylloc);
+  if (yylval.type)
+    cfg_lexer_free_token(&yylval);
+
+  cfg_lexer_free(lexer);
+  cfg_free(cfg);
+  return token;
+}
+
+Test(logreader_workers, workers_is_a_keyword_only_within_parallelize)
+{
+  cr_assert_eq(_lex_keyword(NULL, "workers"), LL_IDENTIFIER);
+  cr_assert_eq(_lex_keyword(NULL, "parallelize"), KW_PARALLELIZE);
+  cr_assert_eq(_lex_keyword(parallelize_keywords, "workers"), KW_WORKERS);
+}
+
+static void
+_benchmark_item(gpointer s, gpointer user_data)
+{
+  TestItem *item = (TestItem *) s;
+  gint i;
+
+  /* roughly the cost of parsing a short message */
+  for (i = 0; i < 200; i++)
+    item->thread_id = item->thread_id * 31 + i;
+}
+
+Test(logreader_workers, test_run_benchmark)
+{
+  gint num_workers[] = { 0, 1, 4 };
+  GTimeVal start, end;
+  gint i, j;
+
+  _reset_items();
+  for (i = 0; i < G_N_ELEMENTS(num_workers); i++)
+    {
+      LogReaderWorkers *workers = log_reader_workers_new(num_workers[i]);
+
+      g_get_current_time(&start);
+      for (j = 0; j < 10000; j++)
+        log_reader_workers_run(workers, _benchmark_item, NULL, item_ptrs, 100);
+      g_get_current_time(&end);
+
+      printf("LogReaderWorkers with %d workers: %8.2f usec/batch of 100 items\n",
+             num_workers[i], g_time_val_diff(&end, &start) / 10000.0);
+      log_reader_workers_free(workers);
+    }
+}
+
+static void
+setup(void)
+{
+  app_startup();
+}
+
+static void
+teardown(void)
+{
+  main_loop_worker_set_thread_id(-1);
+  app_shutdown();
+}
+
+TestSuite(logreader_workers, .init = setup, .fini = teardown);
@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "logthrdestdrv.h"
+#include "mainloop-call.h"
+#include "mainloop-worker.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "logmsg/logmsg.h"
+#include "logqueue.h"
+#include "stats/stats.h"
+#include "timeutils.h"
+
+#include <iv.h>
+
+#define MAX_FLUSHES 16
+#define MAX_INSERTS 16
+#define TEST_TIMEOUT_MSEC 5000
+#define NEVER_DUE_TIMEOUT 600000
+
+/* the driver callbacks run in the worker thread, the tests only read the
+ * counters, with g_atomic_int_get() */
+typedef struct _TestDriver
+{
+  LogThrDestDriver super;
+
+  worker_insert_result_t insert_result;
+  worker_insert_result_t flush_result;
+  /* flush() returns WORKER_INSERT_RESULT_ERROR this many times first */
+  gint flush_errors_left;
+  /* the number of messages a failing flush() accepts from the batch head */
+  gint flush_errors_accepted_head;
+
+  gint num_inserts;
+  gint32 inserted_seq_nums[MAX_INSERTS];
+  gint num_flushes;
+  gint flushed_batch_sizes[MAX_FLUSHES];
+  gint num_connects;
+  GTimeVal last_connect;
+  GTimeVal last_flush_error;
+  gint num_retry_over;
+} TestDriver;
+
+static GlobalConfig *cfg;
+static StatsOptions stats_options;
+static TestDriver *driver;
+
+static gboolean
+_connect(LogThrDestDriver *s)
+{
+  TestDriver *self = (TestDriver *) s;
+
+  g_get_current_time(&self->last_connect);
+  g_atomic_int_inc(&self->num_connects);
+  return TRUE;
+}
+
+static worker_insert_result_t
+_insert(LogThrDestDriver *s, LogMessage *msg)
+{
+  TestDriver *self = (TestDriver *) s;
+  gint i = g_atomic_int_get(&self->num_inserts);
+
+  if (i < MAX_INSERTS)
+    self->inserted_seq_nums[i] = s->seq_num;
+  g_atomic_int_inc(&self->num_inserts);
+  return self->insert_result;
+}
+
+static worker_insert_result_t
+_flush(LogThrDestDriver *s)
+{
+  TestDriver *self = (TestDriver *) s;
+  gint i = g_atomic_int_get(&self->num_flushes);
+
+  if (i < MAX_FLUSHES)
+    self->flushed_batch_sizes[i] = s->batch_size;
+  g_atomic_int_inc(&self->num_flushes);
+
+  if (self->flush_errors_left > 0)
+    {
+      self->flush_errors_left--;
+      g_get_current_time(&self->last_flush_error);
+      log_threaded_dest_driver_accept_batch_head(s, self->flush_errors_accepted_head);
+
+      /* as if a new message had woken the worker up in the meantime */
+      if (!iv_task_registered(&s->do_work))
+        iv_task_register(&s->do_work);
+      return WORKER_INSERT_RESULT_ERROR;
+    }
+  return self->flush_result;
+}
+
+static void
+_retry_over(LogThrDestDriver *s, LogMessage *msg)
+{
+  TestDriver *self = (TestDriver *) s;
+
+  g_atomic_int_inc(&self->num_retry_over);
+}
+
+static const gchar *
+_generate_persist_name(const LogPipe *s)
+{
+  return "test_threaded_dd";
+}
+
+static gchar *
+_format_stats_instance(LogThrDestDriver *s)
+{
+  return "test_threaded_dd";
+}
+
+static gboolean
+_init(LogPipe *s)
+{
+  if (!log_dest_driver_init_method(s))
+    return FALSE;
+
+  return log_threaded_dest_driver_start(s);
+}
+
+static LogPipe *
+_driver_pipe(void)
+{
+  return &driver->super.super.super.super;
+}
+
+static void
+_create_driver(gint batch_lines, gint batch_timeout, gint max_retries)
+{
+  driver = g_new0(TestDriver, 1);
+  log_threaded_dest_driver_init_instance(&driver->super, cfg);
+
+  driver->super.super.super.super.init = _init;
+  driver->super.super.super.super.generate_persist_name = _generate_persist_name;
+  driver->super.super.super.group = g_strdup("test");
+  driver->super.super.super.id = g_strdup("test_threaded_dd");
+  driver->super.format.stats_instance = _format_stats_instance;
+  driver->super.worker.connect = _connect;
+  driver->super.worker.insert = _insert;
+  driver->super.worker.flush = _flush;
+  driver->super.messages.retry_over = _retry_over;
+  driver->super.time_reopen = 1;
+
+  driver->insert_result = WORKER_INSERT_RESULT_QUEUED;
+  driver->flush_result = WORKER_INSERT_RESULT_SUCCESS;
+
+  log_threaded_dest_driver_set_batch_lines(&driver->super.super.super, batch_lines);
+  log_threaded_dest_driver_set_batch_timeout(&driver->super.super.super, batch_timeout);
+  log_threaded_dest_driver_set_max_retries(&driver->super.super.super, max_retries);
+}
+
+static void
+_start_driver(void)
+{
+  cr_assert(log_pipe_init(_driver_pipe()));
+}
+
+static void
+_quit_main_loop(gpointer user_data)
+{
+  iv_quit();
+}
+
+static void
+_workers_stopped(gpointer user_data)
+{
+  static struct iv_task quit_task;
+
+  /* runs after the task that reenables the worker jobs */
+  IV_TASK_INIT(&quit_task);
+  quit_task.handler = _quit_main_loop;
+  iv_task_register(&quit_task);
+}
+
+/* the worker thread flushes or rewinds the pending batch while stopping */
+static void
+_stop_driver(void)
+{
+  main_loop_worker_sync_call(_workers_stopped, NULL);
+  iv_main();
+
+  cr_assert(log_pipe_deinit(_driver_pipe()));
+}
+
+static void
+_free_driver(void)
+{
+  log_pipe_unref(_driver_pipe());
+}
+
+static void
+_queue_messages(gint num_messages)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gint i;
+
+  for (i = 0; i < num_messages; i++)
+    log_pipe_queue(_driver_pipe(), log_msg_new_empty(), &path_options);
+}
+
+static gboolean
+_wait_for_counter(gint *counter, gint value)
+{
+  gint i;
+
+  for (i = 0; i < TEST_TIMEOUT_MSEC / 10; i++)
+    {
+      if (g_atomic_int_get(counter) >= value)
+        return TRUE;
+      g_usleep(10000);
+    }
+  return FALSE;
+}
+
+static gboolean
+_wait_for_written_messages(gsize value)
+{
+  gint i;
+
+  for (i = 0; i < TEST_TIMEOUT_MSEC / 10; i++)
+    {
+      if (stats_counter_get(driver->super.written_messages) >= value)
+        return TRUE;
+      g_usleep(10000);
+    }
+  return FALSE;
+}
+
+Test(logthrdestdrv, batch_is_flushed_when_batch_lines_is_reached)
+{
+  _create_driver(2, NEVER_DUE_TIMEOUT, 3);
+  _start_driver();
+
+  _queue_messages(4);
+  cr_assert(_wait_for_counter(&driver->num_flushes, 2));
+  cr_assert_eq(driver->flushed_batch_sizes[0], 2);
+  cr_assert_eq(driver->flushed_batch_sizes[1], 2);
+
+  _queue_messages(1);
+  cr_assert(_wait_for_counter(&driver->num_inserts, 5));
+  g_usleep(100000);
+  cr_assert_eq(g_atomic_int_get(&driver->num_flushes), 2, "an incomplete batch was flushed before batch-timeout()");
+
+  _stop_driver();
+  cr_assert_eq(driver->num_flushes, 3, "the pending batch was not flushed when the worker stopped");
+  cr_assert_eq(driver->flushed_batch_sizes[2], 1);
+
+  _free_driver();
+}
+
+Test(logthrdestdrv, idle_batch_is_flushed_after_batch_timeout)
+{
+  _create_driver(100, 50, 3);
+  _start_driver();
+
+  _queue_messages(2);
+  cr_assert(_wait_for_counter(&driver->num_flushes, 1), "the batch was not flushed by the batch-timeout() timer");
+  cr_assert_eq(driver->flushed_batch_sizes[0], 2);
+
+  _stop_driver();
+  cr_assert_eq(driver->num_flushes, 1);
+  _free_driver();
+}
+
+Test(logthrdestdrv, failed_flush_is_retried_after_time_reopen)
+{
+  glong reconnect_delay_msec;
+
+  _create_driver(100, 50, 3);
+  driver->flush_errors_left = 1;
+  _start_driver();
+
+  _queue_messages(1);
+  cr_assert(_wait_for_counter(&driver->num_flushes, 1));
+
+  g_usleep(500000);
+  cr_assert_eq(g_atomic_int_get(&driver->num_connects), 1, "reconnected before time-reopen() elapsed");
+
+  cr_assert(_wait_for_counter(&driver->num_flushes, 2), "the rewound batch was not retried");
+  cr_assert_eq(driver->num_connects, 2);
+  cr_assert_eq(driver->num_inserts, 2);
+  cr_assert_eq(driver->flushed_batch_sizes[1], 1);
+
+  reconnect_delay_msec = g_time_val_diff(&driver->last_connect, &driver->last_flush_error) / 1000;
+  cr_assert_geq(reconnect_delay_msec, 900, "reconnected %ld msec after the failure", reconnect_delay_msec);
+
+  _stop_driver();
+  _free_driver();
+}
+
+Test(logthrdestdrv, retry_over_is_called_for_each_message_of_a_failed_batch)
+{
+  _create_driver(3, NEVER_DUE_TIMEOUT, 1);
+  driver->flush_result = WORKER_INSERT_RESULT_ERROR;
+  _start_driver();
+
+  _queue_messages(3);
+  cr_assert(_wait_for_counter(&driver->num_retry_over, 3));
+
+  _stop_driver();
+  cr_assert_eq(driver->num_flushes, 1, "the dropped batch was flushed again");
+  cr_assert_eq(driver->num_retry_over, 3);
+
+  _free_driver();
+}
+
+Test(logthrdestdrv, dropped_messages_step_the_sequence_number)
+{
+  _create_driver(0, 0, 1);
+  driver->insert_result = WORKER_INSERT_RESULT_ERROR;
+  driver->super.worker.flush = NULL;
+  _start_driver();
+
+  _queue_messages(3);
+  cr_assert(_wait_for_counter(&driver->num_retry_over, 3));
+
+  _stop_driver();
+  cr_assert_eq(driver->num_inserts, 3, "a dropped message was retried");
+  cr_assert_eq(driver->super.seq_num, 4);
+
+  _free_driver();
+}
+
+Test(logthrdestdrv, rewound_batch_keeps_its_sequence_numbers)
+{
+  gint i;
+
+  _create_driver(3, NEVER_DUE_TIMEOUT, 3);
+  driver->flush_errors_left = 1;
+  _start_driver();
+
+  _queue_messages(3);
+  cr_assert(_wait_for_counter(&driver->num_flushes, 2), "the rewound batch was not retried");
+
+  _stop_driver();
+  cr_assert_eq(driver->num_inserts, 6);
+  for (i = 0; i < 3; i++)
+    {
+      cr_assert_eq(driver->inserted_seq_nums[i], i + 1);
+      cr_assert_eq(driver->inserted_seq_nums[i + 3], i + 1, "message %d was renumbered when retried", i);
+    }
+  cr_assert_eq(driver->super.seq_num, 4);
+
+  _free_driver();
+}
+
+Test(logthrdestdrv, accepted_batch_head_is_acked_and_the_tail_is_rewound)
+{
+  LogQueue *queue;
+
+  _create_driver(4, 50, 3);
+  driver->flush_errors_left = 1;
+  driver->flush_errors_accepted_head = 3;
+  _start_driver();
+
+  _queue_messages(4);
+  cr_assert(_wait_for_written_messages(4), "the rewound tail of the batch was not written");
+
+  cr_assert_eq(driver->num_flushes, 2);
+  cr_assert_eq(driver->flushed_batch_sizes[0], 4);
+  cr_assert_eq(driver->flushed_batch_sizes[1], 1, "the accepted head of the batch was sent again");
+  cr_assert_eq(driver->num_inserts, 5);
+  cr_assert_eq(driver->num_retry_over, 0);
+
+  queue = driver->super.queue;
+  cr_assert_eq(log_queue_get_length(queue), 0);
+  cr_assert_not(log_queue_keep_on_reload(queue), "acknowledged messages were left in the backlog");
+
+  _stop_driver();
+  _free_driver();
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  stats_options_defaults(&stats_options);
+  stats_options.level = 1;
+  stats_reinit(&stats_options);
+  main_loop_call_init();
+  main_loop_worker_init();
+  cfg = cfg_new_snippet();
+}
+
+static void
+teardown(void)
+{
+  cfg_free(cfg);
+  main_loop_call_deinit();
+  app_shutdown();
+}
+
+TestSuite(logthrdestdrv, .init = setup, .fini = teardown);
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "host-resolve.h"
+#include "dnscache.h"
+#include "gsockaddr.h"
+#include "hostname.h"
+#include "apphook.h"
+
+#include <string.h>
+#include <arpa/inet.h>
+
+/* only loopback addresses are used, so that the lookups are answered
+ * locally, without depending on DNS servers */
+#define LOOPBACK_ADDRESS "127.0.0.1"
+#define RESOLVER_WAIT_MSEC 5000
+
+static HostResolveOptions host_resolve_options;
+
+static void
+_set_resolve_timeout(gint resolve_timeout)
+{
+  DNSCacheOptions options;
+
+  dns_cache_options_defaults(&options);
+  options.resolve_timeout = resolve_timeout;
+  dns_caching_update_options(&options);
+  dns_cache_options_destroy(&options);
+}
+
+static gchar *
+_resolve(const gchar *ip)
+{
+  GSockAddr *saddr = g_sockaddr_inet_new(ip, 0);
+  gsize result_len;
+  gchar *result;
+
+  result = g_strdup(resolve_sockaddr_to_hostname(&result_len, saddr, &host_resolve_options));
+  g_sockaddr_unref(saddr);
+  return result;
+}
+
+/* the name a synchronous, uncached lookup returns */
+static gchar *
+_resolve_without_cache(const gchar *ip)
+{
+  gchar *result;
+
+  host_resolve_options.use_dns_cache = FALSE;
+  result = _resolve(ip);
+  host_resolve_options.use_dns_cache = TRUE;
+  return result;
+}
+
+static gboolean
+_is_cached(const gchar *ip)
+{
+  struct in_addr addr;
+  const gchar *hostname;
+  gsize hostname_len;
+  gboolean positive;
+
+  cr_assert(inet_aton(ip, &addr));
+  return dns_caching_lookup(AF_INET, &addr, &hostname, &hostname_len, &positive);
+}
+
+static gboolean
+_wait_until_cached(const gchar *ip)
+{
+  gint i;
+
+  for (i = 0; i < RESOLVER_WAIT_MSEC / 10; i++)
+    {
+      if (_is_cached(ip))
+        return TRUE;
+      g_usleep(10000);
+    }
+  return FALSE;
+}
+
+Test(resolver_threads, lookups_are_synchronous_by_default)
+{
+  gchar *expected = _resolve_without_cache(LOOPBACK_ADDRESS);
+  gchar *result;
+
+  cr_assert_eq(dns_caching_get_resolve_timeout(), -1);
+  cr_assert_not(_is_cached(LOOPBACK_ADDRESS));
+
+  result = _resolve(LOOPBACK_ADDRESS);
+  cr_assert_str_eq(result, expected);
+  cr_assert(_is_cached(LOOPBACK_ADDRESS), "synchronous lookup was not cached");
+
+  g_free(result);
+  g_free(expected);
+}
+
+Test(resolver_threads, zero_timeout_returns_the_address_and_resolves_in_the_background)
+{
+  gchar *expected = _resolve_without_cache(LOOPBACK_ADDRESS);
+  gchar *result;
+
+  _set_resolve_timeout(0);
+
+  result = _resolve(LOOPBACK_ADDRESS);
+  cr_assert_str_eq(result, LOOPBACK_ADDRESS, "the input thread waited for the resolver");
+  g_free(result);
+
+  cr_assert(_wait_until_cached(LOOPBACK_ADDRESS), "the resolver thread did not store the result");
+
+  result = _resolve(LOOPBACK_ADDRESS);
+  cr_assert_str_eq(result, expected);
+  g_free(result);
+  g_free(expected);
+}
+
+Test(resolver_threads, bounded_wait_returns_the_name_resolved_in_time)
+{
+  gchar *expected = _resolve_without_cache(LOOPBACK_ADDRESS);
+  gchar *result;
+
+  _set_resolve_timeout(RESOLVER_WAIT_MSEC);
+
+  result = _resolve(LOOPBACK_ADDRESS);
+  cr_assert_str_eq(result, expected);
+  cr_assert(_is_cached(LOOPBACK_ADDRESS));
+
+  g_free(result);
+  g_free(expected);
+}
+
+/* app_shutdown() in teardown releases the lookups still queued */
+Test(resolver_threads, queued_lookups_are_released_on_shutdown)
+{
+  gchar ip[16];
+  gchar *result;
+  gint i;
+
+  _set_resolve_timeout(0);
+
+  for (i = 1; i < 64; i++)
+    {
+      g_snprintf(ip, sizeof(ip), "127.0.1.%d", i);
+      result = _resolve(ip);
+      cr_assert_str_eq(result, ip);
+      g_free(result);
+    }
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  hostname_reinit(NULL);
+  host_resolve_options_defaults(&host_resolve_options);
+  host_resolve_options.use_dns = TRUE;
+  host_resolve_options.use_fqdn = TRUE;
+  host_resolve_options.use_dns_cache = TRUE;
+  host_resolve_options.normalize_hostnames = FALSE;
+}
+
+static void
+teardown(void)
+{
+  host_resolve_options_destroy(&host_resolve_options);
+  app_shutdown();
+}
+
+TestSuite(resolver_threads, .init = setup, .fini = teardown);
@@ -43,6 +43,7 @@ log_transport_init_instance(LogTransport *self, gint fd)
 {
   self->fd = fd;
   self->cond = 0;
+  self->has_buffered_data = NULL;
   self->free_fn = log_transport_free_method;
 }
 
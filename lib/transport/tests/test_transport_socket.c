@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include <criterion/criterion.h>
+
+#include "transport/transport-socket.h"
+#include "fdhelpers.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static gint sender_fd;
+static LogTransport *transport;
+
+static void
+_send_datagram(const gchar *payload)
+{
+  cr_assert_eq(send(sender_fd, payload, strlen(payload), 0), strlen(payload));
+}
+
+static void
+_assert_read_datagram(const gchar *expected, gsize buflen)
+{
+  gchar buf[64];
+  LogTransportAuxData aux;
+  gssize rc;
+
+  log_transport_aux_data_init(&aux);
+  rc = log_transport_read(transport, buf, buflen, &aux);
+  log_transport_aux_data_destroy(&aux);
+
+  cr_assert_eq(rc, strlen(expected), "unexpected datagram length: %d, expected: %s", (gint) rc, expected);
+  cr_assert_arr_eq(buf, expected, rc);
+}
+
+/* large read buffers, like a big log-msg-size() */
+static void
+_assert_read_datagram_into_large_buffer(const gchar *expected)
+{
+  gsize buflen = 1024 * 1024;
+  gchar *buf = g_malloc(buflen);
+  gssize rc;
+
+  rc = log_transport_read(transport, buf, buflen, NULL);
+  cr_assert_eq(rc, strlen(expected), "unexpected datagram length: %d, expected: %s", (gint) rc, expected);
+  cr_assert_arr_eq(buf, expected, rc);
+  g_free(buf);
+}
+
+static void
+_assert_read_would_block(void)
+{
+  gchar buf[64];
+
+  cr_assert_eq(log_transport_read(transport, buf, sizeof(buf), NULL), -1);
+  cr_assert_eq(errno, EAGAIN);
+}
+
+static void
+_setup_transport(gint batch_size)
+{
+  gint fds[2];
+
+  cr_assert_eq(socketpair(AF_UNIX, SOCK_DGRAM, 0, fds), 0);
+  g_fd_set_nonblock(fds[0], TRUE);
+  sender_fd = fds[1];
+  transport = log_transport_dgram_socket_new_batched(fds[0], batch_size);
+}
+
+static void
+teardown(void)
+{
+  log_transport_free(transport);
+  close(sender_fd);
+}
+
+Test(transport_socket, datagrams_are_returned_one_by_one_from_a_batch, .fini = teardown)
+{
+  _setup_transport(4);
+
+  _send_datagram("first");
+  _send_datagram("second");
+  _send_datagram("third");
+
+  _assert_read_datagram("first", 64);
+  _assert_read_datagram("second", 64);
+  _assert_read_datagram("third", 64);
+  cr_assert_not(log_transport_has_buffered_data(transport));
+  _assert_read_would_block();
+}
+
+Test(transport_socket, datagrams_above_the_batch_size_are_received_by_the_next_batch, .fini = teardown)
+{
+  _setup_transport(2);
+
+  _send_datagram("first");
+  _send_datagram("second");
+  _send_datagram("third");
+
+  _assert_read_datagram("first", 64);
+  _assert_read_datagram("second", 64);
+  _assert_read_datagram("third", 64);
+  _assert_read_would_block();
+}
+
+Test(transport_socket, datagrams_are_truncated_to_the_read_buffer, .fini = teardown)
+{
+  _setup_transport(4);
+
+  _send_datagram("truncated");
+
+  _assert_read_datagram("trunc", 5);
+  _assert_read_would_block();
+}
+
+Test(transport_socket, receive_slots_are_limited_by_memory_for_large_read_buffers, .fini = teardown)
+{
+  _setup_transport(1000);
+
+  _send_datagram("first");
+  _send_datagram("second");
+
+  /* a single 1MiB slot fits into the limit, so one datagram is received at a time */
+  _assert_read_datagram_into_large_buffer("first");
+  cr_assert_not(log_transport_has_buffered_data(transport));
+  _assert_read_datagram_into_large_buffer("second");
+  _assert_read_would_block();
+}
@@ -25,6 +25,8 @@
 
 #include <errno.h>
 #include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
 
 static gssize
 log_transport_dgram_socket_read_method(LogTransport *s, gpointer buf, gsize buflen, LogTransportAuxData *aux)
@@ -95,6 +97,157 @@ log_transport_dgram_socket_new(gint fd)
   return &self->super;
 }
 
+#if SYSLOG_NG_HAVE_RECVMMSG
+
+/*
+ * Datagram transport that receives up to batch_size datagrams with a
+ * single recvmmsg() call and hands them out one-by-one on subsequent
+ * read() calls, without touching the socket again.  The receive slots are
+ * allocated on the first read, when the size of the caller's buffer is
+ * known, and reused afterwards.
+ *
+ * Each slot is as large as the caller's buffer (log-msg-size()), so the
+ * number of slots is limited both in count and in total memory: with a
+ * large log-msg-size() fewer datagrams are received in one go.
+ */
+#define DGRAM_BATCH_SIZE_MAX 256
+#define DGRAM_BATCH_MEMORY_MAX (1024 * 1024)
+
+typedef struct _LogTransportDGramBatchSocket
+{
+  LogTransportSocket super;
+  gint batch_size;
+  gint num_slots;
+  gsize slot_size;
+  gchar *slots;
+  struct mmsghdr *msgs;
+  struct iovec *iovs;
+  struct sockaddr_storage *addrs;
+  gint num_received;
+  gint next;
+} LogTransportDGramBatchSocket;
+
+static gint
+_dgram_batch_receive(LogTransportDGramBatchSocket *self, gsize buflen)
+{
+  gint i, rc;
+
+  if (self->slot_size < buflen)
+    {
+      g_free(self->slots);
+      self->num_slots = CLAMP(DGRAM_BATCH_MEMORY_MAX / buflen, 1, self->batch_size);
+      self->slots = g_malloc(self->num_slots * buflen);
+      self->slot_size = buflen;
+    }
+
+  for (i = 0; i < self->num_slots; i++)
+    {
+      self->iovs[i].iov_base = self->slots + i * self->slot_size;
+      self->iovs[i].iov_len = buflen;
+
+      memset(&self->msgs[i], 0, sizeof(self->msgs[i]));
+      self->msgs[i].msg_hdr.msg_iov = &self->iovs[i];
+      self->msgs[i].msg_hdr.msg_iovlen = 1;
+      self->msgs[i].msg_hdr.msg_name = &self->addrs[i];
+      self->msgs[i].msg_hdr.msg_namelen = sizeof(self->addrs[i]);
+    }
+
+  do
+    {
+      rc = recvmmsg(self->super.super.fd, self->msgs, self->num_slots, 0, NULL);
+    }
+  while (rc == -1 && errno == EINTR);
+  return rc;
+}
+
+static gssize
+log_transport_dgram_batch_socket_read_method(LogTransport *s, gpointer buf, gsize buflen, LogTransportAuxData *aux)
+{
+  LogTransportDGramBatchSocket *self = (LogTransportDGramBatchSocket *) s;
+  struct mmsghdr *msg;
+  gssize len;
+
+  if (self->next >= self->num_received)
+    {
+      gint rc = _dgram_batch_receive(self, buflen);
+
+      self->next = 0;
+      self->num_received = MAX(rc, 0);
+      if (rc <= 0)
+        {
+          if (rc == 0)
+            errno = EAGAIN;
+          return -1;
+        }
+    }
+
+  msg = &self->msgs[self->next++];
+  len = MIN(msg->msg_len, buflen);
+  memcpy(buf, msg->msg_hdr.msg_iov->iov_base, len);
+
+  if (msg->msg_hdr.msg_namelen && aux)
+    log_transport_aux_data_set_peer_addr_ref(aux, g_sockaddr_new((struct sockaddr *) msg->msg_hdr.msg_name,
+                                             msg->msg_hdr.msg_namelen));
+  if (len == 0)
+    {
+      /* DGRAM sockets should never return EOF, they just need to be read again */
+      errno = EAGAIN;
+      return -1;
+    }
+  return len;
+}
+
+static gboolean
+log_transport_dgram_batch_socket_has_buffered_data(LogTransport *s)
+{
+  LogTransportDGramBatchSocket *self = (LogTransportDGramBatchSocket *) s;
+
+  return self->next < self->num_received;
+}
+
+static void
+log_transport_dgram_batch_socket_free_method(LogTransport *s)
+{
+  LogTransportDGramBatchSocket *self = (LogTransportDGramBatchSocket *) s;
+
+  g_free(self->slots);
+  g_free(self->msgs);
+  g_free(self->iovs);
+  g_free(self->addrs);
+  log_transport_free_method(s);
+}
+
+LogTransport *
+log_transport_dgram_socket_new_batched(gint fd, gint batch_size)
+{
+  LogTransportDGramBatchSocket *self;
+
+  if (batch_size <= 1)
+    return log_transport_dgram_socket_new(fd);
+
+  self = g_new0(LogTransportDGramBatchSocket, 1);
+  log_transport_dgram_socket_init_instance(&self->super, fd);
+  self->super.super.read = log_transport_dgram_batch_socket_read_method;
+  self->super.super.has_buffered_data = log_transport_dgram_batch_socket_has_buffered_data;
+  self->super.super.free_fn = log_transport_dgram_batch_socket_free_method;
+
+  self->batch_size = MIN(batch_size, DGRAM_BATCH_SIZE_MAX);
+  self->msgs = g_new0(struct mmsghdr, self->batch_size);
+  self->iovs = g_new0(struct iovec, self->batch_size);
+  self->addrs = g_new0(struct sockaddr_storage, self->batch_size);
+  return &self->super.super;
+}
+
+#else
+
+LogTransport *
+log_transport_dgram_socket_new_batched(gint fd, gint batch_size)
+{
+  return log_transport_dgram_socket_new(fd);
+}
+
+#endif
+
 static gssize
 log_transport_stream_socket_read_method(LogTransport *s, gpointer buf, gsize buflen, LogTransportAuxData *aux)
 {
@@ -205,6 +205,52 @@ Test(value_pairs, test_transformers)
   g_ptr_array_free(transformers, TRUE);
 }
 
+static gboolean
+vp_concat_keys_foreach(const gchar *name, TypeHint type, const gchar *value,
+                       gsize value_len, gpointer user_data)
+{
+  GString *keys = (GString *) user_data;
+
+  if (keys->len > 0)
+    g_string_append_c(keys, ',');
+  g_string_append(keys, name);
+  return FALSE;
+}
+
+static void
+assert_vp_keys(ValuePairs *vp, LogMessage *msg, const gchar *expected)
+{
+  GString *keys = g_string_new("");
+
+  value_pairs_foreach(vp, vp_concat_keys_foreach, msg, 11, LTZ_LOCAL, &template_options, keys);
+  cr_expect_str_eq(keys->str, expected);
+  g_string_free(keys, TRUE);
+}
+
+Test(value_pairs, test_selection_is_recomputed_when_patterns_change)
+{
+  ValuePairs *vp = value_pairs_new();
+  ValuePairsTransformSet *vpts = value_pairs_transform_set_new("*");
+  LogMessage *msg = log_msg_new_empty();
+
+  log_msg_set_value_by_name(msg, "foo", "1", -1);
+  log_msg_set_value_by_name(msg, "bar", "2", -1);
+
+  value_pairs_add_scope(vp, "nv-pairs");
+  value_pairs_transform_set_add_func(vpts, value_pairs_new_transform_add_prefix("_"));
+  value_pairs_add_transforms(vp, vpts);
+
+  assert_vp_keys(vp, msg, "_bar,_foo");
+  /* second round is served from the per-handle cache */
+  assert_vp_keys(vp, msg, "_bar,_foo");
+
+  value_pairs_add_glob_pattern(vp, "foo", FALSE);
+  assert_vp_keys(vp, msg, "_bar");
+
+  log_msg_unref(msg);
+  value_pairs_unref(vp);
+}
+
 GlobalConfig *cfg;
 
 void
@@ -33,6 +33,7 @@
 #include "cfg.h"
 
 #include <ctype.h>
+#include <string.h>
 
 typedef struct
 {
@@ -56,6 +57,26 @@ typedef struct
   TypeHint type_hint;
 } VPResultValue;
 
+/* The outcome of the scope/pattern/transform evaluation for a single
+ * name-value pair, computed once per NVHandle. */
+typedef struct
+{
+  /* the registry owned name the entry was computed for */
+  const gchar *nv_name;
+  gboolean include;
+  GString *name;
+} VPNVPairPlan;
+
+/* Handle indexed array of VPNVPairPlan pointers. The array is never resized
+ * in place: a larger copy is published instead and the old one is kept
+ * around until the ValuePairs instance is freed, so readers can index it
+ * without locking. */
+typedef struct
+{
+  guint size;
+  VPNVPairPlan *plans[0];
+} VPNVPairPlanCache;
+
 typedef struct
 {
   GTree *result_tree;
@@ -74,6 +95,11 @@ struct _ValuePairs
 
   /* guint32 as CfgFlagHandler only supports 32 bit integers */
   guint32 scopes;
+
+  VPNVPairPlanCache *plan_cache;
+  GList *retired_plan_caches;
+  GList *retired_plans;
+  GStaticMutex plan_cache_lock;
 };
 
 typedef enum
@@ -267,6 +293,133 @@ vp_pairs_foreach(gpointer data, gpointer user_data)
   vp_results_insert(results, vp_transform_apply(vp, vpc->name), vpc->template->type_hint, sb);
 }
 
+static void
+vp_nvpair_plan_free(VPNVPairPlan *plan)
+{
+  if (plan->name)
+    g_string_free(plan->name, TRUE);
+  g_free(plan);
+}
+
+static VPNVPairPlan *
+vp_nvpair_plan_new(ValuePairs *vp, NVHandle handle, const gchar *name)
+{
+  VPNVPairPlan *plan = g_new0(VPNVPairPlan, 1);
+  guint j;
+
+  plan->nv_name = name;
+  plan->include = (name[0] == '.' && (vp->scopes & VPS_DOT_NV_PAIRS)) ||
+                  (name[0] != '.' && (vp->scopes & VPS_NV_PAIRS)) ||
+                  (log_msg_is_handle_sdata(handle) && (vp->scopes & (VPS_SDATA + VPS_RFC5424)));
+
+  for (j = 0; j < vp->patterns->len; j++)
+    {
+      VPPatternSpec *vps = (VPPatternSpec *) g_ptr_array_index(vp->patterns, j);
+      if (vp_pattern_spec_eval(vps, name))
+        plan->include = vps->include;
+    }
+
+  if (plan->include)
+    {
+      GString *transformed = vp_transform_apply(vp, name);
+
+      plan->name = g_string_new_len(transformed->str, transformed->len);
+    }
+  return plan;
+}
+
+static VPNVPairPlan *
+vp_plan_cache_lookup(ValuePairs *vp, NVHandle handle, const gchar *name)
+{
+  VPNVPairPlanCache *cache = (VPNVPairPlanCache *) g_atomic_pointer_get(&vp->plan_cache);
+  VPNVPairPlan *plan;
+
+  if (!cache || handle >= cache->size)
+    return NULL;
+
+  plan = (VPNVPairPlan *) g_atomic_pointer_get(&cache->plans[handle]);
+
+  /* a handle may be reassigned to a different name if the registry is
+   * reinitialized, don't trust entries computed for another name */
+  if (plan && plan->nv_name != name)
+    return NULL;
+  return plan;
+}
+
+/* stores @plan and returns the plan to be used, which is the one published
+ * concurrently by another thread if we lost the race (@plan is freed then) */
+static VPNVPairPlan *
+vp_plan_cache_store(ValuePairs *vp, NVHandle handle, VPNVPairPlan *plan)
+{
+  VPNVPairPlanCache *cache;
+  VPNVPairPlan *current;
+
+  g_static_mutex_lock(&vp->plan_cache_lock);
+  cache = vp->plan_cache;
+  if (!cache || handle >= cache->size)
+    {
+      guint new_size = cache ? cache->size : 64;
+      VPNVPairPlanCache *new_cache;
+
+      while (new_size <= handle)
+        new_size *= 2;
+
+      new_cache = g_malloc0(sizeof(VPNVPairPlanCache) + new_size * sizeof(VPNVPairPlan *));
+      new_cache->size = new_size;
+      if (cache)
+        {
+          memcpy(new_cache->plans, cache->plans, cache->size * sizeof(VPNVPairPlan *));
+          vp->retired_plan_caches = g_list_prepend(vp->retired_plan_caches, cache);
+        }
+      g_atomic_pointer_set(&vp->plan_cache, new_cache);
+      cache = new_cache;
+    }
+
+  current = cache->plans[handle];
+  if (current && current->nv_name == plan->nv_name)
+    {
+      vp_nvpair_plan_free(plan);
+      plan = current;
+    }
+  else
+    {
+      /* a stale entry may still be in use by a reader, retire it instead
+       * of freeing */
+      if (current)
+        vp->retired_plans = g_list_prepend(vp->retired_plans, current);
+      g_atomic_pointer_set(&cache->plans[handle], plan);
+    }
+  g_static_mutex_unlock(&vp->plan_cache_lock);
+
+  return plan;
+}
+
+static void
+vp_plan_cache_clear(ValuePairs *vp)
+{
+  GList *l;
+  guint i;
+
+  if (vp->plan_cache)
+    {
+      for (i = 0; i < vp->plan_cache->size; i++)
+        {
+          if (vp->plan_cache->plans[i])
+            vp_nvpair_plan_free(vp->plan_cache->plans[i]);
+        }
+      g_free(vp->plan_cache);
+      vp->plan_cache = NULL;
+    }
+
+  for (l = vp->retired_plan_caches; l; l = l->next)
+    g_free(l->data);
+  g_list_free(vp->retired_plan_caches);
+  vp->retired_plan_caches = NULL;
+
+  g_list_free_full(vp->retired_plans, (GDestroyNotify) vp_nvpair_plan_free);
+  vp->retired_plans = NULL;
+}
+
 /* runs over the LogMessage nv-pairs, and inserts them unless excluded */
 static gboolean
 vp_msg_nvpairs_foreach(NVHandle handle, gchar *name,
@@ -275,28 +428,21 @@ vp_msg_nvpairs_foreach(NVHandle handle, gchar *name,
 {
   ValuePairs *vp = ((gpointer *)user_data)[0];
   VPResults *results = ((gpointer *)user_data)[5];
-  guint j;
-  gboolean inc;
+  VPNVPairPlan *plan;
   GString *sb;
 
-  inc = (name[0] == '.' && (vp->scopes & VPS_DOT_NV_PAIRS)) ||
-  (name[0] != '.' && (vp->scopes & VPS_NV_PAIRS)) ||
-  (log_msg_is_handle_sdata(handle) && (vp->scopes & (VPS_SDATA + VPS_RFC5424)));
-
-  for (j = 0; j < vp->patterns->len; j++)
-    {
-      VPPatternSpec *vps = (VPPatternSpec *) g_ptr_array_index(vp->patterns, j);
-      if (vp_pattern_spec_eval(vps, name))
-        inc = vps->include;
-    }
+  plan = vp_plan_cache_lookup(vp, handle, name);
+  if (!plan)
+    plan = vp_plan_cache_store(vp, handle, vp_nvpair_plan_new(vp, handle, name));
 
-  if (!inc)
+  if (!plan->include)
     return FALSE;
 
   sb = scratch_buffers_alloc();
 
   g_string_append_len(sb, value, value_len);
-  vp_results_insert(results, vp_transform_apply(vp, name), TYPE_HINT_STRING, sb);
+  /* the cached name is never modified, so it can be shared by all results */
+  vp_results_insert(results, plan->name, TYPE_HINT_STRING, sb);
 
   return FALSE;
 }
@@ -350,6 +496,8 @@ vp_merge_set(ValuePairs *vp, ValuePairSpec *set)
 static void
 vp_update_builtin_list_of_values(ValuePairs *vp)
 {
+  /* the selection changed, cached decisions are no longer valid */
+  vp_plan_cache_clear(vp);
   g_ptr_array_set_size(vp->builtins, 0);
 
   if (vp->patterns->len > 0)
@@ -874,6 +1022,7 @@ value_pairs_new(void)
   vp->vpairs = g_ptr_array_new();
   vp->patterns = g_ptr_array_new();
   vp->transforms = g_ptr_array_new();
+  g_static_mutex_init(&vp->plan_cache_lock);
 
   return vp;
 }
@@ -913,6 +1062,8 @@ value_pairs_free (ValuePairs *vp)
     }
   g_ptr_array_free(vp->transforms, TRUE);
   g_ptr_array_free(vp->builtins, TRUE);
+  vp_plan_cache_clear(vp);
+  g_static_mutex_free(&vp->plan_cache_lock);
   g_free(vp);
 }
 
@@ -216,3 +216,62 @@ log_transport_mock_endless_records_new(const gchar *read_buffer1, gssize read_bu
   self->eof_is_eagain = TRUE;
   return &self->super;
 }
+
+typedef struct
+{
+  LogTransport super;
+  GString *written;
+  gsize write_chunk_size;
+  gint num_writes;
+} LogTransportMockWriter;
+
+static gssize
+log_transport_mock_writer_write_method(LogTransport *s, const gpointer buf, gsize count)
+{
+  LogTransportMockWriter *self = (LogTransportMockWriter *) s;
+
+  if (self->write_chunk_size && count > self->write_chunk_size)
+    count = self->write_chunk_size;
+
+  g_string_append_len(self->written, (const gchar *) buf, count);
+  self->num_writes++;
+  return count;
+}
+
+static void
+log_transport_mock_writer_free_method(LogTransport *s)
+{
+  LogTransportMockWriter *self = (LogTransportMockWriter *) s;
+
+  g_string_free(self->written, TRUE);
+}
+
+LogTransport *
+log_transport_mock_writer_new(gsize write_chunk_size)
+{
+  LogTransportMockWriter *self = g_new0(LogTransportMockWriter, 1);
+
+  self->super.fd = -1;
+  self->super.cond = 0;
+  self->super.write = log_transport_mock_writer_write_method;
+  self->super.free_fn = log_transport_mock_writer_free_method;
+  self->written = g_string_new("");
+  self->write_chunk_size = write_chunk_size;
+  return &self->super;
+}
+
+const gchar *
+log_transport_mock_writer_get_written(LogTransport *s)
+{
+  LogTransportMockWriter *self = (LogTransportMockWriter *) s;
+
+  return self->written->str;
+}
+
+gint
+log_transport_mock_writer_get_num_writes(LogTransport *s)
+{
+  LogTransportMockWriter *self = (LogTransportMockWriter *) s;
+
+  return self->num_writes;
+}
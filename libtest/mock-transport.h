@@ -46,4 +46,11 @@ log_transport_mock_records_new(const gchar *read_buffer1, gssize read_buffer_len
 LogTransport *
 log_transport_mock_endless_records_new(const gchar *read_buffer1, gssize read_buffer_length1, ...);
 
+/* accepts at most write_chunk_size bytes per write() call, 0 means no limit */
+LogTransport *
+log_transport_mock_writer_new(gsize write_chunk_size);
+
+const gchar *log_transport_mock_writer_get_written(LogTransport *s);
+gint log_transport_mock_writer_get_num_writes(LogTransport *s);
+
 #endif
@@ -55,9 +55,13 @@
  * performed in various threads.
  *
  *   - queue runs in the thread of the source thread that generated the message
- *   - if the message is to be written to a not-yet-opened file, a new gets
- *     opened and stored in the writer_hash hashtable (initiated from queue,
- *     but performed in the main thread, but more on that later)
+ *   - if the message is to be written to a not-yet-opened file, a new writer
+ *     gets created and stored in the writer_hash hashtable (initiated from
+ *     queue, but performed in the main thread, but more on that later).
+ *     The file itself is opened by the thread that initiated the creation,
+ *     once it is back from the main thread, so a slow open() does not stall
+ *     the main loop.  Messages to the same file sent in the meantime are
+ *     queued by the writer until the file is opened.
  *   - currently opened destination files are checked regularly and closed
  *     if they are idle for a given amount of time (time_reap) (this is done
  *     in the main thread)
@@ -98,6 +102,8 @@ struct _AFFileDestWriter
   time_t time_reopen;
   struct iv_timer reap_timer;
   gboolean reopen_pending, queue_pending;
+  /* the file is to be opened by the thread that created the writer */
+  gboolean open_deferred;
 };
 
 static gchar *
@@ -223,9 +229,32 @@ affile_dw_init(LogPipe *s)
     }
   log_pipe_append(&self->super, (LogPipe *) self->writer);
 
+  if (self->open_deferred)
+    return TRUE;
   return affile_dw_reopen(self);
 }
 
+/* opens the file of a writer created with open_deferred set, outside of the main thread */
+static void
+affile_dw_open_deferred(AFFileDestWriter *self)
+{
+  g_static_mutex_lock(&self->lock);
+  if (!self->open_deferred)
+    {
+      g_static_mutex_unlock(&self->lock);
+      return;
+    }
+  self->open_deferred = FALSE;
+  self->reopen_pending = TRUE;
+  g_static_mutex_unlock(&self->lock);
+
+  affile_dw_reopen(self);
+
+  g_static_mutex_lock(&self->lock);
+  self->reopen_pending = FALSE;
+  g_static_mutex_unlock(&self->lock);
+}
+
 static gboolean
 affile_dw_deinit(LogPipe *s)
 {
@@ -400,7 +429,23 @@ affile_dd_set_fsync(LogDriver *s, gboolean use_fsync)
 {
   AFFileDestDriver *self = (AFFileDestDriver *) s;
 
-  self->use_fsync = use_fsync;
+  self->fsync_options.enabled = use_fsync;
+}
+
+void
+affile_dd_set_fsync_interval(LogDriver *s, gint interval)
+{
+  AFFileDestDriver *self = (AFFileDestDriver *) s;
+
+  self->fsync_options.interval = interval;
+}
+
+void
+affile_dd_set_fsync_bytes(LogDriver *s, gint bytes)
+{
+  AFFileDestDriver *self = (AFFileDestDriver *) s;
+
+  self->fsync_options.bytes = bytes;
 }
 
 static inline const gchar *
@@ -607,6 +652,7 @@ affile_dd_open_writer(gpointer args[])
         {
           next = affile_dw_new(self->filename_template->template, log_pipe_get_config(&self->super.super.super));
           affile_dw_set_owner(next, self);
+          next->open_deferred = TRUE;
           if (next && log_pipe_init(&next->super))
             {
               log_pipe_ref(&next->super);
@@ -644,6 +690,7 @@ affile_dd_open_writer(gpointer args[])
         {
           next = affile_dw_new(filename->str, log_pipe_get_config(&self->super.super.super));
           affile_dw_set_owner(next, self);
+          next->open_deferred = TRUE;
           if (!log_pipe_init(&next->super))
             {
               log_pipe_unref(&next->super);
@@ -728,6 +775,9 @@ affile_dd_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options,
     }
   if (next)
     {
+      if (next->open_deferred)
+        affile_dw_open_deferred(next);
+
       log_msg_add_ack(msg, path_options);
       log_pipe_queue(&next->super, log_msg_ref(msg), path_options);
       next->queue_pending = FALSE;
@@ -794,7 +844,7 @@ affile_dd_new(gchar *filename, GlobalConfig *cfg)
 
   self->writer_flags |= LW_SOFT_FLOW_CONTROL;
   self->writer_options.stats_source = SCS_FILE;
-  self->file_opener = file_opener_for_regular_dest_files_new(&self->writer_options, &self->use_fsync);
+  self->file_opener = file_opener_for_regular_dest_files_new(&self->writer_options, &self->fsync_options);
   return &self->super.super;
 }
 
@@ -27,6 +27,7 @@
 #include "driver.h"
 #include "logwriter.h"
 #include "file-opener.h"
+#include "logproto-file-writer.h"
 
 typedef struct _AFFileDestWriter AFFileDestWriter;
 
@@ -38,7 +39,7 @@ typedef struct _AFFileDestDriver
   AFFileDestWriter *single_writer;
   gboolean filename_is_a_template;
   gboolean template_escape;
-  gboolean use_fsync;
+  LogProtoFileWriterFsyncOptions fsync_options;
   FileOpenerOptions file_opener_options;
   FileOpener *file_opener;
   TimeZoneInfo *local_time_zone_info;
@@ -56,6 +57,8 @@ LogDriver *affile_dd_new(gchar *filename, GlobalConfig *cfg);
 
 void affile_dd_set_create_dirs(LogDriver *s, gboolean create_dirs);
 void affile_dd_set_fsync(LogDriver *s, gboolean enable);
+void affile_dd_set_fsync_interval(LogDriver *s, gint interval);
+void affile_dd_set_fsync_bytes(LogDriver *s, gint bytes);
 void affile_dd_set_overwrite_if_older(LogDriver *s, gint overwrite_if_older);
 void affile_dd_set_local_time_zone(LogDriver *s, const gchar *local_time_zone);
 void affile_dd_global_init(void);
@@ -44,6 +44,8 @@ static CfgLexerKeyword affile_keywords[] =
   { "monitor_method",     KW_MONITOR_METHOD },
 
   { "fsync",              KW_FSYNC },
+  { "fsync_interval",     KW_FSYNC_INTERVAL },
+  { "fsync_bytes",        KW_FSYNC_BYTES },
   { "remove_if_older",    KW_OVERWRITE_IF_OLDER, KWS_OBSOLETE, "overwrite_if_older" },
   { "overwrite_if_older", KW_OVERWRITE_IF_OLDER },
   { "follow_freq",        KW_FOLLOW_FREQ },
@@ -26,9 +26,11 @@
 
 #include "file-opener.h"
 #include "logwriter.h"
+#include "logproto-file-writer.h"
 
 FileOpener *file_opener_for_regular_source_files_new(void);
-FileOpener *file_opener_for_regular_dest_files_new(const LogWriterOptions *writer_options, gboolean *use_fsync);
+FileOpener *file_opener_for_regular_dest_files_new(const LogWriterOptions *writer_options,
+                                                   const LogProtoFileWriterFsyncOptions *fsync_options);
 FileOpener *file_opener_for_devkmsg_new(void);
 FileOpener *file_opener_for_prockmsg_new(void);
 
@@ -23,6 +23,9 @@
 
 #include "logproto-file-writer.h"
 #include "messages.h"
+#include "apphook.h"
+#include "mainloop-call.h"
+#include "timeutils.h"
 
 #include <string.h>
 #include <errno.h>
@@ -39,9 +42,258 @@ typedef struct _LogProtoFileWriter
   gint fd;
   gint sum_len;
   gboolean fsync;
+
+  /* group commit state, messages are only acked once a sync covers them */
+  gint fsync_interval;
+  gint fsync_bytes;
+  gint pending_acks;
+  GStaticMutex lock;
+  gint unsynced_acks;
+  gint unsynced_bytes;
+  GTimeVal unsynced_since;
+  gint synced_acks;
+  /* owned by the flusher thread while in_sync is set (under fsync_flusher_lock) */
+  gint syncing_acks;
+  gboolean in_sync;
+
   struct iovec buffer[0];
 } LogProtoFileWriter;
 
+/*
+ * The fsync flusher is a single thread shared by all group commit file
+ * writers that syncs files where unsynced data is older than
+ * fsync-interval().  Queue acks are not thread safe, so the synced messages
+ * are only counted here and the writer is woken up to ack them in its own
+ * context.
+ *
+ * The files are synced without holding fsync_flusher_lock, so that
+ * (un)registering writers in the main thread is not stalled by the disk.
+ * Writers being synced are marked in_sync, _fsync_flusher_unregister()
+ * waits for that to clear before the writer can be freed.
+ *
+ * The thread is started by the first group commit writer and exits once
+ * the last one is freed.  It is not joined: it may be waiting for the main
+ * thread in main_loop_call(), and writers are freed in the main thread.
+ */
+static GStaticMutex fsync_flusher_lock = G_STATIC_MUTEX_INIT;
+static GCond *fsync_flusher_cond;
+static GCond *fsync_flusher_sync_done_cond;
+static GThread *fsync_flusher_thread;
+static GList *fsync_flusher_writers;
+static gint fsync_flusher_tick;
+
+static inline gboolean
+_is_group_commit(LogProtoFileWriter *self)
+{
+  return self->fsync_interval > 0;
+}
+
+static void
+_sync_file(LogProtoFileWriter *self)
+{
+#if SYSLOG_NG_HAVE_FDATASYNC
+  if (fdatasync(self->fd) < 0)
+#else
+  if (fsync(self->fd) < 0)
+#endif
+    msg_error("Error syncing file",
+              evt_tag_int("fd", self->fd),
+              evt_tag_errno(EVT_TAG_OSERROR, errno));
+}
+
+static void
+_mark_written(LogProtoFileWriter *self, gint written_bytes, gboolean batch_complete)
+{
+  if (!_is_group_commit(self))
+    return;
+
+  g_static_mutex_lock(&self->lock);
+  self->unsynced_bytes += written_bytes;
+  if (batch_complete && self->pending_acks > 0)
+    {
+      if (self->unsynced_acks == 0)
+        g_get_current_time(&self->unsynced_since);
+      self->unsynced_acks += self->pending_acks;
+      self->pending_acks = 0;
+    }
+  g_static_mutex_unlock(&self->lock);
+}
+
+/* returns the number of messages the caller has to sync and ack */
+static gint
+_take_unsynced_acks_if_due(LogProtoFileWriter *self)
+{
+  GTimeVal now;
+  gint num_acks = 0;
+
+  g_get_current_time(&now);
+  g_static_mutex_lock(&self->lock);
+  if (self->unsynced_acks > 0 &&
+      ((self->fsync_bytes > 0 && self->unsynced_bytes >= self->fsync_bytes) ||
+       g_time_val_diff(&now, &self->unsynced_since) >= (glong) self->fsync_interval * 1000))
+    {
+      num_acks = self->unsynced_acks;
+      self->unsynced_acks = 0;
+      self->unsynced_bytes = 0;
+    }
+  g_static_mutex_unlock(&self->lock);
+  return num_acks;
+}
+
+static void
+_ack_synced_messages(LogProtoFileWriter *self)
+{
+  gint num_acks;
+
+  g_static_mutex_lock(&self->lock);
+  num_acks = self->synced_acks;
+  self->synced_acks = 0;
+  g_static_mutex_unlock(&self->lock);
+
+  if (num_acks > 0)
+    log_proto_client_msg_ack(&self->super, num_acks);
+}
+
+static gpointer
+_fsync_flusher_wake_up_writers(gpointer user_data)
+{
+  GList *l;
+
+  g_static_mutex_lock(&fsync_flusher_lock);
+  for (l = fsync_flusher_writers; l; l = l->next)
+    {
+      LogProtoFileWriter *self = (LogProtoFileWriter *) l->data;
+      gboolean has_synced_acks;
+
+      g_static_mutex_lock(&self->lock);
+      has_synced_acks = self->synced_acks > 0;
+      g_static_mutex_unlock(&self->lock);
+
+      if (has_synced_acks)
+        log_proto_client_wakeup(&self->super);
+    }
+  g_static_mutex_unlock(&fsync_flusher_lock);
+  return NULL;
+}
+
+/* must be called with fsync_flusher_lock held */
+static void
+_fsync_flusher_wait_for_sync(LogProtoFileWriter *self)
+{
+  while (self->in_sync)
+    g_cond_wait(fsync_flusher_sync_done_cond, g_static_mutex_get_mutex(&fsync_flusher_lock));
+}
+
+static gpointer
+_fsync_flusher_thread(gpointer user_data)
+{
+  app_thread_start();
+  g_static_mutex_lock(&fsync_flusher_lock);
+  while (fsync_flusher_writers)
+    {
+      GList *due_writers = NULL;
+      GTimeVal end_time;
+      GList *l;
+
+      g_get_current_time(&end_time);
+      g_time_val_add(&end_time, (glong) fsync_flusher_tick * 1000);
+      g_cond_timed_wait(fsync_flusher_cond, g_static_mutex_get_mutex(&fsync_flusher_lock), &end_time);
+
+      for (l = fsync_flusher_writers; l; l = l->next)
+        {
+          LogProtoFileWriter *self = (LogProtoFileWriter *) l->data;
+
+          self->syncing_acks = _take_unsynced_acks_if_due(self);
+          if (self->syncing_acks == 0)
+            continue;
+
+          self->in_sync = TRUE;
+          due_writers = g_list_prepend(due_writers, self);
+        }
+
+      if (!due_writers)
+        continue;
+
+      g_static_mutex_unlock(&fsync_flusher_lock);
+      for (l = due_writers; l; l = l->next)
+        {
+          LogProtoFileWriter *self = (LogProtoFileWriter *) l->data;
+
+          _sync_file(self);
+          g_static_mutex_lock(&self->lock);
+          self->synced_acks += self->syncing_acks;
+          g_static_mutex_unlock(&self->lock);
+        }
+      g_static_mutex_lock(&fsync_flusher_lock);
+
+      for (l = due_writers; l; l = l->next)
+        {
+          LogProtoFileWriter *self = (LogProtoFileWriter *) l->data;
+
+          self->syncing_acks = 0;
+          self->in_sync = FALSE;
+        }
+      g_cond_broadcast(fsync_flusher_sync_done_cond);
+      g_list_free(due_writers);
+
+      g_static_mutex_unlock(&fsync_flusher_lock);
+      main_loop_call(_fsync_flusher_wake_up_writers, NULL, TRUE);
+      g_static_mutex_lock(&fsync_flusher_lock);
+    }
+  fsync_flusher_thread = NULL;
+  g_static_mutex_unlock(&fsync_flusher_lock);
+  app_thread_stop();
+  return NULL;
+}
+
+static void
+_fsync_flusher_register(LogProtoFileWriter *self)
+{
+  g_static_mutex_lock(&fsync_flusher_lock);
+  if (!fsync_flusher_cond)
+    {
+      fsync_flusher_cond = g_cond_new();
+      fsync_flusher_sync_done_cond = g_cond_new();
+    }
+  if (!fsync_flusher_writers)
+    fsync_flusher_tick = self->fsync_interval;
+  fsync_flusher_writers = g_list_prepend(fsync_flusher_writers, self);
+  if (!fsync_flusher_thread)
+    {
+      fsync_flusher_thread = g_thread_create(_fsync_flusher_thread, NULL, FALSE, NULL);
+    }
+  else if (self->fsync_interval < fsync_flusher_tick)
+    {
+      fsync_flusher_tick = self->fsync_interval;
+      g_cond_signal(fsync_flusher_cond);
+    }
+  g_static_mutex_unlock(&fsync_flusher_lock);
+}
+
+static void
+_fsync_flusher_unregister(LogProtoFileWriter *self)
+{
+  GList *l;
+
+  g_static_mutex_lock(&fsync_flusher_lock);
+  fsync_flusher_writers = g_list_remove(fsync_flusher_writers, self);
+  _fsync_flusher_wait_for_sync(self);
+
+  /* the tick only needs to be as short as the shortest remaining interval */
+  for (l = fsync_flusher_writers; l; l = l->next)
+    {
+      LogProtoFileWriter *writer = (LogProtoFileWriter *) l->data;
+
+      if (l == fsync_flusher_writers || writer->fsync_interval < fsync_flusher_tick)
+        fsync_flusher_tick = writer->fsync_interval;
+    }
+
+  /* let the thread exit right away instead of at the end of its tick */
+  if (!fsync_flusher_writers)
+    g_cond_signal(fsync_flusher_cond);
+  g_static_mutex_unlock(&fsync_flusher_lock);
+}
+
 /*
  * log_proto_file_writer_flush:
  *
@@ -56,13 +308,16 @@ log_proto_file_writer_flush(LogProtoClient *s)
   LogProtoFileWriter *self = (LogProtoFileWriter *)s;
   gint rc, i, i0, sum, ofs, pos;
 
+  if (_is_group_commit(self))
+    _ack_synced_messages(self);
+
   if (self->partial)
     {
       /* there is still some data from the previous file writing process */
       gint len = self->partial_len - self->partial_pos;
 
       rc = write(self->fd, self->partial + self->partial_pos, len);
-      if (rc > 0 && self->fsync)
+      if (rc > 0 && self->fsync && !_is_group_commit(self))
         fsync(self->fd);
       if (rc < 0)
         {
@@ -70,11 +325,13 @@ log_proto_file_writer_flush(LogProtoClient *s)
         }
       else if (rc != len)
         {
+          _mark_written(self, rc, FALSE);
           self->partial_pos += rc;
           return LPS_SUCCESS;
         }
       else
         {
+          _mark_written(self, rc, TRUE);
           g_free(self->partial);
           self->partial = NULL;
         }
@@ -82,10 +339,10 @@ log_proto_file_writer_flush(LogProtoClient *s)
 
   /* we might be called from log_writer_deinit() without having a buffer at all */
   if (self->buf_count == 0)
-    return LPS_SUCCESS;
+    goto group_commit;
 
   rc = writev(self->fd, self->buffer, self->buf_count);
-  if (rc > 0 && self->fsync)
+  if (rc > 0 && self->fsync && !_is_group_commit(self))
     fsync(self->fd);
 
   if (rc < 0)
@@ -120,6 +377,7 @@ log_proto_file_writer_flush(LogProtoClient *s)
         }
       self->partial_pos = 0;
     }
+  _mark_written(self, rc, self->partial == NULL);
 
   /* free the previous message strings (the remaning part has been copied to the partial buffer) */
   for (i = 0; i < self->buf_count; ++i)
@@ -127,6 +385,17 @@ log_proto_file_writer_flush(LogProtoClient *s)
   self->buf_count = 0;
   self->sum_len = 0;
 
+group_commit:
+  if (_is_group_commit(self))
+    {
+      gint num_acks = _take_unsynced_acks_if_due(self);
+
+      if (num_acks > 0)
+        {
+          _sync_file(self);
+          log_proto_client_msg_ack(&self->super, num_acks);
+        }
+    }
   return LPS_SUCCESS;
 
 write_error:
@@ -180,7 +449,10 @@ log_proto_file_writer_post(LogProtoClient *s, LogMessage *logmsg, guchar *msg, g
   self->sum_len += msg_len;
 
   *consumed = TRUE;
-  log_proto_client_msg_ack(&self->super, 1);
+  if (_is_group_commit(self))
+    self->pending_acks++;
+  else
+    log_proto_client_msg_ack(&self->super, 1);
 
   if (self->buf_count == self->buf_size)
     {
@@ -202,11 +474,75 @@ log_proto_file_writer_prepare(LogProtoClient *s, gint *fd, GIOCondition *cond)
   /* if there's no pending I/O in the transport layer, then we want to do a write */
   if (*cond == 0)
     *cond = G_IO_OUT;
+
+  if (_is_group_commit(self))
+    {
+      gboolean has_synced_acks;
+
+      g_static_mutex_lock(&self->lock);
+      has_synced_acks = self->synced_acks > 0;
+      g_static_mutex_unlock(&self->lock);
+      if (has_synced_acks)
+        return TRUE;
+    }
   return self->buf_count > 0 || self->partial;
 }
 
+/*
+ * Called by the LogWriter when it stops using us (file reaped, reopened
+ * or the destination deinitialized): the data written so far is synced
+ * and every outstanding message is acked.  Messages still in the output
+ * buffer have not reached write(), they are acked just like without group
+ * commit.
+ */
+static void
+log_proto_file_writer_ack_pending(LogProtoClient *s)
+{
+  LogProtoFileWriter *self = (LogProtoFileWriter *) s;
+  gboolean sync_needed;
+  gint num_acks;
+
+  if (!_is_group_commit(self))
+    return;
+
+  /* the flusher only takes unsynced acks while holding its lock, so
+   * nothing is in flight once a running sync has finished */
+  g_static_mutex_lock(&fsync_flusher_lock);
+  _fsync_flusher_wait_for_sync(self);
+  g_static_mutex_lock(&self->lock);
+  sync_needed = self->unsynced_acks > 0 || self->unsynced_bytes > 0;
+  num_acks = self->pending_acks + self->unsynced_acks + self->synced_acks;
+  self->pending_acks = 0;
+  self->unsynced_acks = 0;
+  self->unsynced_bytes = 0;
+  self->synced_acks = 0;
+  g_static_mutex_unlock(&self->lock);
+  g_static_mutex_unlock(&fsync_flusher_lock);
+
+  if (sync_needed)
+    _sync_file(self);
+  if (num_acks > 0)
+    log_proto_client_msg_ack(&self->super, num_acks);
+}
+
+static void
+log_proto_file_writer_free(LogProtoClient *s)
+{
+  LogProtoFileWriter *self = (LogProtoFileWriter *) s;
+
+  if (_is_group_commit(self))
+    {
+      _fsync_flusher_unregister(self);
+      /* the queue may be gone by now, everything must have been acked in ack_pending() */
+      g_assert(self->pending_acks == 0 && self->unsynced_acks == 0 && self->synced_acks == 0);
+    }
+  g_static_mutex_free(&self->lock);
+  log_proto_client_free_method(s);
+}
+
 LogProtoClient *
-log_proto_file_writer_new(LogTransport *transport, const LogProtoClientOptions *options, gint flush_lines, gint fsync_)
+log_proto_file_writer_new(LogTransport *transport, const LogProtoClientOptions *options, gint flush_lines,
+                          const LogProtoFileWriterFsyncOptions *fsync_options)
 {
   if (flush_lines == 0)
     /* the flush-lines option has not been specified, use a default value */
@@ -224,9 +560,20 @@ log_proto_file_writer_new(LogTransport *transport, const LogProtoClientOptions *
   log_proto_client_init(&self->super, transport, options);
   self->fd = transport->fd;
   self->buf_size = flush_lines;
-  self->fsync = fsync_;
+  self->fsync = fsync_options->enabled;
   self->super.prepare = log_proto_file_writer_prepare;
   self->super.post = log_proto_file_writer_post;
   self->super.flush = log_proto_file_writer_flush;
+  self->super.ack_pending = log_proto_file_writer_ack_pending;
+  self->super.free_fn = log_proto_file_writer_free;
+
+  g_static_mutex_init(&self->lock);
+  if (fsync_options->interval > 0 || fsync_options->bytes > 0)
+    {
+      /* fsync-bytes() alone still syncs idle files once a second */
+      self->fsync_interval = fsync_options->interval > 0 ? fsync_options->interval : 1000;
+      self->fsync_bytes = fsync_options->bytes;
+      _fsync_flusher_register(self);
+    }
   return &self->super;
 }
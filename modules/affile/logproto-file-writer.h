@@ -26,7 +26,15 @@
 
 #include "logproto/logproto-client.h"
 
+typedef struct _LogProtoFileWriterFsyncOptions
+{
+  gboolean enabled;
+  /* group commit: sync after this many msecs or bytes instead of every write */
+  gint interval;
+  gint bytes;
+} LogProtoFileWriterFsyncOptions;
+
 LogProtoClient *log_proto_file_writer_new(LogTransport *transport, const LogProtoClientOptions *options,
-                                          gint flush_lines, gboolean fsync);
+                                          gint flush_lines, const LogProtoFileWriterFsyncOptions *fsync_options);
 
 #endif
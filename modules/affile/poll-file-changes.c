@@ -36,6 +36,13 @@
 #include <iv.h>
 #include <iv_work.h>
 
+#if SYSLOG_NG_HAVE_INOTIFY
+#include <iv_inotify.h>
+#endif
+
+#if SYSLOG_NG_HAVE_INOTIFY
+typedef struct _InotifyFileWatch InotifyFileWatch;
+#endif
 
 typedef struct _PollFileChanges
 {
@@ -45,8 +52,244 @@ typedef struct _PollFileChanges
   gint follow_freq;
   struct iv_timer follow_timer;
   LogPipe *control;
+#if SYSLOG_NG_HAVE_INOTIFY
+  /* while we have an inotify watch, the file is only checked when it
+   * changes, follow_timer is used otherwise */
+  InotifyFileWatch *inotify_watch;
+  gboolean armed;
+  gboolean change_pending;
+  struct iv_task check_task;
+#endif
 } PollFileChanges;
 
+#if SYSLOG_NG_HAVE_INOTIFY
+
+/* a single inotify instance is shared by all followed files */
+static struct iv_inotify shared_inotify;
+static gint shared_inotify_ref_cnt;
+
+static struct iv_inotify *
+_shared_inotify_ref(void)
+{
+  if (shared_inotify_ref_cnt == 0)
+    {
+      IV_INOTIFY_INIT(&shared_inotify);
+      if (iv_inotify_register(&shared_inotify))
+        {
+          msg_debug("poll-file-changes: could not create inotify object, falling back to polling",
+                    evt_tag_errno("errno", errno));
+          return NULL;
+        }
+    }
+  shared_inotify_ref_cnt++;
+  return &shared_inotify;
+}
+
+static void
+_shared_inotify_unref(void)
+{
+  g_assert(shared_inotify_ref_cnt > 0);
+
+  if (--shared_inotify_ref_cnt == 0)
+    iv_inotify_unregister(&shared_inotify);
+}
+
+/*
+ * inotify returns the same watch descriptor for every watch on the same
+ * inode, and removing it stops the events for all of them.  Followers of
+ * the same file (dev, ino) therefore share a single watch, which fans the
+ * events out to them and is removed along with the last follower.
+ */
+struct _InotifyFileWatch
+{
+  struct iv_inotify_watch watch;
+  dev_t dev;
+  ino_t ino;
+  gchar *pathname;
+  GList *followers;
+};
+
+static GHashTable *inotify_file_watches;
+
+static guint
+_inotify_file_watch_hash(gconstpointer k)
+{
+  const InotifyFileWatch *watch = (const InotifyFileWatch *) k;
+
+  return (guint) watch->ino ^ (guint) watch->dev;
+}
+
+static gboolean
+_inotify_file_watch_equal(gconstpointer a, gconstpointer b)
+{
+  const InotifyFileWatch *watch_a = (const InotifyFileWatch *) a;
+  const InotifyFileWatch *watch_b = (const InotifyFileWatch *) b;
+
+  return watch_a->dev == watch_b->dev && watch_a->ino == watch_b->ino;
+}
+
+static void
+_inotify_file_watch_free(InotifyFileWatch *watch, gboolean unregister)
+{
+  g_hash_table_remove(inotify_file_watches, watch);
+  if (g_hash_table_size(inotify_file_watches) == 0)
+    {
+      g_hash_table_destroy(inotify_file_watches);
+      inotify_file_watches = NULL;
+    }
+
+  if (unregister)
+    iv_inotify_watch_unregister(&watch->watch);
+  g_list_free(watch->followers);
+  g_free(watch->pathname);
+  g_free(watch);
+  _shared_inotify_unref();
+}
+
+static void
+_stop_inotify_watch(PollFileChanges *self)
+{
+  InotifyFileWatch *watch = self->inotify_watch;
+
+  if (!watch)
+    return;
+
+  self->inotify_watch = NULL;
+  watch->followers = g_list_remove(watch->followers, self);
+  if (!watch->followers)
+    _inotify_file_watch_free(watch, TRUE);
+}
+
+static void
+_schedule_check(PollFileChanges *self)
+{
+  if (!iv_task_registered(&self->check_task))
+    iv_task_register(&self->check_task);
+}
+
+/* IN_DELETE_SELF is only sent once our fd is closed, an unlinked file
+ * (rm, or another file renamed over it) only gets IN_ATTRIB */
+static gboolean
+_is_unlinked(PollFileChanges *self)
+{
+  struct stat st;
+
+  return fstat(self->fd, &st) == 0 && st.st_nlink == 0;
+}
+
+static void
+_handle_inotify_event(gpointer s, struct inotify_event *event)
+{
+  InotifyFileWatch *watch = (InotifyFileWatch *) s;
+  GList *followers, *l;
+
+  /* all followers have the same file open, any of them can tell if it was unlinked */
+  if ((event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) ||
+      ((event->mask & IN_ATTRIB) && _is_unlinked((PollFileChanges *) watch->followers->data)))
+    {
+      /* the path does not refer to the file anymore, every follower polls
+       * for the appearance of the new one. ivykis drops the watch itself
+       * on IN_IGNORED */
+      followers = watch->followers;
+      watch->followers = NULL;
+      _inotify_file_watch_free(watch, !(event->mask & IN_IGNORED));
+
+      for (l = followers; l; l = l->next)
+        {
+          PollFileChanges *self = (PollFileChanges *) l->data;
+
+          self->inotify_watch = NULL;
+          if (self->armed)
+            _schedule_check(self);
+        }
+      g_list_free(followers);
+      return;
+    }
+
+  for (l = watch->followers; l; l = l->next)
+    {
+      PollFileChanges *self = (PollFileChanges *) l->data;
+
+      if (self->armed)
+        _schedule_check(self);
+      else
+        self->change_pending = TRUE;
+    }
+}
+
+static InotifyFileWatch *
+_inotify_file_watch_new(const gchar *pathname, struct stat *st)
+{
+  struct iv_inotify *inotify;
+  InotifyFileWatch *watch;
+
+  inotify = _shared_inotify_ref();
+  if (!inotify)
+    return NULL;
+
+  watch = g_new0(InotifyFileWatch, 1);
+  watch->dev = st->st_dev;
+  watch->ino = st->st_ino;
+  watch->pathname = g_strdup(pathname);
+
+  IV_INOTIFY_WATCH_INIT(&watch->watch);
+  watch->watch.inotify = inotify;
+  watch->watch.pathname = watch->pathname;
+  watch->watch.mask = IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+  watch->watch.cookie = watch;
+  watch->watch.handler = _handle_inotify_event;
+  if (iv_inotify_watch_register(&watch->watch) < 0)
+    {
+      msg_debug("poll-file-changes: could not add inotify watch, falling back to polling",
+                evt_tag_str("follow_filename", pathname),
+                evt_tag_errno("errno", errno));
+      g_free(watch->pathname);
+      g_free(watch);
+      _shared_inotify_unref();
+      return NULL;
+    }
+
+  if (!inotify_file_watches)
+    inotify_file_watches = g_hash_table_new(_inotify_file_watch_hash, _inotify_file_watch_equal);
+  g_hash_table_insert(inotify_file_watches, watch, watch);
+  return watch;
+}
+
+static void
+_start_inotify_watch(PollFileChanges *self)
+{
+  InotifyFileWatch *watch, key;
+  struct stat st, followed_st;
+
+  if (self->fd < 0 || !self->follow_filename)
+    return;
+
+  /* non-regular files are always reported readable, keep polling them */
+  if (fstat(self->fd, &st) < 0 || !S_ISREG(st.st_mode))
+    return;
+
+  /* the watch is added by name, it is only ours if the name still refers
+   * to our file.  If it does not, polling notices the move */
+  if (stat(self->follow_filename, &followed_st) < 0 ||
+      followed_st.st_dev != st.st_dev || followed_st.st_ino != st.st_ino)
+    return;
+
+  key.dev = st.st_dev;
+  key.ino = st.st_ino;
+  watch = inotify_file_watches ? g_hash_table_lookup(inotify_file_watches, &key) : NULL;
+  if (!watch)
+    watch = _inotify_file_watch_new(self->follow_filename, &st);
+  if (!watch)
+    return;
+
+  watch->followers = g_list_append(watch->followers, self);
+  self->inotify_watch = watch;
+  /* check the contents present at startup */
+  self->change_pending = TRUE;
+}
+
+#endif
+
 /* follow timer callback. Check if the file has new content, or deleted or
  * moved.  Ran every follow_freq seconds.  */
 static void
@@ -66,7 +309,7 @@ poll_file_changes_check_file(gpointer s)
         {
           msg_error("Error invoking seek on followed file",
                     evt_tag_errno("error", errno));
-          goto reschedule;
+          goto error;
         }
 
       if (fstat(fd, &st) < 0)
@@ -82,7 +325,7 @@ poll_file_changes_check_file(gpointer s)
             {
               msg_error("Error invoking fstat() on followed file",
                         evt_tag_errno("error", errno));
-              goto reschedule;
+              goto error;
             }
         }
 
@@ -93,12 +336,20 @@ poll_file_changes_check_file(gpointer s)
       if (pos < st.st_size || !S_ISREG(st.st_mode))
         {
           /* we have data to read */
+#if SYSLOG_NG_HAVE_INOTIFY
+          self->change_pending = TRUE;
+#endif
           poll_events_invoke_callback(s);
           return;
         }
       else if (pos == st.st_size)
         {
-          /* we are at EOF */
+          /* we are at EOF, wait for the next change.  Until then the
+           * change stays pending, as the reader might not drain the file
+           * in one go */
+#if SYSLOG_NG_HAVE_INOTIFY
+          self->change_pending = FALSE;
+#endif
           log_pipe_notify(self->control, NC_FILE_EOF, self);
         }
       else if (pos > st.st_size)
@@ -135,7 +386,14 @@ poll_file_changes_check_file(gpointer s)
           return;
         }
     }
-reschedule:
+  poll_events_update_watches(s, G_IO_IN);
+  return;
+
+error:
+#if SYSLOG_NG_HAVE_INOTIFY
+  /* retry every follow_freq instead of immediately */
+  _stop_inotify_watch(self);
+#endif
   poll_events_update_watches(s, G_IO_IN);
 }
 
@@ -146,6 +404,11 @@ poll_file_changes_stop_watches(PollEvents *s)
 
   if (iv_timer_registered(&self->follow_timer))
     iv_timer_unregister(&self->follow_timer);
+#if SYSLOG_NG_HAVE_INOTIFY
+  if (iv_task_registered(&self->check_task))
+    iv_task_unregister(&self->check_task);
+  self->armed = FALSE;
+#endif
 }
 
 static void
@@ -167,8 +430,19 @@ poll_file_changes_update_watches(PollEvents *s, GIOCondition cond)
 
   poll_file_changes_stop_watches(s);
 
-  if (cond & G_IO_IN)
-    poll_file_changes_rearm_timer(self);
+  if (!(cond & G_IO_IN))
+    return;
+
+#if SYSLOG_NG_HAVE_INOTIFY
+  if (self->inotify_watch)
+    {
+      self->armed = TRUE;
+      if (self->change_pending)
+        _schedule_check(self);
+      return;
+    }
+#endif
+  poll_file_changes_rearm_timer(self);
 }
 
 static void
@@ -176,6 +450,11 @@ poll_file_changes_free(PollEvents *s)
 {
   PollFileChanges *self = (PollFileChanges *) s;
 
+#if SYSLOG_NG_HAVE_INOTIFY
+  if (iv_task_registered(&self->check_task))
+    iv_task_unregister(&self->check_task);
+  _stop_inotify_watch(self);
+#endif
   log_pipe_unref(self->control);
   g_free(self->follow_filename);
 }
@@ -198,5 +477,12 @@ poll_file_changes_new(gint fd, const gchar *follow_filename, gint follow_freq, L
   self->follow_timer.cookie = self;
   self->follow_timer.handler = poll_file_changes_check_file;
 
+#if SYSLOG_NG_HAVE_INOTIFY
+  IV_TASK_INIT(&self->check_task);
+  self->check_task.cookie = self;
+  self->check_task.handler = poll_file_changes_check_file;
+  _start_inotify_watch(self);
+#endif
+
   return &self->super;
 }
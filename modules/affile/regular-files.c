@@ -79,7 +79,7 @@ typedef struct _FileOpenerRegularDestFiles
 {
   FileOpener super;
   const LogWriterOptions *writer_options;
-  gboolean *use_fsync;
+  const LogProtoFileWriterFsyncOptions *fsync_options;
 } FileOpenerRegularDestFiles;
 
 static LogProtoClient *
@@ -89,7 +89,7 @@ _construct_dst_proto(FileOpener *s, LogTransport *transport, LogProtoClientOptio
 
   return log_proto_file_writer_new(transport, proto_options,
                                    self->writer_options->flush_lines,
-                                   *self->use_fsync);
+                                   self->fsync_options);
 }
 
 static LogTransport *
@@ -99,7 +99,8 @@ _construct_transport(FileOpener *s, gint fd)
 }
 
 FileOpener *
-file_opener_for_regular_dest_files_new(const LogWriterOptions *writer_options, gboolean *use_fsync)
+file_opener_for_regular_dest_files_new(const LogWriterOptions *writer_options,
+                                       const LogProtoFileWriterFsyncOptions *fsync_options)
 {
   FileOpenerRegularDestFiles *self = g_new0(FileOpenerRegularDestFiles, 1);
 
@@ -107,6 +108,6 @@ file_opener_for_regular_dest_files_new(const LogWriterOptions *writer_options, g
   self->super.construct_transport = _construct_transport;
   self->super.construct_dst_proto = _construct_dst_proto;
   self->writer_options = writer_options;
-  self->use_fsync = use_fsync;
+  self->fsync_options = fsync_options;
   return &self->super;
 }
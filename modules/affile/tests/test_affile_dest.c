@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+
+#include <criterion/criterion.h>
+#include "affile/affile-dest.h"
+#include "logmsg/logmsg.h"
+#include "mainloop-call.h"
+#include "apphook.h"
+#include "cfg.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <iv.h>
+
+#define NUM_THREADS 4
+#define NUM_MESSAGES_PER_THREAD 100
+#define TEST_TIMEOUT_MSEC 10000
+
+static GlobalConfig *cfg;
+static gchar *tmpdir;
+static AFFileDestDriver *driver;
+static gint threads_ready;
+static gint threads_running;
+static gboolean timed_out;
+
+static void
+_create_driver(gchar *filename_template)
+{
+  LogTemplate *template;
+
+  driver = (AFFileDestDriver *) affile_dd_new(filename_template, cfg);
+  driver->super.super.group = g_strdup("test_group");
+  driver->super.super.id = g_strdup("test_id");
+
+  template = log_template_new(cfg, NULL);
+  cr_assert(log_template_compile(template, "$MSG\n", NULL));
+  driver->writer_options.template = template;
+
+  cr_assert(log_pipe_init(&driver->super.super.super));
+}
+
+static void
+_destroy_driver(void)
+{
+  /* without persistent config, deinit also frees the writers, flushing their queues */
+  cr_assert(log_pipe_deinit(&driver->super.super.super));
+  log_pipe_unref(&driver->super.super.super);
+}
+
+static gpointer
+_quit_main_loop(gpointer user_data)
+{
+  iv_quit();
+  return NULL;
+}
+
+static gpointer
+_send_messages(gpointer user_data)
+{
+  gint thread_index = GPOINTER_TO_INT(user_data);
+  gint i;
+
+  app_thread_start();
+
+  /* start at the same time, so that the first messages race for the new file */
+  g_atomic_int_inc(&threads_ready);
+  while (g_atomic_int_get(&threads_ready) < NUM_THREADS)
+    g_thread_yield();
+
+  for (i = 0; i < NUM_MESSAGES_PER_THREAD; i++)
+    {
+      LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+      LogMessage *msg = log_msg_new_empty();
+      gchar *text = g_strdup_printf("%d-%d", thread_index, i);
+
+      log_msg_set_value(msg, LM_V_HOST, "newhost", -1);
+      log_msg_set_value(msg, LM_V_MESSAGE, text, -1);
+      log_pipe_queue(&driver->super.super.super, msg, &path_options);
+      g_free(text);
+    }
+
+  if (g_atomic_int_dec_and_test(&threads_running))
+    main_loop_call(_quit_main_loop, NULL, TRUE);
+
+  app_thread_stop();
+  return NULL;
+}
+
+static void
+_timeout_expired(gpointer user_data)
+{
+  timed_out = TRUE;
+  iv_quit();
+}
+
+/* the main thread serves the main_loop_call()s of the senders and the LogWriter */
+static void
+_run_senders(void)
+{
+  GThread *threads[NUM_THREADS];
+  struct iv_timer timeout;
+  gint i;
+
+  IV_TIMER_INIT(&timeout);
+  timeout.handler = _timeout_expired;
+  iv_validate_now();
+  timeout.expires = iv_now;
+  timespec_add_msec(&timeout.expires, TEST_TIMEOUT_MSEC);
+  iv_timer_register(&timeout);
+
+  threads_running = NUM_THREADS;
+  for (i = 0; i < NUM_THREADS; i++)
+    threads[i] = g_thread_create(_send_messages, GINT_TO_POINTER(i), TRUE, NULL);
+
+  iv_main();
+  cr_assert_not(timed_out, "sending the messages timed out");
+
+  for (i = 0; i < NUM_THREADS; i++)
+    g_thread_join(threads[i]);
+  if (iv_timer_registered(&timeout))
+    iv_timer_unregister(&timeout);
+}
+
+static void
+_assert_every_message_was_written(const gchar *filename)
+{
+  gint next_seq[NUM_THREADS] = { 0 };
+  gchar *content;
+  gchar **lines;
+  gint i;
+
+  cr_assert(g_file_get_contents(filename, &content, NULL, NULL), "the file was not created: %s", filename);
+  lines = g_strsplit(content, "\n", -1);
+
+  /* messages of one thread are written in the order they were sent */
+  cr_assert_eq(g_strv_length(lines), NUM_THREADS * NUM_MESSAGES_PER_THREAD + 1);
+  for (i = 0; i < NUM_THREADS * NUM_MESSAGES_PER_THREAD; i++)
+    {
+      gint thread_index, seq;
+
+      cr_assert_eq(sscanf(lines[i], "%d-%d", &thread_index, &seq), 2, "unexpected line: %s", lines[i]);
+      cr_assert(thread_index >= 0 && thread_index < NUM_THREADS);
+      cr_assert_eq(seq, next_seq[thread_index], "message out of order or lost: %s", lines[i]);
+      next_seq[thread_index]++;
+    }
+
+  g_strfreev(lines);
+  g_free(content);
+}
+
+Test(affile_dest, messages_sent_concurrently_to_a_new_templated_file_are_all_written)
+{
+  gchar *filename_template = g_build_filename(tmpdir, "${HOST}.log", NULL);
+  gchar *filename = g_build_filename(tmpdir, "newhost.log", NULL);
+
+  _create_driver(filename_template);
+  _run_senders();
+  _destroy_driver();
+
+  _assert_every_message_was_written(filename);
+
+  unlink(filename);
+  g_free(filename);
+  g_free(filename_template);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  main_loop_call_init();
+  cfg = cfg_new_snippet();
+  /* flush the LogWriters in the main thread, no I/O workers are running */
+  cfg->threaded = FALSE;
+
+  tmpdir = g_mkdtemp(g_strdup("affile-destXXXXXX"));
+  cr_assert(tmpdir);
+  threads_ready = 0;
+  timed_out = FALSE;
+}
+
+static void
+teardown(void)
+{
+  rmdir(tmpdir);
+  g_free(tmpdir);
+  cfg_free(cfg);
+  main_loop_call_deinit();
+  app_shutdown();
+}
+
+TestSuite(affile_dest, .init = setup, .fini = teardown);
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "affile/logproto-file-writer.h"
+#include "transport/transport-file.h"
+#include "logwriter.h"
+#include "logqueue-fifo.h"
+#include "cfg.h"
+#include "apphook.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+/* a long interval keeps the flusher thread out of the way, only the
+ * writer itself syncs in these tests */
+#define NEVER_DUE_INTERVAL 600000
+
+static gchar *filename;
+static LogProtoClientOptions proto_options;
+static gint num_acked;
+
+static void
+_count_acks(gint num_msg_acked, gpointer user_data)
+{
+  num_acked += num_msg_acked;
+}
+
+static LogProtoClient *
+_create_writer(gint flush_lines, gint fsync_interval, gint fsync_bytes)
+{
+  LogProtoFileWriterFsyncOptions fsync_options = { FALSE, fsync_interval, fsync_bytes };
+  LogProtoClientFlowControlFuncs flow_control_funcs = { _count_acks, NULL, NULL, NULL };
+  LogProtoClient *proto;
+  gint fd;
+
+  fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  cr_assert(fd >= 0);
+
+  proto = log_proto_file_writer_new(log_transport_file_new(fd), &proto_options, flush_lines, &fsync_options);
+  log_proto_client_set_client_flow_control(proto, &flow_control_funcs);
+  return proto;
+}
+
+static void
+_post(LogProtoClient *proto, const gchar *line)
+{
+  gboolean consumed;
+
+  cr_assert_eq(log_proto_client_post(proto, NULL, (guchar *) g_strdup(line), strlen(line), &consumed), LPS_SUCCESS);
+  cr_assert(consumed);
+}
+
+static void
+_assert_file_content(const gchar *expected)
+{
+  gchar *content;
+
+  cr_assert(g_file_get_contents(filename, &content, NULL, NULL));
+  cr_assert_str_eq(content, expected);
+  g_free(content);
+}
+
+Test(file_writer_group_commit, written_messages_are_not_acked_before_sync)
+{
+  LogProtoClient *proto = _create_writer(1, NEVER_DUE_INTERVAL, 0);
+
+  _post(proto, "foo\n");
+  _post(proto, "bar\n");
+  cr_assert_eq(log_proto_client_flush(proto), LPS_SUCCESS);
+
+  _assert_file_content("foo\nbar\n");
+  cr_assert_eq(num_acked, 0);
+
+  log_proto_client_ack_pending(proto);
+  log_proto_client_free(proto);
+}
+
+Test(file_writer_group_commit, messages_are_acked_once_fsync_bytes_are_synced)
+{
+  LogProtoClient *proto = _create_writer(1, NEVER_DUE_INTERVAL, 8);
+
+  _post(proto, "foo\n");
+  cr_assert_eq(num_acked, 0);
+
+  _post(proto, "bar\n");
+  cr_assert_eq(num_acked, 2);
+
+  _post(proto, "baz\n");
+  cr_assert_eq(num_acked, 2);
+
+  log_proto_client_ack_pending(proto);
+  log_proto_client_free(proto);
+}
+
+Test(file_writer_group_commit, outstanding_messages_are_acked_by_ack_pending)
+{
+  LogProtoClient *proto = _create_writer(2, NEVER_DUE_INTERVAL, 0);
+
+  /* the first two are written but not synced, the third is still buffered */
+  _post(proto, "foo\n");
+  _post(proto, "bar\n");
+  _post(proto, "baz\n");
+  cr_assert_eq(num_acked, 0);
+
+  log_proto_client_ack_pending(proto);
+  cr_assert_eq(num_acked, 3);
+  _assert_file_content("foo\nbar\n");
+
+  log_proto_client_free(proto);
+  cr_assert_eq(num_acked, 3);
+}
+
+Test(file_writer_group_commit, writers_can_be_recreated_after_the_last_one_is_freed)
+{
+  LogProtoClient *proto = _create_writer(1, NEVER_DUE_INTERVAL, 0);
+
+  _post(proto, "foo\n");
+  log_proto_client_ack_pending(proto);
+  log_proto_client_free(proto);
+  cr_assert_eq(num_acked, 1);
+
+  proto = _create_writer(1, NEVER_DUE_INTERVAL, 4);
+  _post(proto, "bar\n");
+  cr_assert_eq(num_acked, 2);
+  log_proto_client_free(proto);
+}
+
+Test(file_writer_group_commit, messages_are_acked_on_post_without_group_commit)
+{
+  LogProtoClient *proto = _create_writer(2, 0, 0);
+
+  _post(proto, "foo\n");
+  cr_assert_eq(num_acked, 1);
+
+  log_proto_client_free(proto);
+  cr_assert_eq(num_acked, 1);
+}
+
+static void
+_ack_counting_message(LogMessage *msg, AckType ack_type)
+{
+  num_acked++;
+}
+
+static void
+_queue_message(LogWriter *writer, const gchar *text)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg = log_msg_new_empty();
+
+  log_msg_set_value(msg, LM_V_MESSAGE, text, -1);
+  path_options.ack_needed = TRUE;
+  path_options.flow_control_requested = TRUE;
+  log_msg_add_ack(msg, &path_options);
+  msg->ack_func = _ack_counting_message;
+  log_pipe_queue(&writer->super, msg, &path_options);
+}
+
+/* the same order as affile_dw_deinit(): the queue is dropped right after deinit */
+Test(file_writer_group_commit, log_writer_acks_outstanding_messages_before_dropping_its_queue)
+{
+  GlobalConfig *cfg = cfg_new_snippet();
+  LogWriterOptions writer_options;
+  LogTemplate *template;
+  LogWriter *writer;
+
+  log_writer_options_defaults(&writer_options);
+  template = log_template_new(cfg, NULL);
+  cr_assert(log_template_compile(template, "$MSG\n", NULL));
+  writer_options.template = template;
+  writer_options.options |= LWO_NO_STATS;
+  log_writer_options_init(&writer_options, cfg, 0);
+
+  writer = log_writer_new(0, cfg);
+  log_writer_set_options(writer, NULL, &writer_options, NULL, NULL);
+  log_writer_set_queue(writer, log_queue_fifo_new(100, NULL));
+  cr_assert(log_pipe_init(&writer->super));
+  log_writer_reopen(writer, _create_writer(10, NEVER_DUE_INTERVAL, 0));
+
+  _queue_message(writer, "foo");
+  _queue_message(writer, "bar");
+  cr_assert_eq(num_acked, 0);
+
+  /* LW_FLUSH_FORCE writes the queued messages, but they are not synced yet */
+  cr_assert(log_pipe_deinit(&writer->super));
+  cr_assert_eq(num_acked, 2);
+  _assert_file_content("foo\nbar\n");
+
+  log_writer_set_queue(writer, NULL);
+  log_pipe_unref(&writer->super);
+  log_writer_options_destroy(&writer_options);
+  cfg_free(cfg);
+}
+
+static void
+setup(void)
+{
+  gint fd;
+
+  app_startup();
+  log_proto_client_options_defaults(&proto_options);
+  num_acked = 0;
+
+  fd = g_file_open_tmp("group-commitXXXXXX", &filename, NULL);
+  cr_assert(fd >= 0);
+  close(fd);
+}
+
+static void
+teardown(void)
+{
+  unlink(filename);
+  g_free(filename);
+  app_shutdown();
+}
+
+TestSuite(file_writer_group_commit, .init = setup, .fini = teardown);
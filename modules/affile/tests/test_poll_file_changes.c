@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include "affile/poll-file-changes.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "logpipe.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <iv.h>
+
+/* with a follow-freq() this long, only inotify can wake the tests up in
+ * time.  Once the followed file is gone, polling takes over, so that test
+ * uses a short one */
+#define FOLLOW_FREQ_NEVER 3600000
+#define FOLLOW_FREQ_FALLBACK 10
+#define TEST_TIMEOUT_MSEC 5000
+
+typedef struct _TestState
+{
+  PollEvents *poll_events;
+  gint fd;
+  gint read_size;
+  GString *data_read;
+  gint num_eof;
+  gint num_moved;
+  gboolean timed_out;
+  gint stop_at_eof;
+  /* changes the file once the first EOF was seen */
+  struct iv_task change_task;
+  struct iv_timer timeout;
+} TestState;
+
+static GlobalConfig *cfg;
+static gchar *filename;
+static TestState state;
+
+static void
+_write_file(const gchar *path, const gchar *content, gint flags)
+{
+  gint fd = open(path, O_WRONLY | O_CREAT | flags, 0600);
+
+  cr_assert(fd >= 0);
+  cr_assert(write(fd, content, strlen(content)) == strlen(content));
+  close(fd);
+}
+
+/* a reader that only consumes read_size bytes per invocation */
+static void
+_read_some(gpointer user_data)
+{
+  gchar buf[64];
+  gint rc;
+
+  rc = read(state.fd, buf, MIN(state.read_size, sizeof(buf)));
+  cr_assert(rc >= 0);
+  g_string_append_len(state.data_read, buf, rc);
+  poll_events_update_watches(state.poll_events, G_IO_IN);
+}
+
+static void
+_control_notify(LogPipe *s, gint notify_code, gpointer user_data)
+{
+  switch (notify_code)
+    {
+    case NC_FILE_EOF:
+      state.num_eof++;
+      if (state.num_eof == 1 && state.change_task.handler)
+        iv_task_register(&state.change_task);
+      if (state.num_eof == state.stop_at_eof)
+        iv_quit();
+      break;
+    case NC_FILE_MOVED:
+      state.num_moved++;
+      iv_quit();
+      break;
+    default:
+      break;
+    }
+}
+
+static void
+_timeout_expired(gpointer user_data)
+{
+  state.timed_out = TRUE;
+  iv_quit();
+}
+
+static void
+_run_until_quit(void)
+{
+  IV_TIMER_INIT(&state.timeout);
+  state.timeout.handler = _timeout_expired;
+  iv_validate_now();
+  state.timeout.expires = iv_now;
+  timespec_add_msec(&state.timeout.expires, TEST_TIMEOUT_MSEC);
+  iv_timer_register(&state.timeout);
+
+  iv_main();
+
+  if (iv_timer_registered(&state.timeout))
+    iv_timer_unregister(&state.timeout);
+  if (state.change_task.handler && iv_task_registered(&state.change_task))
+    iv_task_unregister(&state.change_task);
+  poll_events_stop_watches(state.poll_events);
+}
+
+static void
+_start_following(gint follow_freq, gboolean from_the_end, void (*change)(gpointer))
+{
+  LogPipe *control = log_pipe_new(cfg);
+
+  state.fd = open(filename, O_RDONLY);
+  cr_assert(state.fd >= 0);
+  if (from_the_end)
+    lseek(state.fd, 0, SEEK_END);
+
+  if (change)
+    {
+      IV_TASK_INIT(&state.change_task);
+      state.change_task.handler = change;
+    }
+
+  control->notify = _control_notify;
+  state.poll_events = poll_file_changes_new(state.fd, filename, follow_freq, control);
+  log_pipe_unref(control);
+
+  poll_events_set_callback(state.poll_events, _read_some, NULL);
+  poll_events_update_watches(state.poll_events, G_IO_IN);
+}
+
+#if SYSLOG_NG_HAVE_INOTIFY
+
+static void
+_append_to_file(gpointer user_data)
+{
+  _write_file(filename, "new data", O_APPEND);
+}
+
+static void
+_remove_and_recreate_file(gpointer user_data)
+{
+  cr_assert(unlink(filename) == 0);
+  _write_file(filename, "recreated", O_TRUNC);
+}
+
+Test(poll_file_changes, file_is_checked_again_until_the_reader_reaches_eof)
+{
+  _write_file(filename, "0123456789", O_TRUNC);
+  state.read_size = 3;
+  state.stop_at_eof = 1;
+
+  _start_following(FOLLOW_FREQ_NEVER, FALSE, NULL);
+  _run_until_quit();
+
+  cr_assert_not(state.timed_out, "the reader was not called again before reaching EOF");
+  cr_assert_str_eq(state.data_read->str, "0123456789");
+}
+
+Test(poll_file_changes, appended_data_is_noticed_without_polling)
+{
+  _write_file(filename, "initial", O_TRUNC);
+  state.read_size = 64;
+  state.stop_at_eof = 2;
+
+  _start_following(FOLLOW_FREQ_NEVER, TRUE, _append_to_file);
+  _run_until_quit();
+
+  cr_assert_not(state.timed_out, "appending to the file was not noticed");
+  cr_assert_str_eq(state.data_read->str, "new data");
+}
+
+Test(poll_file_changes, removed_and_recreated_file_is_noticed)
+{
+  _write_file(filename, "initial", O_TRUNC);
+  state.read_size = 64;
+
+  _start_following(FOLLOW_FREQ_FALLBACK, TRUE, _remove_and_recreate_file);
+  _run_until_quit();
+
+  cr_assert_not(state.timed_out, "removing and recreating the file was not noticed");
+  cr_assert_eq(state.num_moved, 1);
+}
+
+static gint other_num_changes;
+
+static void
+_count_other_changes(gpointer user_data)
+{
+  other_num_changes++;
+}
+
+/* a second follower of the same file, opened at its end */
+static PollEvents *
+_start_other_follower(gint *fd)
+{
+  LogPipe *control = log_pipe_new(cfg);
+  PollEvents *other;
+
+  *fd = open(filename, O_RDONLY);
+  cr_assert(*fd >= 0);
+  lseek(*fd, 0, SEEK_END);
+
+  other_num_changes = 0;
+  other = poll_file_changes_new(*fd, filename, FOLLOW_FREQ_NEVER, control);
+  log_pipe_unref(control);
+
+  poll_events_set_callback(other, _count_other_changes, NULL);
+  poll_events_update_watches(other, G_IO_IN);
+  return other;
+}
+
+Test(poll_file_changes, changes_are_noticed_by_every_follower_of_the_same_file)
+{
+  PollEvents *other;
+  gint other_fd;
+
+  _write_file(filename, "initial", O_TRUNC);
+  state.read_size = 64;
+  state.stop_at_eof = 2;
+
+  other = _start_other_follower(&other_fd);
+  _start_following(FOLLOW_FREQ_NEVER, TRUE, _append_to_file);
+  _run_until_quit();
+
+  cr_assert_not(state.timed_out, "appending to the file was not noticed");
+  cr_assert_str_eq(state.data_read->str, "new data");
+
+  /* the check of the other follower was scheduled before our second one */
+  cr_assert(other_num_changes > 0, "the other follower did not notice the change");
+  poll_events_free(other);
+  close(other_fd);
+}
+
+Test(poll_file_changes, freeing_a_follower_keeps_the_watch_of_the_others)
+{
+  PollEvents *other;
+  gint other_fd;
+
+  _write_file(filename, "initial", O_TRUNC);
+  state.read_size = 64;
+  state.stop_at_eof = 2;
+
+  /* inotify returns the same watch descriptor to both followers, removing
+   * it for the other one must not stop our notifications */
+  other = _start_other_follower(&other_fd);
+  _start_following(FOLLOW_FREQ_NEVER, TRUE, _append_to_file);
+  poll_events_free(other);
+  close(other_fd);
+
+  _run_until_quit();
+
+  cr_assert_not(state.timed_out, "appending to the file was not noticed");
+  cr_assert_str_eq(state.data_read->str, "new data");
+}
+
+#endif
+
+static void
+setup(void)
+{
+  gint fd;
+
+  app_startup();
+  cfg = cfg_new_snippet();
+  memset(&state, 0, sizeof(state));
+  state.data_read = g_string_new("");
+
+  fd = g_file_open_tmp("poll-file-changesXXXXXX", &filename, NULL);
+  cr_assert(fd >= 0);
+  close(fd);
+}
+
+static void
+teardown(void)
+{
+  poll_events_free(state.poll_events);
+  close(state.fd);
+  g_string_free(state.data_read, TRUE);
+  unlink(filename);
+  g_free(filename);
+  cfg_free(cfg);
+  app_shutdown();
+}
+
+TestSuite(poll_file_changes, .init = setup, .fini = teardown);
@@ -33,6 +33,8 @@ static CfgLexerKeyword afmongodb_keywords[] =
   { "mongodb", KW_MONGODB },
   { "uri", KW_URI },
   { "collection", KW_COLLECTION },
+  { "bulk_size", KW_BATCH_LINES },
+  { "bulk_timeout", KW_BATCH_TIMEOUT },
 #if SYSLOG_NG_ENABLE_LEGACY_MONGODB_OPTIONS
   { "servers", KW_SERVERS, KWS_OBSOLETE, "Use the uri() option instead of servers()" },
   { "database", KW_DATABASE, KWS_OBSOLETE, "Use the uri() option instead of database()" },
@@ -69,9 +69,13 @@ typedef struct _MongoDBDestDriver
   mongoc_uri_t *uri_obj;
   mongoc_client_t *client;
   mongoc_collection_t *coll_obj;
+  /* unordered bulk insert collecting the current batch */
+  mongoc_bulk_operation_t *bulk;
 
   GString *current_value;
   bson_t *bson;
 } MongoDBDestDriver;
 
+gint afmongodb_dd_private_count_rejected_documents(LogDriver *d, const bson_t *reply);
+
 #endif
@@ -140,11 +140,20 @@ _format_persist_name(const LogPipe *s)
          : _format_instance_id(self, "afmongodb(%s)");
 }
 
+static void
+_discard_bulk(MongoDBDestDriver *self)
+{
+  if (self->bulk)
+    mongoc_bulk_operation_destroy(self->bulk);
+  self->bulk = NULL;
+}
+
 static void
 _worker_disconnect(LogThrDestDriver *s)
 {
   MongoDBDestDriver *self = (MongoDBDestDriver *)s;
 
+  _discard_bulk(self);
   mongoc_client_destroy(self->client);
   self->client = NULL;
 }
@@ -371,14 +380,144 @@ _worker_retry_over_message(LogThrDestDriver *s, LogMessage *msg)
                                 LTZ_SEND, &self->template_options));
 }
 
+static worker_insert_result_t
+_map_insert_error(MongoDBDestDriver *self, const bson_error_t *error)
+{
+  if (error->domain == MONGOC_ERROR_STREAM)
+    {
+      msg_error("Network error while inserting into MongoDB",
+                evt_tag_int("time_reopen", self->super.time_reopen),
+                evt_tag_str("reason", error->message),
+                evt_tag_str("driver", self->super.super.super.id));
+      return WORKER_INSERT_RESULT_NOT_CONNECTED;
+    }
+
+  msg_error("Failed to insert into MongoDB",
+            evt_tag_int("time_reopen", self->super.time_reopen),
+            evt_tag_str("reason", error->message),
+            evt_tag_str("driver", self->super.super.super.id));
+  return WORKER_INSERT_RESULT_ERROR;
+}
+
+static gboolean
+_reply_has_errors(const bson_t *reply, const gchar *field, bson_iter_t *errors)
+{
+  bson_iter_t iter;
+
+  return bson_iter_init_find(&iter, reply, field) &&
+         BSON_ITER_HOLDS_ARRAY(&iter) &&
+         bson_iter_recurse(&iter, errors) &&
+         bson_iter_next(errors);
+}
+
+/*
+ * The bulk is unordered, so documents rejected by the server
+ * ("writeErrors", e.g. a duplicate key or a failed validation) do not
+ * prevent the rest of the batch from being written.  Returns the number of
+ * rejected documents, or -1 if the failure affects the whole bulk (no
+ * writeErrors, or a write concern error).
+ */
+gint
+afmongodb_dd_private_count_rejected_documents(LogDriver *d, const bson_t *reply)
+{
+  MongoDBDestDriver *self = (MongoDBDestDriver *)d;
+  bson_iter_t errors, doc;
+  gint num_rejected = 0;
+
+  if (_reply_has_errors(reply, "writeConcernErrors", &errors) ||
+      !_reply_has_errors(reply, "writeErrors", &errors))
+    return -1;
+
+  do
+    {
+      gint32 index = -1;
+      const gchar *errmsg = "";
+
+      if (!BSON_ITER_HOLDS_DOCUMENT(&errors) || !bson_iter_recurse(&errors, &doc))
+        continue;
+
+      while (bson_iter_next(&doc))
+        {
+          if (strcmp(bson_iter_key(&doc), "index") == 0 && BSON_ITER_HOLDS_INT32(&doc))
+            index = bson_iter_int32(&doc);
+          else if (strcmp(bson_iter_key(&doc), "errmsg") == 0 && BSON_ITER_HOLDS_UTF8(&doc))
+            errmsg = bson_iter_utf8(&doc, NULL);
+        }
+
+      msg_error("MongoDB rejected document in bulk insert, message dropped",
+                evt_tag_int("index", index),
+                evt_tag_str("reason", errmsg),
+                evt_tag_str("driver", self->super.super.super.id));
+      num_rejected++;
+    }
+  while (bson_iter_next(&errors));
+
+  return num_rejected;
+}
+
+/*
+ * Rejected documents would be rejected again, so they are dropped, while
+ * any other failure rewinds the whole batch.  The backlog is acknowledged
+ * in order either way, only the counters tell written and rejected
+ * documents apart.
+ */
+static worker_insert_result_t
+_drop_rejected_documents(MongoDBDestDriver *self, const bson_t *reply, const bson_error_t *error,
+                         gint num_documents)
+{
+  gint num_rejected;
+
+  if (error->domain == MONGOC_ERROR_STREAM)
+    return _map_insert_error(self, error);
+
+  num_rejected = afmongodb_dd_private_count_rejected_documents(&self->super.super.super, reply);
+  if (num_rejected < 0)
+    return _map_insert_error(self, error);
+
+  num_rejected = MIN(num_rejected, num_documents);
+  log_threaded_dest_driver_accept_batch_head(&self->super, num_documents - num_rejected);
+  log_threaded_dest_driver_drop_batch_head(&self->super, num_rejected);
+  return WORKER_INSERT_RESULT_SUCCESS;
+}
+
+/* @num_documents is the number of messages at the head of the batch that are in the bulk */
+static worker_insert_result_t
+_execute_bulk(MongoDBDestDriver *self, gint num_documents)
+{
+  worker_insert_result_t result = WORKER_INSERT_RESULT_SUCCESS;
+  bson_error_t error;
+  bson_t reply;
+
+  if (!self->bulk)
+    return WORKER_INSERT_RESULT_SUCCESS;
+
+  if (!mongoc_bulk_operation_execute(self->bulk, &reply, &error))
+    result = _drop_rejected_documents(self, &reply, &error, num_documents);
+
+  bson_destroy(&reply);
+  _discard_bulk(self);
+
+  return result;
+}
+
+static worker_insert_result_t
+_worker_flush(LogThrDestDriver *s)
+{
+  MongoDBDestDriver *self = (MongoDBDestDriver *)s;
+
+  return _execute_bulk(self, s->batch_size);
+}
+
 static worker_insert_result_t
 _worker_insert(LogThrDestDriver *s, LogMessage *msg)
 {
   MongoDBDestDriver *self = (MongoDBDestDriver *)s;
   gboolean success;
   gboolean drop_silently = self->template_options.on_error & ON_ERROR_SILENT;
+  gboolean bulk_mode = s->batch_lines > 0;
 
-  if (!_connect(self, TRUE))
+  /* within a bulk, the connection was checked with its first message */
+  if (!self->bulk && !_connect(self, TRUE))
     return WORKER_INSERT_RESULT_NOT_CONNECTED;
 
   bson_reinit(self->bson);
@@ -401,6 +540,17 @@ _worker_insert(LogThrDestDriver *s, LogMessage *msg)
                                         LTZ_SEND, &self->template_options),
                     evt_tag_str("driver", self->super.super.super.id));
         }
+
+      if (self->bulk)
+        {
+          /* write the messages preceding this one, so that the drop
+           * applies to this message only */
+          worker_insert_result_t result = _execute_bulk(self, s->batch_size - 1);
+
+          if (result != WORKER_INSERT_RESULT_SUCCESS)
+            return result;
+          log_threaded_dest_driver_accept_batch_head(s, s->batch_size - 1);
+        }
       return WORKER_INSERT_RESULT_DROP;
     }
 
@@ -409,28 +559,20 @@ _worker_insert(LogThrDestDriver *s, LogMessage *msg)
                                 &self->template_options),
             evt_tag_str("driver", self->super.super.super.id));
 
+  if (bulk_mode)
+    {
+      if (!self->bulk)
+        self->bulk = mongoc_collection_create_bulk_operation(self->coll_obj, FALSE, NULL);
+
+      mongoc_bulk_operation_insert(self->bulk, (const bson_t *)self->bson);
+      return WORKER_INSERT_RESULT_QUEUED;
+    }
+
   bson_error_t error;
   success = mongoc_collection_insert(self->coll_obj, MONGOC_INSERT_NONE,
                                      (const bson_t *)self->bson, NULL, &error);
   if (!success)
-    {
-      if (error.domain == MONGOC_ERROR_STREAM)
-        {
-          msg_error("Network error while inserting into MongoDB",
-                    evt_tag_int("time_reopen", self->super.time_reopen),
-                    evt_tag_str("reason", error.message),
-                    evt_tag_str("driver", self->super.super.super.id));
-          return WORKER_INSERT_RESULT_NOT_CONNECTED;
-        }
-      else
-        {
-          msg_error("Failed to insert into MongoDB",
-                    evt_tag_int("time_reopen", self->super.time_reopen),
-                    evt_tag_str("reason", error.message),
-                    evt_tag_str("driver", self->super.super.super.id));
-          return WORKER_INSERT_RESULT_ERROR;
-        }
-    }
+    return _map_insert_error(self, &error);
 
   return WORKER_INSERT_RESULT_SUCCESS;
 }
@@ -492,6 +634,8 @@ _worker_thread_deinit(LogThrDestDriver *d)
 {
   MongoDBDestDriver *self = (MongoDBDestDriver *)d;
 
+  _discard_bulk(self);
+
   if (self->current_value)
     {
       g_string_free(self->current_value, TRUE);
@@ -593,6 +737,7 @@ afmongodb_dd_new(GlobalConfig *cfg)
   self->super.worker.thread_deinit = _worker_thread_deinit;
   self->super.worker.disconnect = _worker_disconnect;
   self->super.worker.insert = _worker_insert;
+  self->super.worker.flush = _worker_flush;
   self->super.format.stats_instance = _format_stats_instance;
   self->super.stats_source = SCS_MONGODB;
   self->super.messages.retry_over = _worker_retry_over_message;
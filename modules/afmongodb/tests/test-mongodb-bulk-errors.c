@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "modules/afmongodb/afmongodb.h"
+#include "modules/afmongodb/afmongodb-private.h"
+#include "apphook.h"
+#include "cfg.h"
+
+static GlobalConfig *cfg;
+static LogDriver *driver;
+
+static gint
+_count_rejected(bson_t *reply)
+{
+  gint num_rejected = afmongodb_dd_private_count_rejected_documents(driver, reply);
+
+  bson_destroy(reply);
+  return num_rejected;
+}
+
+Test(mongodb_bulk_errors, each_write_error_is_a_rejected_document)
+{
+  bson_t *reply = BCON_NEW("nInserted", BCON_INT32(3),
+                           "writeErrors", "[",
+                           "{", "index", BCON_INT32(1), "code", BCON_INT32(11000),
+                           "errmsg", BCON_UTF8("E11000 duplicate key error"), "}",
+                           "{", "index", BCON_INT32(4), "code", BCON_INT32(121),
+                           "errmsg", BCON_UTF8("Document failed validation"), "}",
+                           "]");
+
+  cr_assert_eq(_count_rejected(reply), 2);
+}
+
+Test(mongodb_bulk_errors, write_errors_that_are_not_documents_are_ignored)
+{
+  bson_t *reply = BCON_NEW("writeErrors", "[",
+                           BCON_UTF8("garbage"),
+                           "{", "index", BCON_INT32(0), "errmsg", BCON_UTF8("duplicate key"), "}",
+                           "]");
+
+  cr_assert_eq(_count_rejected(reply), 1);
+}
+
+Test(mongodb_bulk_errors, write_concern_errors_affect_the_whole_bulk)
+{
+  bson_t *reply = BCON_NEW("writeErrors", "[",
+                           "{", "index", BCON_INT32(0), "errmsg", BCON_UTF8("duplicate key"), "}",
+                           "]",
+                           "writeConcernErrors", "[",
+                           "{", "code", BCON_INT32(64), "errmsg", BCON_UTF8("waiting for replication timed out"), "}",
+                           "]");
+
+  cr_assert_eq(_count_rejected(reply), -1);
+}
+
+Test(mongodb_bulk_errors, failure_without_write_errors_affects_the_whole_bulk)
+{
+  cr_assert_eq(_count_rejected(BCON_NEW("nInserted", BCON_INT32(0))), -1);
+  cr_assert_eq(_count_rejected(BCON_NEW("writeErrors", "[", "]")), -1);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  cfg = cfg_new_snippet();
+  driver = afmongodb_dd_new(cfg);
+}
+
+static void
+teardown(void)
+{
+  log_pipe_unref(&driver->super);
+  cfg_free(cfg);
+  app_shutdown();
+}
+
+TestSuite(mongodb_bulk_errors, .init = setup, .fini = teardown);
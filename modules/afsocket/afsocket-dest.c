@@ -523,6 +523,13 @@ afsocket_dd_init(LogPipe *s)
       return _dd_init_stream(self);
     }
 
+  if (self->writer_options.proto_options.super.send_buffer_size > 0)
+    {
+      msg_error("send-buffer-size() is only supported for stream based transports",
+                evt_tag_str("transport", self->transport_mapper->transport));
+      return FALSE;
+    }
+
   return _dd_init_dgram(self);
 }
 
@@ -45,6 +45,8 @@ typedef struct _AFSocketSourceConnection
   struct _AFSocketSourceDriver *owner;
   LogReader *reader;
   int sock;
+  /* index of the dgram listener socket, see listeners() */
+  gint listener_index;
   GSockAddr *peer_addr;
 } AFSocketSourceConnection;
 
@@ -62,6 +64,10 @@ afsocket_sc_stats_instance(AFSocketSourceConnection *self)
       if (self->owner->bind_addr)
         {
           g_sockaddr_format(self->owner->bind_addr, buf, sizeof(buf), GSA_ADDRESS_ONLY);
+
+          /* separate counters for each SO_REUSEPORT listener */
+          if (self->owner->num_listeners > 1)
+            g_snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), "#%d", self->listener_index);
           return buf;
         }
       else
@@ -268,6 +274,14 @@ afsocket_sd_set_listen_backlog(LogDriver *s, gint listen_backlog)
   self->listen_backlog = listen_backlog;
 }
 
+void
+afsocket_sd_set_listeners(LogDriver *s, gint num_listeners)
+{
+  AFSocketSourceDriver *self = (AFSocketSourceDriver *) s;
+
+  self->num_listeners = num_listeners;
+}
+
 static const gchar *
 afsocket_sd_format_name(const LogPipe *s)
 {
@@ -353,6 +367,8 @@ afsocket_sd_process_connection(AFSocketSourceDriver *self, GSockAddr *client_add
       AFSocketSourceConnection *conn;
 
       conn = afsocket_sc_new(client_addr, fd, self->super.super.super.cfg);
+      /* dgram listeners are opened in order, so this is the index of the listener */
+      conn->listener_index = self->num_connections;
       afsocket_sc_set_owner(conn, self);
       if (log_pipe_init(&conn->super))
         {
@@ -511,10 +527,59 @@ afsocket_sd_setup_transport(AFSocketSourceDriver *self)
       return FALSE;
     }
 
+  if (self->num_listeners > 1)
+    {
+      if (self->transport_mapper->sock_type == SOCK_STREAM)
+        {
+          /* accept() runs in the main thread and each connection has its
+           * own reader already, multiple listeners would not help */
+          msg_warning("WARNING: listeners() is only supported for datagram based transports, using a single listener",
+                      evt_tag_int("listeners", self->num_listeners),
+                      log_pipe_location_tag(&self->super.super.super));
+          self->num_listeners = 1;
+        }
+      else
+        {
+          self->socket_options->so_reuseport = TRUE;
+          self->max_connections = MAX(self->max_connections, self->num_listeners);
+        }
+    }
+
   afsocket_sd_setup_reader_options(self);
+
+  /* receive as many datagrams with one syscall as the reader would fetch in one go */
+  self->transport_mapper->dgram_batch_size = self->reader_options.fetch_limit;
   return TRUE;
 }
 
+/*
+ * Restored dgram listeners were opened for the listeners() value of the
+ * previous configuration.  A single listener is bound without
+ * SO_REUSEPORT, so no further listener could bind next to it, and
+ * surplus listeners would keep their readers running: all of them are
+ * reopened when the number changes.
+ */
+static void
+afsocket_sd_drop_restored_listeners_if_changed(AFSocketSourceDriver *self)
+{
+  GList *l;
+
+  if (self->transport_mapper->sock_type == SOCK_STREAM || !self->connections)
+    return;
+
+  if (g_list_length(self->connections) == self->num_listeners)
+    return;
+
+  msg_verbose("The number of listeners changed, reopening listener sockets",
+              evt_tag_int("listeners", self->num_listeners),
+              log_pipe_location_tag(&self->super.super.super));
+
+  for (l = self->connections; l; l = l->next)
+    afsocket_sd_kill_connection((AFSocketSourceConnection *) l->data);
+  g_list_free(self->connections);
+  self->connections = NULL;
+}
+
 static gboolean
 afsocket_sd_restore_kept_alive_connections(AFSocketSourceDriver *self)
 {
@@ -525,6 +590,7 @@ afsocket_sd_restore_kept_alive_connections(AFSocketSourceDriver *self)
     {
       GList *p = NULL;
       self->connections = cfg_persist_config_fetch(cfg, afsocket_sd_format_connections_name(self));
+      afsocket_sd_drop_restored_listeners_if_changed(self);
 
       self->num_connections = 0;
       for (p = self->connections; p; p = p->next)
@@ -594,25 +660,44 @@ _sd_open_stream(AFSocketSourceDriver *self)
   return transport_mapper_async_init(self->transport_mapper, _finalize_init, self);
 }
 
+/*
+ * Each dgram listener socket is a separate connection with its own
+ * LogReader, so with listeners(N) > 1 the kernel distributes incoming
+ * datagrams between N SO_REUSEPORT sockets, drained by N readers in
+ * parallel.  Listeners restored from the persistent config are kept,
+ * only the missing ones are opened.
+ */
 static gboolean
 _sd_open_dgram(AFSocketSourceDriver *self)
 {
-  gint sock = -1;
-  if (!self->connections)
+  gint i;
+
+  self->fd = -1;
+  for (i = g_list_length(self->connections); i < self->num_listeners; i++)
     {
-      if (!afsocket_sd_acquire_socket(self, &sock))
+      gint sock = -1;
+
+      if (i == 0 && !afsocket_sd_acquire_socket(self, &sock))
         return self->super.super.optional;
+
+      if (sock != -1 && self->num_listeners > 1)
+        {
+          msg_warning("WARNING: listeners() is ignored for sockets acquired from the runtime environment",
+                      evt_tag_int("listeners", self->num_listeners),
+                      log_pipe_location_tag(&self->super.super.super));
+          self->num_listeners = 1;
+        }
+
       if (sock == -1
           && !transport_mapper_open_socket(self->transport_mapper, self->socket_options, self->bind_addr, AFSOCKET_DIR_RECV,
                                            &sock))
         return self->super.super.optional;
+
+      if (!afsocket_sd_process_connection(self, NULL, self->bind_addr, sock))
+        return FALSE;
     }
-  self->fd = -1;
 
-  /* we either have self->connections != NULL, or sock contains a new fd */
-  if (self->connections || afsocket_sd_process_connection(self, NULL, self->bind_addr, sock))
-    return transport_mapper_init(self->transport_mapper);
-  return FALSE;
+  return transport_mapper_init(self->transport_mapper);
 }
 
 static gboolean
@@ -763,6 +848,7 @@ afsocket_sd_init_instance(AFSocketSourceDriver *self,
   self->transport_mapper = transport_mapper;
   self->max_connections = 10;
   self->listen_backlog = 255;
+  self->num_listeners = 1;
   self->connections_kept_alive_across_reloads = TRUE;
   log_reader_options_defaults(&self->reader_options);
   self->reader_options.super.stats_level = STATS_LEVEL1;
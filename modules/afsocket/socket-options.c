@@ -25,6 +25,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <errno.h>
 
 gboolean
 socket_options_setup_socket_method(SocketOptions *self, gint fd, GSockAddr *bind_addr, AFSocketDirection dir)
@@ -49,6 +50,21 @@ socket_options_setup_socket_method(SocketOptions *self, gint fd, GSockAddr *bind
                           evt_tag_int("so_rcvbuf_set", so_rcvbuf_set));
             }
         }
+      if (self->so_reuseport)
+        {
+#ifdef SO_REUSEPORT
+          if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &self->so_reuseport, sizeof(self->so_reuseport)) < 0)
+            {
+              msg_error("Error setting SO_REUSEPORT on socket",
+                        evt_tag_int("fd", fd),
+                        evt_tag_errno(EVT_TAG_OSERROR, errno));
+              return FALSE;
+            }
+#else
+          msg_error("so-reuseport() is set but no SO_REUSEPORT setsockopt on this platform");
+          return FALSE;
+#endif
+        }
     }
   if (dir & AFSOCKET_DIR_SEND)
     {
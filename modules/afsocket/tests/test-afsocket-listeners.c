@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "afinet-source.h"
+#include "socket-options.h"
+#include "apphook.h"
+#include "cfg.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef SO_REUSEPORT
+
+#define LOOPBACK_ADDRESS "127.0.0.1"
+
+static gint
+_udp_socket(void)
+{
+  gint fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+  cr_assert(fd >= 0);
+  return fd;
+}
+
+static gboolean
+_has_so_reuseport(gint fd)
+{
+  gint value = 0;
+  socklen_t len = sizeof(value);
+
+  cr_assert(getsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &value, &len) == 0);
+  return value != 0;
+}
+
+static gboolean
+_bind_to(gint fd, gint port)
+{
+  struct sockaddr_in sin;
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_port = htons(port);
+  sin.sin_addr.s_addr = inet_addr(LOOPBACK_ADDRESS);
+  return bind(fd, (struct sockaddr *) &sin, sizeof(sin)) == 0;
+}
+
+/* a port that was free a moment ago */
+static gint
+_find_free_port(void)
+{
+  struct sockaddr_in sin;
+  socklen_t len = sizeof(sin);
+  gint fd = _udp_socket();
+
+  cr_assert(_bind_to(fd, 0));
+  cr_assert(getsockname(fd, (struct sockaddr *) &sin, &len) == 0);
+  close(fd);
+  return ntohs(sin.sin_port);
+}
+
+Test(afsocket_listeners, so_reuseport_is_set_on_the_socket)
+{
+  SocketOptions *socket_options = socket_options_new();
+  gint fd = _udp_socket();
+
+  socket_options->so_reuseport = TRUE;
+  cr_assert(socket_options_setup_socket(socket_options, fd, NULL, AFSOCKET_DIR_RECV));
+  cr_assert(_has_so_reuseport(fd));
+
+  close(fd);
+  socket_options_free(socket_options);
+}
+
+Test(afsocket_listeners, failing_to_set_so_reuseport_fails_the_socket_setup)
+{
+  SocketOptions *socket_options = socket_options_new();
+  gint fds[2];
+
+  /* not a socket, setsockopt() fails with ENOTSOCK */
+  cr_assert(pipe(fds) == 0);
+
+  socket_options->so_reuseport = TRUE;
+  cr_assert_not(socket_options_setup_socket(socket_options, fds[0], NULL, AFSOCKET_DIR_RECV));
+
+  close(fds[0]);
+  close(fds[1]);
+  socket_options_free(socket_options);
+}
+
+static LogDriver *
+_create_udp_source(GlobalConfig *cfg, gint port, gint num_listeners)
+{
+  AFInetSourceDriver *self = afinet_sd_new_udp(cfg);
+  gchar port_str[16];
+
+  g_snprintf(port_str, sizeof(port_str), "%d", port);
+  afinet_sd_set_localip(&self->super.super.super, LOOPBACK_ADDRESS);
+  afinet_sd_set_localport(&self->super.super.super, port_str);
+  afsocket_sd_set_listeners(&self->super.super.super, num_listeners);
+
+  self->super.super.super.group = g_strdup("s_test");
+  self->super.super.super.id = g_strdup("s_test#0");
+  self->super.super.group_len = strlen(self->super.super.super.group);
+  return &self->super.super.super;
+}
+
+static void
+_reload_udp_source(gint num_listeners_before, gint num_listeners_after)
+{
+  GlobalConfig *old_cfg = cfg_new_snippet();
+  GlobalConfig *new_cfg = cfg_new_snippet();
+  gint port = _find_free_port();
+  LogDriver *old_source, *new_source;
+  gint fd;
+
+  old_cfg->persist = persist_config_new();
+  old_source = _create_udp_source(old_cfg, port, num_listeners_before);
+  cr_assert(log_pipe_init(&old_source->super));
+  cr_assert(log_pipe_deinit(&old_source->super));
+  log_pipe_unref(&old_source->super);
+
+  cfg_persist_config_move(old_cfg, new_cfg);
+  new_source = _create_udp_source(new_cfg, port, num_listeners_after);
+  cr_assert(log_pipe_init(&new_source->super), "the new listeners could not be opened");
+  cr_assert_eq(((AFSocketSourceDriver *) new_source)->num_connections, num_listeners_after);
+
+  /* binds only if every socket on the port has SO_REUSEPORT */
+  if (num_listeners_after > 1)
+    {
+      gint one = 1;
+
+      fd = _udp_socket();
+      cr_assert(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == 0);
+      cr_assert(_bind_to(fd, port), "a listener without SO_REUSEPORT was kept");
+      close(fd);
+    }
+
+  cr_assert(log_pipe_deinit(&new_source->super));
+  log_pipe_unref(&new_source->super);
+  cfg_free(old_cfg);
+  cfg_free(new_cfg);
+}
+
+Test(afsocket_listeners, reload_from_one_to_multiple_listeners_reopens_the_socket)
+{
+  _reload_udp_source(1, 4);
+}
+
+Test(afsocket_listeners, reload_from_multiple_listeners_to_one_closes_the_surplus)
+{
+  _reload_udp_source(4, 1);
+}
+
+Test(afsocket_listeners, reload_with_the_same_listeners_keeps_the_sockets)
+{
+  _reload_udp_source(2, 2);
+}
+
+#endif
+
+static void
+setup(void)
+{
+  app_startup();
+}
+
+static void
+teardown(void)
+{
+  app_shutdown();
+}
+
+TestSuite(afsocket_listeners, .init = setup, .fini = teardown);
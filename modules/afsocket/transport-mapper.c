@@ -101,7 +101,7 @@ LogTransport *
 transport_mapper_construct_log_transport_method(TransportMapper *self, gint fd)
 {
   if (self->sock_type == SOCK_DGRAM)
-    return log_transport_dgram_socket_new(fd);
+    return log_transport_dgram_socket_new_batched(fd, self->dgram_batch_size);
   else
     return log_transport_stream_socket_new(fd);
 }
@@ -46,6 +46,9 @@ struct _TransportMapper
   const gchar *logproto;
   gint stats_source;
 
+  /* max number of datagrams received in one batch by dgram transports */
+  gint dgram_batch_size;
+
   gboolean (*apply_transport)(TransportMapper *self, GlobalConfig *cfg);
   LogTransport *(*construct_log_transport)(TransportMapper *self, gint fd);
   gboolean (*init)(TransportMapper *self);
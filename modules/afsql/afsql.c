@@ -262,6 +262,34 @@ afsql_dd_run_query(AFSqlDestDriver *self, const gchar *query, gboolean silent, d
   return TRUE;
 }
 
+static void
+afsql_dd_reset_pending_rows(AFSqlDestDriver *self)
+{
+  g_string_truncate(self->pending_insert, 0);
+  g_string_truncate(self->pending_table, 0);
+  self->pending_rows = 0;
+}
+
+/**
+ * afsql_dd_flush_pending_rows:
+ *
+ * Execute the multi-row INSERT collected in the current transaction.
+ *
+ * NOTE: This function can only be called from the database thread.
+ **/
+static gboolean
+afsql_dd_flush_pending_rows(AFSqlDestDriver *self)
+{
+  gboolean success;
+
+  if (self->pending_rows == 0)
+    return TRUE;
+
+  success = afsql_dd_run_query(self, self->pending_insert->str, FALSE, NULL);
+  afsql_dd_reset_pending_rows(self);
+  return success;
+}
+
 /**
  * afsql_dd_handle_transaction_error:
  *
@@ -274,6 +302,12 @@ afsql_dd_handle_transaction_error(AFSqlDestDriver *self)
 {
   log_queue_rewind_backlog_all(self->queue);
   self->flush_lines_queued = 0;
+
+  /* the rewound messages are inserted one by one until the next commit,
+   * so that a single bad row cannot fail the whole batch again */
+  if (self->flags & AFSQL_DDF_MULTI_ROW_INSERTS)
+    self->single_row_fallback = TRUE;
+  afsql_dd_reset_pending_rows(self);
 }
 
 /**
@@ -291,12 +325,13 @@ afsql_dd_commit_transaction(AFSqlDestDriver *self)
   if (!self->transaction_active)
     return TRUE;
 
-  success = afsql_dd_run_query(self, "COMMIT", FALSE, NULL);
+  success = afsql_dd_flush_pending_rows(self) && afsql_dd_run_query(self, "COMMIT", FALSE, NULL);
   if (success)
     {
       log_queue_ack_backlog(self->queue, self->flush_lines_queued);
       self->flush_lines_queued = 0;
       self->transaction_active = FALSE;
+      self->single_row_fallback = FALSE;
     }
   else
     {
@@ -342,6 +377,7 @@ afsql_dd_rollback_transaction(AFSqlDestDriver *self)
     return TRUE;
 
   self->transaction_active = FALSE;
+  afsql_dd_reset_pending_rows(self);
 
   return afsql_dd_run_query(self, "ROLLBACK", FALSE, NULL);
 }
@@ -781,14 +817,12 @@ afsql_dd_ensure_accessible_database_table(AFSqlDestDriver *self, LogMessage *msg
   return table;
 }
 
-static GString *
-afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+static void
+afsql_dd_append_insert_header(AFSqlDestDriver *self, const gchar *table, GString *insert_command)
 {
-  GString *insert_command = g_string_sized_new(256);
-  GString *value = g_string_sized_new(512);
   gint i, j;
 
-  g_string_printf(insert_command, "INSERT INTO %s (", table->str);
+  g_string_append_printf(insert_command, "INSERT INTO %s (", table);
 
   for (i = 0; i < self->fields_len; i++)
     {
@@ -805,7 +839,16 @@ afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *t
         }
     }
 
-  g_string_append(insert_command, ") VALUES (");
+  g_string_append(insert_command, ") VALUES ");
+}
+
+static void
+afsql_dd_append_insert_values(AFSqlDestDriver *self, LogMessage *msg, GString *insert_command)
+{
+  GString *value = g_string_sized_new(512);
+  gint i, j;
+
+  g_string_append_c(insert_command, '(');
 
   for (i = 0; i < self->fields_len; i++)
     {
@@ -840,9 +883,18 @@ afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *t
         }
     }
 
-  g_string_append(insert_command, ")");
+  g_string_append_c(insert_command, ')');
 
   g_string_free(value, TRUE);
+}
+
+static GString *
+afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+{
+  GString *insert_command = g_string_sized_new(256);
+
+  afsql_dd_append_insert_header(self, table->str, insert_command);
+  afsql_dd_append_insert_values(self, msg, insert_command);
 
   return insert_command;
 }
@@ -865,6 +917,69 @@ afsql_dd_should_commit_transaction(const AFSqlDestDriver *self)
   return afsql_dd_is_transaction_handling_enabled(self) && self->flush_lines_queued == self->flush_lines;
 }
 
+static inline gboolean
+afsql_dd_is_multi_row_insert_enabled(const AFSqlDestDriver *self)
+{
+  return (self->flags & AFSQL_DDF_MULTI_ROW_INSERTS) && !self->single_row_fallback;
+}
+
+static inline gboolean
+afsql_dd_is_pending_insert_full(const AFSqlDestDriver *self, gsize row_len)
+{
+  return self->pending_rows >= AFSQL_MULTI_ROW_INSERT_MAX_ROWS ||
+         self->pending_insert->len + strlen(", ") + row_len > AFSQL_MULTI_ROW_INSERT_MAX_BYTES;
+}
+
+/*
+ * Adds the row to the INSERT statement collected for the current
+ * transaction, the statement is executed by afsql_dd_commit_transaction().
+ * Rows targeting a different table, or that would make the statement
+ * exceed the row or size limits, start a new statement.
+ */
+static gboolean
+afsql_dd_queue_row(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+{
+  GString *row = g_string_sized_new(256);
+  gboolean success = TRUE;
+
+  afsql_dd_append_insert_values(self, msg, row);
+
+  if (self->pending_rows > 0 &&
+      (strcmp(self->pending_table->str, table->str) != 0 || afsql_dd_is_pending_insert_full(self, row->len)))
+    success = afsql_dd_flush_pending_rows(self);
+
+  if (success)
+    {
+      if (self->pending_rows == 0)
+        {
+          g_string_assign(self->pending_table, table->str);
+          afsql_dd_append_insert_header(self, table->str, self->pending_insert);
+        }
+      else
+        {
+          g_string_append(self->pending_insert, ", ");
+        }
+
+      g_string_append_len(self->pending_insert, row->str, row->len);
+      self->pending_rows++;
+    }
+
+  g_string_free(row, TRUE);
+  return success;
+}
+
+gboolean
+afsql_dd_private_queue_row(LogDriver *s, LogMessage *msg, const gchar *table)
+{
+  AFSqlDestDriver *self = (AFSqlDestDriver *) s;
+  GString *table_str = g_string_new(table);
+  gboolean success;
+
+  success = afsql_dd_queue_row(self, msg, table_str);
+  g_string_free(table_str, TRUE);
+  return success;
+}
+
 static inline void
 afsql_dd_rollback_msg(AFSqlDestDriver *self, LogMessage *msg, LogPathOptions *path_options)
 {
@@ -952,8 +1067,26 @@ afsql_dd_insert_db(AFSqlDestDriver *self)
       goto out;
     }
 
-  insert_command = afsql_dd_build_insert_command(self, msg, table);
-  success = afsql_dd_run_query(self, insert_command->str, FALSE, NULL);
+  if (afsql_dd_is_multi_row_insert_enabled(self))
+    {
+      if (!afsql_dd_queue_row(self, msg, table))
+        {
+          msg_error("SQL multi-row insert failed, rewinding backlog and inserting the rows one by one");
+          afsql_dd_handle_transaction_error(self);
+          afsql_dd_rollback_transaction(self);
+
+          /* the message itself was rewound to the queue along with the backlog */
+          g_string_free(table, TRUE);
+          msg_set_context(NULL);
+          log_msg_unref(msg);
+          return TRUE;
+        }
+    }
+  else
+    {
+      insert_command = afsql_dd_build_insert_command(self, msg, table);
+      success = afsql_dd_run_query(self, insert_command->str, FALSE, NULL);
+    }
 
   if (success && self->flush_lines_queued != -1)
     {
@@ -964,7 +1097,6 @@ afsql_dd_insert_db(AFSqlDestDriver *self)
           /* Assuming that in case of error, the queue is rewound by afsql_dd_commit_transaction() */
           afsql_dd_rollback_transaction(self);
 
-          g_string_free(insert_command, TRUE);
           msg_set_context(NULL);
 
           success = FALSE;
@@ -1291,6 +1423,16 @@ afsql_dd_init(LogPipe *s)
   if ((self->flags & AFSQL_DDF_EXPLICIT_COMMITS) && (self->flush_lines > 0 || self->flush_timeout > 0))
     self->flush_lines_queued = 0;
 
+  if ((self->flags & AFSQL_DDF_MULTI_ROW_INSERTS) &&
+      (self->flush_lines_queued == -1 || strcmp(self->type, s_oracle) == 0))
+    {
+      msg_warning("multi-row-inserts requires explicit-commits with flush-lines() or flush-timeout() "
+                  "and a database other than oracle, inserting rows one by one",
+                  evt_tag_str("type", self->type),
+                  log_pipe_location_tag(s));
+      self->flags &= ~AFSQL_DDF_MULTI_ROW_INSERTS;
+    }
+
   if (!dbi_initialized)
     {
       errno = 0;
@@ -1403,6 +1545,8 @@ afsql_dd_free(LogPipe *s)
   string_list_free(self->values);
   log_template_unref(self->table);
   g_hash_table_destroy(self->syslogng_conform_tables);
+  g_string_free(self->pending_insert, TRUE);
+  g_string_free(self->pending_table, TRUE);
   g_hash_table_destroy(self->dbd_options);
   g_hash_table_destroy(self->dbd_options_numeric);
   if (self->session_statements)
@@ -1445,6 +1589,8 @@ afsql_dd_new(GlobalConfig *cfg)
   self->num_retries = MAX_FAILED_ATTEMPTS;
 
   self->syslogng_conform_tables = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  self->pending_insert = g_string_sized_new(4096);
+  self->pending_table = g_string_sized_new(32);
   self->dbd_options = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
   self->dbd_options_numeric = g_hash_table_new_full(g_str_hash, g_int_equal, g_free, NULL);
 
@@ -1464,6 +1610,8 @@ afsql_dd_lookup_flag(const gchar *flag)
     return AFSQL_DDF_EXPLICIT_COMMITS;
   else if (strcmp(flag, "dont-create-tables") == 0 || strcmp(flag, "dont_create_tables") == 0)
     return AFSQL_DDF_DONT_CREATE_TABLES;
+  else if (strcmp(flag, "multi-row-inserts") == 0 || strcmp(flag, "multi_row_inserts") == 0)
+    return AFSQL_DDF_MULTI_ROW_INSERTS;
   else
     msg_warning("Unknown SQL flag",
                 evt_tag_str("flag", flag));
@@ -46,8 +46,15 @@ enum
 {
   AFSQL_DDF_EXPLICIT_COMMITS = 0x0001,
   AFSQL_DDF_DONT_CREATE_TABLES = 0x0002,
+  AFSQL_DDF_MULTI_ROW_INSERTS = 0x0004,
 };
 
+/* limits of a single multi-row INSERT: MSSQL accepts at most 1000 rows in
+ * a VALUES list, MySQL rejects statements above max_allowed_packet, which
+ * defaults to 1MiB in older versions */
+#define AFSQL_MULTI_ROW_INSERT_MAX_ROWS 1000
+#define AFSQL_MULTI_ROW_INSERT_MAX_BYTES (512 * 1024)
+
 typedef struct _AFSqlField
 {
   guint32 flags;
@@ -117,6 +124,11 @@ typedef struct _AFSqlDestDriver
   guint32 failed_message_counter;
   WorkerOptions worker_options;
   gboolean transaction_active;
+  /* rows collected into a single INSERT, executed before COMMIT */
+  GString *pending_insert;
+  GString *pending_table;
+  gint pending_rows;
+  gboolean single_row_fallback;
 } AFSqlDestDriver;
 
 
@@ -144,4 +156,6 @@ void afsql_dd_set_retries(LogDriver *s, gint num_retries);
 void afsql_dd_add_dbd_option(LogDriver *s, const gchar *name, const gchar *value);
 void afsql_dd_add_dbd_option_numeric(LogDriver *s, const gchar *name, gint value);
 
+gboolean afsql_dd_private_queue_row(LogDriver *s, LogMessage *msg, const gchar *table);
+
 #endif
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "afsql.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "template/templates.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_TABLE "messages"
+
+static GlobalConfig *cfg;
+static LogDriver *driver;
+static GPtrArray *statements;
+static gint dummy_result;
+
+/* the libdbi functions below override the real ones, the statements are
+ * recorded instead of being sent to a database */
+dbi_result
+dbi_conn_query(dbi_conn conn, const char *statement)
+{
+  g_ptr_array_add(statements, g_strdup(statement));
+  return (dbi_result) &dummy_result;
+}
+
+int
+dbi_result_free(dbi_result result)
+{
+  return 0;
+}
+
+size_t
+dbi_conn_quote_string_copy(dbi_conn conn, const char *orig, char **newstr)
+{
+  size_t len = strlen(orig) + 2;
+
+  *newstr = malloc(len + 1);
+  sprintf(*newstr, "'%s'", orig);
+  return len;
+}
+
+static void
+_create_driver(void)
+{
+  AFSqlDestDriver *self;
+
+  driver = afsql_dd_new(cfg);
+  self = (AFSqlDestDriver *) driver;
+
+  self->fields_len = 1;
+  self->fields = g_new0(AFSqlField, 1);
+  self->fields[0].name = g_strdup("message");
+  self->fields[0].type = g_strdup("text");
+  self->fields[0].value = log_template_new(cfg, NULL);
+  cr_assert(log_template_compile(self->fields[0].value, "$MSG", NULL));
+
+  afsql_dd_set_flags(driver, AFSQL_DDF_MULTI_ROW_INSERTS);
+  log_template_options_init(&self->template_options, cfg);
+}
+
+static gint
+_pending_rows(void)
+{
+  return ((AFSqlDestDriver *) driver)->pending_rows;
+}
+
+static void
+_queue_rows(const gchar *table, gint num_rows, gsize message_len)
+{
+  LogMessage *msg = log_msg_new_empty();
+  gchar *message = g_strnfill(message_len, 'x');
+  gint i;
+
+  log_msg_set_value(msg, LM_V_MESSAGE, message, -1);
+  for (i = 0; i < num_rows; i++)
+    cr_assert(afsql_dd_private_queue_row(driver, msg, table));
+
+  g_free(message);
+  log_msg_unref(msg);
+}
+
+static gint
+_count_rows(const gchar *statement)
+{
+  const gchar *p = statement;
+  gint num_rows = 0;
+
+  while ((p = strstr(p, "('")))
+    {
+      num_rows++;
+      p++;
+    }
+  return num_rows;
+}
+
+static const gchar *
+_statement(gint i)
+{
+  return (const gchar *) g_ptr_array_index(statements, i);
+}
+
+Test(afsql_multi_row_insert, statement_is_flushed_at_the_row_limit)
+{
+  _queue_rows(TEST_TABLE, 2 * AFSQL_MULTI_ROW_INSERT_MAX_ROWS + 1, 16);
+
+  cr_assert_eq(statements->len, 2);
+  cr_assert_eq(_count_rows(_statement(0)), AFSQL_MULTI_ROW_INSERT_MAX_ROWS);
+  cr_assert_eq(_count_rows(_statement(1)), AFSQL_MULTI_ROW_INSERT_MAX_ROWS);
+  cr_assert_eq(_pending_rows(), 1);
+}
+
+Test(afsql_multi_row_insert, statement_is_flushed_before_exceeding_the_size_limit)
+{
+  gint num_rows = 0;
+  gint i;
+
+  _queue_rows(TEST_TABLE, 20, 100 * 1024);
+
+  cr_assert_gt(statements->len, 1);
+  for (i = 0; i < statements->len; i++)
+    {
+      cr_assert_leq(strlen(_statement(i)), AFSQL_MULTI_ROW_INSERT_MAX_BYTES,
+                    "statement %d is %zu bytes long", i, strlen(_statement(i)));
+      num_rows += _count_rows(_statement(i));
+    }
+  cr_assert_eq(num_rows + _pending_rows(), 20, "rows were lost while splitting the statement");
+}
+
+Test(afsql_multi_row_insert, row_above_the_size_limit_is_inserted_alone)
+{
+  _queue_rows(TEST_TABLE, 2, AFSQL_MULTI_ROW_INSERT_MAX_BYTES);
+
+  cr_assert_eq(statements->len, 1);
+  cr_assert_eq(_count_rows(_statement(0)), 1);
+  cr_assert_eq(_pending_rows(), 1);
+}
+
+Test(afsql_multi_row_insert, rows_of_another_table_start_a_new_statement)
+{
+  _queue_rows(TEST_TABLE, 3, 16);
+  _queue_rows("other_messages", 1, 16);
+
+  cr_assert_eq(statements->len, 1);
+  cr_assert(g_str_has_prefix(_statement(0), "INSERT INTO " TEST_TABLE " "));
+  cr_assert_eq(_count_rows(_statement(0)), 3);
+  cr_assert_eq(_pending_rows(), 1);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  cfg = cfg_new_snippet();
+  statements = g_ptr_array_new_with_free_func(g_free);
+  _create_driver();
+}
+
+static void
+teardown(void)
+{
+  log_pipe_unref(&driver->super);
+  g_ptr_array_free(statements, TRUE);
+  cfg_free(cfg);
+  app_shutdown();
+}
+
+TestSuite(afsql_multi_row_insert, .init = setup, .fini = teardown);
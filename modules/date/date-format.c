@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "date-format.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+/* the semantics of the operations follow strptime_with_tz() */
+typedef enum
+{
+  DFO_LITERAL,
+  DFO_WHITESPACE,
+  DFO_NUMBER,
+  DFO_SHORT_YEAR,
+  DFO_MONTH_NAME,
+  DFO_WEEKDAY_NAME,
+  DFO_ZONE,
+} DateFormatOpType;
+
+typedef enum
+{
+  DFF_YEAR,
+  DFF_MONTH,
+  DFF_MDAY,
+  DFF_HOUR,
+  DFF_HOUR12,
+  DFF_MIN,
+  DFF_SEC,
+} DateFormatField;
+
+typedef struct _DateFormatOp
+{
+  DateFormatOpType type;
+  DateFormatField field;
+  gchar literal;
+  guint llim, ulim;
+} DateFormatOp;
+
+struct _DateFormat
+{
+  GArray *ops;
+};
+
+static const gchar *month_names[] =
+{
+  "January", "February", "March", "April", "May", "June",
+  "July", "August", "September", "October", "November", "December",
+};
+
+static const gchar *weekday_names[] =
+{
+  "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday",
+};
+
+static void
+_add_op(DateFormat *self, DateFormatOpType type)
+{
+  DateFormatOp op = { .type = type };
+
+  g_array_append_val(self->ops, op);
+}
+
+static void
+_add_literal(DateFormat *self, gchar literal)
+{
+  DateFormatOp op = { .type = DFO_LITERAL, .literal = literal };
+
+  g_array_append_val(self->ops, op);
+}
+
+static void
+_add_number(DateFormat *self, DateFormatField field, guint llim, guint ulim)
+{
+  DateFormatOp op = { .type = DFO_NUMBER, .field = field, .llim = llim, .ulim = ulim };
+
+  g_array_append_val(self->ops, op);
+}
+
+static gboolean
+_compile(DateFormat *self, const gchar *format)
+{
+  const gchar *p;
+
+  for (p = format; *p; p++)
+    {
+      if (isspace((guchar) *p))
+        {
+          _add_op(self, DFO_WHITESPACE);
+          continue;
+        }
+      if (*p != '%')
+        {
+          _add_literal(self, *p);
+          continue;
+        }
+
+      switch (*++p)
+        {
+        case '%':
+          _add_literal(self, '%');
+          break;
+        case 'D':
+          if (!_compile(self, "%m/%d/%y"))
+            return FALSE;
+          break;
+        case 'F':
+          if (!_compile(self, "%Y-%m-%d"))
+            return FALSE;
+          break;
+        case 'R':
+          if (!_compile(self, "%H:%M"))
+            return FALSE;
+          break;
+        case 'T':
+          if (!_compile(self, "%H:%M:%S"))
+            return FALSE;
+          break;
+        case 'A':
+        case 'a':
+          _add_op(self, DFO_WEEKDAY_NAME);
+          break;
+        case 'B':
+        case 'b':
+        case 'h':
+          _add_op(self, DFO_MONTH_NAME);
+          break;
+        case 'd':
+        case 'e':
+          _add_number(self, DFF_MDAY, 1, 31);
+          break;
+        case 'k':
+        case 'H':
+          _add_number(self, DFF_HOUR, 0, 23);
+          break;
+        case 'l':
+        case 'I':
+          _add_number(self, DFF_HOUR12, 1, 12);
+          break;
+        case 'M':
+          _add_number(self, DFF_MIN, 0, 59);
+          break;
+        case 'm':
+          _add_number(self, DFF_MONTH, 1, 12);
+          break;
+        case 'S':
+          _add_number(self, DFF_SEC, 0, 61);
+          break;
+        case 'Y':
+          _add_number(self, DFF_YEAR, 0, 9999);
+          break;
+        case 'y':
+          _add_op(self, DFO_SHORT_YEAR);
+          break;
+        case 'Z':
+        case 'z':
+          _add_op(self, DFO_ZONE);
+          break;
+        case 'n':
+        case 't':
+          _add_op(self, DFO_WHITESPACE);
+          break;
+        default:
+          /* locale dependent, rarely used or stateful conversions */
+          return FALSE;
+        }
+    }
+  return TRUE;
+}
+
+static gboolean
+_has_multiple_short_years(DateFormat *self)
+{
+  gint i, count = 0;
+
+  /* strptime() keeps the century of the first %y, we don't */
+  for (i = 0; i < self->ops->len; i++)
+    {
+      if (g_array_index(self->ops, DateFormatOp, i).type == DFO_SHORT_YEAR)
+        count++;
+    }
+  return count > 1;
+}
+
+DateFormat *
+date_format_compile(const gchar *format)
+{
+  DateFormat *self = g_new0(DateFormat, 1);
+
+  self->ops = g_array_new(FALSE, FALSE, sizeof(DateFormatOp));
+  if (!_compile(self, format) || _has_multiple_short_years(self))
+    {
+      date_format_free(self);
+      return NULL;
+    }
+  return self;
+}
+
+void
+date_format_free(DateFormat *self)
+{
+  g_array_free(self->ops, TRUE);
+  g_free(self);
+}
+
+static const gchar *
+_scan_number(const gchar *input, guint llim, guint ulim, gint *dest)
+{
+  guint result = 0;
+  guint rulim = ulim;
+  guchar ch = *input;
+
+  if (ch < '0' || ch > '9')
+    return NULL;
+
+  do
+    {
+      result = result * 10 + (ch - '0');
+      rulim /= 10;
+      ch = *++input;
+    }
+  while ((result * 10 <= ulim) && rulim && ch >= '0' && ch <= '9');
+
+  if (result < llim || result > ulim)
+    return NULL;
+
+  *dest = result;
+  return input;
+}
+
+static const gchar *
+_scan_name(const gchar *input, const gchar **names, gint num_names, gint *dest)
+{
+  gint i;
+
+  /* full names first, then the three letter abbreviations */
+  for (i = 0; i < num_names; i++)
+    {
+      gsize len = strlen(names[i]);
+
+      if (strncasecmp(names[i], input, len) == 0)
+        {
+          *dest = i;
+          return input + len;
+        }
+    }
+  for (i = 0; i < num_names; i++)
+    {
+      if (strncasecmp(names[i], input, 3) == 0)
+        {
+          *dest = i;
+          return input + 3;
+        }
+    }
+  return NULL;
+}
+
+static void
+_set_field(struct tm *tm, DateFormatField field, gint value)
+{
+  switch (field)
+    {
+    case DFF_YEAR:
+      tm->tm_year = value - 1900;
+      break;
+    case DFF_MONTH:
+      tm->tm_mon = value - 1;
+      break;
+    case DFF_MDAY:
+      tm->tm_mday = value;
+      break;
+    case DFF_HOUR:
+      tm->tm_hour = value;
+      break;
+    case DFF_HOUR12:
+      tm->tm_hour = value == 12 ? 0 : value;
+      break;
+    case DFF_MIN:
+      tm->tm_min = value;
+      break;
+    case DFF_SEC:
+      tm->tm_sec = value;
+      break;
+    default:
+      g_assert_not_reached();
+    }
+}
+
+/* numeric offsets and UTC only, named zones are left to strptime_with_tz() */
+static const gchar *
+_scan_zone(const gchar *input, struct tm *tm, long *tm_gmtoff)
+{
+  gboolean negative;
+  gint offset = 0, digits = 0;
+
+  while (isspace((guchar) *input))
+    input++;
+
+  switch (*input++)
+    {
+    case 'G':
+      if (*input++ != 'M')
+        return NULL;
+    /* FALLTHROUGH */
+    case 'U':
+      if (*input++ != 'T')
+        return NULL;
+    /* FALLTHROUGH */
+    case 'Z':
+      tm->tm_isdst = 0;
+      *tm_gmtoff = 0;
+      return input;
+    case '+':
+      negative = FALSE;
+      break;
+    case '-':
+      negative = TRUE;
+      break;
+    default:
+      return NULL;
+    }
+
+  while (digits < 4)
+    {
+      if (isdigit((guchar) *input))
+        {
+          offset = offset * 10 + (*input++ - '0');
+          digits++;
+        }
+      else if (digits == 2 && *input == ':')
+        input++;
+      else
+        break;
+    }
+
+  if (digits == 2)
+    offset *= 100;
+  else if (digits == 4 && offset % 100 < 60)
+    offset = (offset / 100) * 100 + ((offset % 100) * 50) / 30;
+  else
+    return NULL;
+
+  tm->tm_isdst = 0;
+  *tm_gmtoff = ((negative ? -offset : offset) * 3600) / 100;
+  return input;
+}
+
+const gchar *
+date_format_scan(const DateFormat *self, const gchar *input, struct tm *tm, long *tm_gmtoff)
+{
+  gint i, value;
+
+  for (i = 0; i < self->ops->len && input; i++)
+    {
+      DateFormatOp *op = &g_array_index(self->ops, DateFormatOp, i);
+
+      switch (op->type)
+        {
+        case DFO_LITERAL:
+          if (*input++ != op->literal)
+            return NULL;
+          break;
+        case DFO_WHITESPACE:
+          while (isspace((guchar) *input))
+            input++;
+          break;
+        case DFO_NUMBER:
+          input = _scan_number(input, op->llim, op->ulim, &value);
+          if (input)
+            _set_field(tm, op->field, value);
+          break;
+        case DFO_SHORT_YEAR:
+          input = _scan_number(input, 0, 99, &value);
+          if (input)
+            tm->tm_year = value <= 68 ? value + 100 : value;
+          break;
+        case DFO_MONTH_NAME:
+          input = _scan_name(input, month_names, G_N_ELEMENTS(month_names), &tm->tm_mon);
+          break;
+        case DFO_WEEKDAY_NAME:
+          input = _scan_name(input, weekday_names, G_N_ELEMENTS(weekday_names), &tm->tm_wday);
+          break;
+        case DFO_ZONE:
+          input = _scan_zone(input, tm, tm_gmtoff);
+          break;
+        default:
+          g_assert_not_reached();
+        }
+    }
+  return input;
+}
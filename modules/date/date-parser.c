@@ -22,8 +22,12 @@
  */
 
 #include "date-parser.h"
+#include "date-format.h"
 #include "strptime-tz.h"
 #include "str-utils.h"
+#include "tls-support.h"
+
+#include <string.h>
 
 typedef struct _DateParser
 {
@@ -32,8 +36,37 @@ typedef struct _DateParser
   gchar *date_tz;
   LogMessageTimeStamp time_stamp;
   TimeZoneInfo *date_tz_info;
+  DateFormat *compiled_format;
+  /* identifies the configuration of this instance in the timestamp cache */
+  guint32 cache_id;
 } DateParser;
 
+/*
+ * Consecutive messages usually carry the same timestamp, so each thread
+ * remembers the last successfully converted input.  The result depends on
+ * the receive time too (missing year, timezone offsets), so that is part
+ * of the key.
+ */
+#define DATE_PARSER_CACHE_INPUT_MAX 64
+
+typedef struct _DateParserCache
+{
+  guint32 cache_id;
+  time_t now;
+  gchar input[DATE_PARSER_CACHE_INPUT_MAX];
+  LogStamp result;
+} DateParserCache;
+
+TLS_BLOCK_START
+{
+  DateParserCache date_parser_cache;
+}
+TLS_BLOCK_END;
+
+#define date_parser_cache __tls_deref(date_parser_cache)
+
+static guint32 date_parser_last_cache_id;
+
 void
 date_parser_set_format(LogParser *s, const gchar *format)
 {
@@ -68,9 +101,34 @@ date_parser_init(LogPipe *s)
   if (self->date_tz_info)
     time_zone_info_free(self->date_tz_info);
   self->date_tz_info = self->date_tz ? time_zone_info_new(self->date_tz) : NULL;
+
+  if (self->compiled_format)
+    date_format_free(self->compiled_format);
+  self->compiled_format = date_format_compile(self->date_format);
+
+  /* init runs in the main thread */
+  self->cache_id = ++date_parser_last_cache_id;
   return log_parser_init_method(s);
 }
 
+static const gchar *
+_scan_timestamp(DateParser *self, const gchar *input, struct tm *tm, long *tm_gmtoff, const gchar **tm_zone)
+{
+  if (self->compiled_format)
+    {
+      struct tm saved_tm = *tm;
+      const gchar *remainder = date_format_scan(self->compiled_format, input, tm, tm_gmtoff);
+
+      if (remainder && !remainder[0])
+        return remainder;
+
+      /* not necessarily an error, e.g. named timezones are not handled by the compiled format */
+      *tm = saved_tm;
+      *tm_gmtoff = -1;
+    }
+  return strptime_with_tz(input, self->date_format, tm, tm_gmtoff, tm_zone);
+}
+
 /* NOTE: tm is initialized with the current time and date */
 static gboolean
 _parse_timestamp_and_deduce_missing_parts(DateParser *self, struct tm *tm, glong *tm_zone_offset, const gchar *input)
@@ -84,7 +142,7 @@ _parse_timestamp_and_deduce_missing_parts(DateParser *self, struct tm *tm, glong
   current_year = tm->tm_year;
   tm->tm_year = 0;
   tm_gmtoff = -1;
-  remainder = strptime_with_tz(input, self->date_format, tm, &tm_gmtoff, &tm_zone);
+  remainder = _scan_timestamp(self, input, tm, &tm_gmtoff, &tm_zone);
   if (!remainder || remainder[0])
     return FALSE;
 
@@ -154,12 +212,41 @@ _convert_struct_tm_to_logstamp(DateParser *self, time_t now, struct tm *tm, glon
   return TRUE;
 }
 
+static gboolean
+_lookup_cached_timestamp(DateParser *self, time_t now, LogStamp *target, const gchar *input)
+{
+  DateParserCache *cache = &date_parser_cache;
+
+  if (cache->cache_id != self->cache_id || cache->now != now || strcmp(cache->input, input) != 0)
+    return FALSE;
+
+  *target = cache->result;
+  return TRUE;
+}
+
+static void
+_store_cached_timestamp(DateParser *self, time_t now, const LogStamp *result, const gchar *input)
+{
+  DateParserCache *cache = &date_parser_cache;
+
+  if (strlen(input) >= sizeof(cache->input))
+    return;
+
+  cache->cache_id = self->cache_id;
+  cache->now = now;
+  strcpy(cache->input, input);
+  cache->result = *result;
+}
+
 static gboolean
 _convert_timestamp_to_logstamp(DateParser *self, time_t now, LogStamp *target, const gchar *input)
 {
   struct tm tm;
   glong tm_zone_offset;
 
+  if (_lookup_cached_timestamp(self, now, target, input))
+    return TRUE;
+
   /* initialize tm with current date, this fills in dst and other
    * fields (even non-standard ones) */
 
@@ -171,6 +258,7 @@ _convert_timestamp_to_logstamp(DateParser *self, time_t now, LogStamp *target, c
   if (!_convert_struct_tm_to_logstamp(self, now, &tm, tm_zone_offset, target))
     return FALSE;
 
+  _store_cached_timestamp(self, now, target, input);
   return TRUE;
 }
 
@@ -228,6 +316,8 @@ date_parser_free(LogPipe *s)
   g_free(self->date_tz);
   if (self->date_tz_info)
     time_zone_info_free(self->date_tz_info);
+  if (self->compiled_format)
+    date_format_free(self->compiled_format);
 
   log_parser_free_method(s);
 }
@@ -168,3 +168,33 @@ Test(date, test_date_with_additional_text_at_the_end)
   log_pipe_unref(&parser->super);
   log_msg_unref(logmsg);
 }
+
+static void
+_assert_parsed_timestamp(LogParser *parser, const gchar *msg, const gchar *expected)
+{
+  LogMessage *logmsg = _construct_logmsg(msg);
+  GString *res = g_string_sized_new(128);
+  gboolean success = log_parser_process(parser, &logmsg, NULL, log_msg_get_value(logmsg, LM_V_MESSAGE, NULL), -1);
+
+  cr_assert(success, "unable to parse msg=%s", msg);
+  log_stamp_append_format(&logmsg->timestamps[LM_TS_STAMP], res, TS_FMT_ISO, -1, 0);
+  cr_assert_str_eq(res->str, expected, "incorrect date parsed msg=%s", msg);
+
+  g_string_free(res, TRUE);
+  log_msg_unref(logmsg);
+}
+
+Test(date, test_repeated_timestamps_are_converted_by_each_parser)
+{
+  const gchar *msg = "Tue, 27 Jan 2015 11:48:46";
+  LogParser *local_parser = _construct_parser(NULL, "%a, %d %b %Y %T", LM_TS_STAMP);
+  LogParser *phoenix_parser = _construct_parser("America/Phoenix", "%a, %d %b %Y %T", LM_TS_STAMP);
+
+  _assert_parsed_timestamp(local_parser, msg, "2015-01-27T11:48:46+01:00");
+  _assert_parsed_timestamp(local_parser, msg, "2015-01-27T11:48:46+01:00");
+  _assert_parsed_timestamp(phoenix_parser, msg, "2015-01-27T11:48:46-07:00");
+  _assert_parsed_timestamp(local_parser, msg, "2015-01-27T11:48:46+01:00");
+
+  log_pipe_unref(&local_parser->super);
+  log_pipe_unref(&phoenix_parser->super);
+}
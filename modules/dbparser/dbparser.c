@@ -60,7 +60,8 @@ log_db_parser_emit(LogMessage *msg, gboolean synthetic, gpointer user_data)
     }
 }
 
-static void
+/* returns FALSE if the ruleset could not be (re)loaded */
+static gboolean
 log_db_parser_reload_database(LogDBParser *self)
 {
   struct stat st;
@@ -70,11 +71,11 @@ log_db_parser_reload_database(LogDBParser *self)
     {
       msg_error("Error stating pattern database file, no automatic reload will be performed",
                 evt_tag_str("error", g_strerror(errno)));
-      return;
+      return FALSE;
     }
   if ((self->db_file_inode == st.st_ino && self->db_file_mtime == st.st_mtime))
     {
-      return;
+      return TRUE;
     }
 
   self->db_file_inode = st.st_ino;
@@ -83,6 +84,7 @@ log_db_parser_reload_database(LogDBParser *self)
   if (!pattern_db_reload_ruleset(self->db, cfg, self->db_file))
     {
       msg_error("Error reloading pattern database, no automatic reload will be performed");
+      return FALSE;
     }
   else
     {
@@ -92,7 +94,7 @@ log_db_parser_reload_database(LogDBParser *self)
                  evt_tag_str("version", pattern_db_get_ruleset_version(self->db)),
                  evt_tag_str("pub_date", pattern_db_get_ruleset_pub_date(self->db)));
     }
-
+  return TRUE;
 }
 
 static void
@@ -125,18 +127,15 @@ log_db_parser_init(LogPipe *s)
   self->db = cfg_persist_config_fetch(cfg, log_db_parser_format_persist_name(self));
   if (self->db)
     {
-      struct stat st;
-
-      if (stat(self->db_file, &st) < 0)
+      /* The correlation state is carried over, but the ruleset has to be
+       * loaded again: its templates and conditions were compiled against
+       * the previous configuration, which is freed after the reload. */
+      if (!log_db_parser_reload_database(self))
         {
-          msg_error("Error stating pattern database file, no automatic reload will be performed",
-                    evt_tag_str("error", g_strerror(errno)));
-        }
-      else if (self->db_file_inode != st.st_ino || self->db_file_mtime != st.st_mtime)
-        {
-          log_db_parser_reload_database(self);
-          self->db_file_inode = st.st_ino;
-          self->db_file_mtime = st.st_mtime;
+          msg_error("Error loading pattern database after reload, dropping correlation state",
+                    evt_tag_str("file", self->db_file));
+          pattern_db_free(self->db);
+          self->db = pattern_db_new();
         }
     }
   else
@@ -582,79 +582,109 @@ _pattern_db_is_empty(PatternDB *self)
   return (G_UNLIKELY(!self->ruleset) || self->ruleset->is_empty);
 }
 
-static void
-_pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_params)
+/* Rules without a correllation context, rate limited or context creating
+ * actions only use per-message data and the rule itself, which is
+ * reference counted, thus they can be evaluated without holding the
+ * PatternDB lock.  */
+static gboolean
+_rule_requires_correllation_state(PDBRule *rule)
 {
-  PDBContext *context = NULL;
-  PDBRule *rule = process_params->rule;
-  LogMessage *msg = process_params->msg;
-  GString *buffer = g_string_sized_new(32);
-
-  g_static_rw_lock_writer_lock(&self->lock);
-  _advance_time_based_on_message(self, process_params, &msg->timestamps[LM_TS_STAMP]);
   if (rule->context.id_template)
+    return TRUE;
+
+  if (!rule->actions)
+    return FALSE;
+
+  for (gint i = 0; i < rule->actions->len; i++)
     {
-      CorrellationKey key;
+      PDBAction *action = (PDBAction *) g_ptr_array_index(rule->actions, i);
 
-      log_template_format(rule->context.id_template, msg, NULL, LTZ_LOCAL, 0, NULL, buffer);
-      log_msg_set_value(msg, context_id_handle, buffer->str, -1);
+      if (action->rate || action->content_type == RAC_CREATE_CONTEXT)
+        return TRUE;
+    }
+  return FALSE;
+}
 
-      correllation_key_setup(&key, rule->context.scope, msg, buffer->str);
-      context = g_hash_table_lookup(self->correllation.state, &key);
-      if (!context)
-        {
-          msg_debug("Correllation context lookup failure, starting a new context",
-                    evt_tag_str("rule", rule->rule_id),
-                    evt_tag_str("context", buffer->str),
-                    evt_tag_int("context_timeout", rule->context.timeout),
-                    evt_tag_int("context_expiration", timer_wheel_get_time(self->timer_wheel) + rule->context.timeout));
-          context = pdb_context_new(&key);
-          g_hash_table_insert(self->correllation.state, &context->super.key, context);
-          g_string_steal(buffer);
-        }
-      else
-        {
-          msg_debug("Correllation context lookup successful",
-                    evt_tag_str("rule", rule->rule_id),
-                    evt_tag_str("context", buffer->str),
-                    evt_tag_int("context_timeout", rule->context.timeout),
-                    evt_tag_int("context_expiration", timer_wheel_get_time(self->timer_wheel) + rule->context.timeout),
-                    evt_tag_int("num_messages", context->super.messages->len));
-        }
+static PDBContext *
+_lookup_or_create_context(PatternDB *self, PDBProcessParams *process_params, GString *buffer)
+{
+  PDBContext *context;
+  PDBRule *rule = process_params->rule;
+  LogMessage *msg = process_params->msg;
+  CorrellationKey key;
 
-      g_ptr_array_add(context->super.messages, log_msg_ref(msg));
+  log_template_format(rule->context.id_template, msg, NULL, LTZ_LOCAL, 0, NULL, buffer);
+  log_msg_set_value(msg, context_id_handle, buffer->str, -1);
 
-      if (context->super.timer)
-        {
-          timer_wheel_mod_timer(self->timer_wheel, context->super.timer, rule->context.timeout);
-        }
-      else
-        {
-          context->super.timer = timer_wheel_add_timer(self->timer_wheel, rule->context.timeout, pattern_db_expire_entry,
-                                                       correllation_context_ref(&context->super),
-                                                       (GDestroyNotify) correllation_context_unref);
-        }
-      if (context->rule != rule)
-        {
-          if (context->rule)
-            pdb_rule_unref(context->rule);
-          context->rule = pdb_rule_ref(rule);
-        }
+  correllation_key_setup(&key, rule->context.scope, msg, buffer->str);
+  context = g_hash_table_lookup(self->correllation.state, &key);
+  if (!context)
+    {
+      msg_debug("Correllation context lookup failure, starting a new context",
+                evt_tag_str("rule", rule->rule_id),
+                evt_tag_str("context", buffer->str),
+                evt_tag_int("context_timeout", rule->context.timeout),
+                evt_tag_int("context_expiration", timer_wheel_get_time(self->timer_wheel) + rule->context.timeout));
+      context = pdb_context_new(&key);
+      g_hash_table_insert(self->correllation.state, &context->super.key, context);
+      g_string_steal(buffer);
+    }
+  else
+    {
+      msg_debug("Correllation context lookup successful",
+                evt_tag_str("rule", rule->rule_id),
+                evt_tag_str("context", buffer->str),
+                evt_tag_int("context_timeout", rule->context.timeout),
+                evt_tag_int("context_expiration", timer_wheel_get_time(self->timer_wheel) + rule->context.timeout),
+                evt_tag_int("num_messages", context->super.messages->len));
+    }
+
+  g_ptr_array_add(context->super.messages, log_msg_ref(msg));
+
+  if (context->super.timer)
+    {
+      timer_wheel_mod_timer(self->timer_wheel, context->super.timer, rule->context.timeout);
     }
   else
     {
-      context = NULL;
+      context->super.timer = timer_wheel_add_timer(self->timer_wheel, rule->context.timeout, pattern_db_expire_entry,
+                                                   correllation_context_ref(&context->super),
+                                                   (GDestroyNotify) correllation_context_unref);
+    }
+  if (context->rule != rule)
+    {
+      if (context->rule)
+        pdb_rule_unref(context->rule);
+      context->rule = pdb_rule_ref(rule);
     }
+  return context;
+}
+
+static void
+_pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_params)
+{
+  PDBContext *context = NULL;
+  PDBRule *rule = process_params->rule;
+  LogMessage *msg = process_params->msg;
+  GString *buffer = g_string_sized_new(32);
+  gboolean stateful = _rule_requires_correllation_state(rule);
+
+  if (stateful)
+    g_static_rw_lock_writer_lock(&self->lock);
+
+  if (rule->context.id_template)
+    context = _lookup_or_create_context(self, process_params, buffer);
 
   process_params->context = context;
   process_params->buffer = buffer;
-  synthetic_message_apply(&rule->msg, &context->super, msg, buffer);
+  synthetic_message_apply(&rule->msg, context ? &context->super : NULL, msg, buffer);
 
   _emit_message(self, process_params, FALSE, msg);
   _execute_rule_actions(self, process_params, RAT_MATCH);
 
   pdb_rule_unref(rule);
-  g_static_rw_lock_writer_unlock(&self->lock);
+  if (stateful)
+    g_static_rw_lock_writer_unlock(&self->lock);
 
   if (context)
     log_msg_write_protect(msg);
@@ -662,15 +692,22 @@ _pattern_db_process_matching_rule(PatternDB *self, PDBProcessParams *process_par
   g_string_free(buffer, TRUE);
 }
 
-static void
-_pattern_db_process_unmatching_rule(PatternDB *self, PDBProcessParams *process_params)
+/* NOTE: lock should be acquired for reading before calling this function.
+ *
+ * The correllation time changes at most once a second (both on-line and
+ * when processing past messages in bulk), so the writer lock is only
+ * needed to move the time forward for a small fraction of the messages.
+ */
+static gboolean
+_is_time_advance_needed(PatternDB *self, const LogStamp *ls)
 {
-  LogMessage *msg = process_params->msg;
+  GTimeVal now;
 
-  g_static_rw_lock_writer_lock(&self->lock);
-  _advance_time_based_on_message(self, process_params, &msg->timestamps[LM_TS_STAMP]);
-  _emit_message(self, process_params, FALSE, msg);
-  g_static_rw_lock_writer_unlock(&self->lock);
+  cached_g_current_time(&now);
+  if (now.tv_sec != self->last_tick.tv_sec)
+    return TRUE;
+
+  return MIN(ls->tv_sec, now.tv_sec) > timer_wheel_get_time(self->timer_wheel);
 }
 
 static gboolean
@@ -679,6 +716,7 @@ _pattern_db_process(PatternDB *self, PDBLookupParams *lookup, GArray *dbg_list)
   LogMessage *msg = lookup->msg;
   PDBProcessParams process_params_p = {0};
   PDBProcessParams *process_params = &process_params_p;
+  gboolean time_advance_needed;
 
   g_static_rw_lock_reader_lock(&self->lock);
   if (_pattern_db_is_empty(self))
@@ -688,11 +726,20 @@ _pattern_db_process(PatternDB *self, PDBLookupParams *lookup, GArray *dbg_list)
     }
   process_params->rule = pdb_ruleset_lookup(self->ruleset, lookup, dbg_list);
   process_params->msg = msg;
+  time_advance_needed = _is_time_advance_needed(self, &msg->timestamps[LM_TS_STAMP]);
   g_static_rw_lock_reader_unlock(&self->lock);
+
+  if (time_advance_needed)
+    {
+      g_static_rw_lock_writer_lock(&self->lock);
+      _advance_time_based_on_message(self, process_params, &msg->timestamps[LM_TS_STAMP]);
+      g_static_rw_lock_writer_unlock(&self->lock);
+    }
+
   if (process_params->rule)
     _pattern_db_process_matching_rule(self, process_params);
   else
-    _pattern_db_process_unmatching_rule(self, process_params);
+    _emit_message(self, process_params, FALSE, msg);
   _flush_emitted_messages(self, process_params);
   return process_params->rule != NULL;
 }
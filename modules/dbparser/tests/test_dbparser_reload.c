@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "dbparser.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "logpipe.h"
+#include "logmsg/logmsg.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+#define PDB_WITH_SYNTHETIC_MESSAGE \
+  "<?xml version='1.0' encoding='UTF-8'?>\
+<patterndb version='4' pub_date='2010-02-22'>\
+  <ruleset name='testprog' id='480de478-d4a6-4a7f-bea4-0c0245d361e1'>\
+    <patterns>\
+      <pattern>testprog</pattern>\
+    </patterns>\
+    <rules>\
+      <rule provider='test' id='1' class='system' context-scope='program' context-id='$PID' context-timeout='60'>\
+        <patterns>\
+          <pattern>message-with-action</pattern>\
+        </patterns>\
+        <actions>\
+          <action trigger='match' condition='\"${PID}\" eq \"1234\"'>\
+            <message>\
+              <values>\
+                <value name='MESSAGE'>generated-by-${PROGRAM}</value>\
+              </values>\
+            </message>\
+          </action>\
+        </actions>\
+      </rule>\
+    </rules>\
+  </ruleset>\
+</patterndb>"
+
+static gchar *pdb_filename;
+static GPtrArray *captured;
+
+static void
+_capture_message(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options, gpointer user_data)
+{
+  g_ptr_array_add(captured, log_msg_ref(msg));
+  log_msg_ack(msg, path_options, AT_PROCESSED);
+  log_msg_unref(msg);
+}
+
+static LogPipe *
+_create_db_parser(GlobalConfig *cfg)
+{
+  LogParser *parser = log_db_parser_new(cfg);
+  LogPipe *capture = log_pipe_new(cfg);
+
+  log_db_parser_set_db_file((LogDBParser *) parser, pdb_filename);
+  capture->queue = _capture_message;
+  log_pipe_append(&parser->super, capture);
+
+  cr_assert(log_pipe_init(capture));
+  cr_assert(log_pipe_init(&parser->super));
+  return &parser->super;
+}
+
+static void
+_destroy_db_parser(LogPipe *parser)
+{
+  LogPipe *capture = parser->pipe_next;
+
+  log_pipe_deinit(parser);
+  log_pipe_deinit(capture);
+  log_pipe_unref(parser);
+  log_pipe_unref(capture);
+}
+
+static void
+_process_message(LogPipe *parser, const gchar *message)
+{
+  LogMessage *msg = log_msg_new_empty();
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  log_msg_set_value(msg, LM_V_PROGRAM, "testprog", -1);
+  log_msg_set_value(msg, LM_V_PID, "1234", -1);
+  log_msg_set_value(msg, LM_V_MESSAGE, message, -1);
+  log_pipe_queue(parser, msg, &path_options);
+}
+
+static gboolean
+_captured_message(const gchar *message)
+{
+  gint i;
+
+  for (i = 0; i < captured->len; i++)
+    {
+      LogMessage *msg = (LogMessage *) g_ptr_array_index(captured, i);
+
+      if (strcmp(log_msg_get_value(msg, LM_V_MESSAGE, NULL), message) == 0)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+Test(dbparser_reload, synthetic_messages_use_the_new_configuration_after_reload)
+{
+  GlobalConfig *old_cfg = cfg_new_snippet();
+  GlobalConfig *new_cfg = cfg_new_snippet();
+  LogPipe *old_parser, *new_parser;
+
+  old_parser = _create_db_parser(old_cfg);
+  _process_message(old_parser, "message-with-action");
+  cr_assert(_captured_message("generated-by-testprog"));
+
+  /* the same steps as a configuration reload in the main loop */
+  old_cfg->persist = persist_config_new();
+  log_pipe_deinit(old_parser);
+  cfg_persist_config_move(old_cfg, new_cfg);
+  new_parser = _create_db_parser(new_cfg);
+  persist_config_free(new_cfg->persist);
+  new_cfg->persist = NULL;
+
+  _destroy_db_parser(old_parser);
+  cfg_free(old_cfg);
+
+  g_ptr_array_foreach(captured, (GFunc) log_msg_unref, NULL);
+  g_ptr_array_set_size(captured, 0);
+
+  _process_message(new_parser, "message-with-action");
+  cr_assert(_captured_message("generated-by-testprog"),
+            "synthetic message was not generated after reload");
+
+  _destroy_db_parser(new_parser);
+  cfg_free(new_cfg);
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  captured = g_ptr_array_new();
+
+  g_file_open_tmp("patterndbXXXXXX.xml", &pdb_filename, NULL);
+  g_file_set_contents(pdb_filename, PDB_WITH_SYNTHETIC_MESSAGE, -1, NULL);
+}
+
+static void
+teardown(void)
+{
+  g_ptr_array_foreach(captured, (GFunc) log_msg_unref, NULL);
+  g_ptr_array_free(captured, TRUE);
+
+  g_unlink(pdb_filename);
+  g_free(pdb_filename);
+  app_shutdown();
+}
+
+TestSuite(dbparser_reload, .init = setup, .fini = teardown);
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "patterndb.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "plugin.h"
+#include "logmsg/logmsg.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define NUM_THREADS 4
+#define MESSAGES_PER_THREAD 1000
+#define CONTEXT_TIMEOUT 60
+
+/* every thread correllates its own messages in the context "ctx-<thread>" */
+#define PDB_STATELESS_AND_STATEFUL_RULES \
+  "<?xml version='1.0' encoding='UTF-8'?>\
+<patterndb version='4' pub_date='2010-02-22'>\
+  <ruleset name='testprog' id='480de478-d4a6-4a7f-bea4-0c0245d361e1'>\
+    <patterns>\
+      <pattern>testprog</pattern>\
+    </patterns>\
+    <rules>\
+      <rule provider='test' id='stateless' class='system'>\
+        <patterns>\
+          <pattern>stateless @NUMBER:thread@ @NUMBER:seq@</pattern>\
+        </patterns>\
+        <values>\
+          <value name='seen'>${thread}-${seq}</value>\
+        </values>\
+      </rule>\
+      <rule provider='test' id='stateful' class='system' context-scope='global' context-id='ctx-${thread}' context-timeout='60'>\
+        <patterns>\
+          <pattern>stateful @NUMBER:thread@ @NUMBER:seq@</pattern>\
+        </patterns>\
+        <values>\
+          <value name='context-length'>$(context-length)</value>\
+        </values>\
+        <actions>\
+          <action trigger='timeout'>\
+            <message>\
+              <values>\
+                <value name='MESSAGE'>context-closed</value>\
+                <value name='thread'>${thread}</value>\
+                <value name='length'>$(context-length)</value>\
+              </values>\
+            </message>\
+          </action>\
+        </actions>\
+      </rule>\
+    </rules>\
+  </ruleset>\
+</patterndb>"
+
+static GlobalConfig *cfg;
+static PatternDB *patterndb;
+static gchar *pdb_filename;
+
+/* filled from the processing threads */
+static GStaticMutex synthetic_messages_lock = G_STATIC_MUTEX_INIT;
+static GPtrArray *synthetic_messages;
+static gint num_mismatches;
+
+static void
+_emit_func(LogMessage *msg, gboolean synthetic, gpointer user_data)
+{
+  if (!synthetic)
+    return;
+
+  g_static_mutex_lock(&synthetic_messages_lock);
+  g_ptr_array_add(synthetic_messages, log_msg_ref(msg));
+  g_static_mutex_unlock(&synthetic_messages_lock);
+}
+
+static LogMessage *
+_construct_message(const gchar *message)
+{
+  LogMessage *msg = log_msg_new_empty();
+
+  log_msg_set_value(msg, LM_V_MESSAGE, message, -1);
+  log_msg_set_value(msg, LM_V_PROGRAM, "testprog", -1);
+  msg->timestamps[LM_TS_STAMP].tv_sec = msg->timestamps[LM_TS_RECVD].tv_sec;
+  return msg;
+}
+
+static void
+_check_value(LogMessage *msg, const gchar *name, const gchar *expected)
+{
+  const gchar *value = log_msg_get_value_by_name(msg, name, NULL);
+
+  if (strcmp(value, expected) != 0)
+    g_atomic_int_inc(&num_mismatches);
+}
+
+/* criterion asserts cannot be used outside of the test thread, mismatches
+ * are counted instead */
+static void
+_process_and_check(const gchar *message, const gchar *rule_id, const gchar *name, const gchar *expected)
+{
+  LogMessage *msg = _construct_message(message);
+
+  if (!pattern_db_process(patterndb, msg))
+    g_atomic_int_inc(&num_mismatches);
+  _check_value(msg, ".classifier.rule_id", rule_id);
+  _check_value(msg, name, expected);
+  log_msg_unref(msg);
+}
+
+static gpointer
+_process_messages(gpointer user_data)
+{
+  gint thread = GPOINTER_TO_INT(user_data);
+  gchar message[64], expected[64];
+  gint i;
+
+  for (i = 0; i < MESSAGES_PER_THREAD; i++)
+    {
+      g_snprintf(message, sizeof(message), "stateless %d %d", thread, i);
+      g_snprintf(expected, sizeof(expected), "%d-%d", thread, i);
+      _process_and_check(message, "stateless", "seen", expected);
+
+      g_snprintf(message, sizeof(message), "stateful %d %d", thread, i);
+      g_snprintf(expected, sizeof(expected), "%d", i + 1);
+      _process_and_check(message, "stateful", "context-length", expected);
+    }
+  return NULL;
+}
+
+Test(patterndb_threads, stateless_and_stateful_rules_match_concurrently)
+{
+  GThread *threads[NUM_THREADS];
+  gboolean seen_thread[NUM_THREADS] = { 0 };
+  gchar expected_length[16];
+  gint i;
+
+  for (i = 0; i < NUM_THREADS; i++)
+    threads[i] = g_thread_create(_process_messages, GINT_TO_POINTER(i), TRUE, NULL);
+  for (i = 0; i < NUM_THREADS; i++)
+    g_thread_join(threads[i]);
+
+  cr_assert_eq(num_mismatches, 0, "%d messages were parsed or correllated incorrectly", num_mismatches);
+  cr_assert_eq(synthetic_messages->len, 0, "a correllation context expired early");
+
+  /* closing the contexts reports the number of messages each of them collected */
+  pattern_db_advance_time(patterndb, CONTEXT_TIMEOUT + 1);
+  cr_assert_eq(synthetic_messages->len, NUM_THREADS);
+
+  g_snprintf(expected_length, sizeof(expected_length), "%d", MESSAGES_PER_THREAD);
+  for (i = 0; i < synthetic_messages->len; i++)
+    {
+      LogMessage *msg = (LogMessage *) g_ptr_array_index(synthetic_messages, i);
+      gint thread = atoi(log_msg_get_value_by_name(msg, "thread", NULL));
+
+      cr_assert(thread >= 0 && thread < NUM_THREADS);
+      cr_assert_not(seen_thread[thread], "the context of thread %d was created twice", thread);
+      seen_thread[thread] = TRUE;
+      cr_assert_str_eq(log_msg_get_value_by_name(msg, "length", NULL), expected_length,
+                       "messages of thread %d were lost from its context", thread);
+    }
+}
+
+static void
+setup(void)
+{
+  GError *error = NULL;
+  gint fd;
+
+  app_startup();
+  cfg = cfg_new_snippet();
+  cfg_load_module(cfg, "basicfuncs");
+  pattern_db_global_init();
+
+  fd = g_file_open_tmp("patterndbXXXXXX.xml", &pdb_filename, NULL);
+  cr_assert(fd >= 0);
+  close(fd);
+  cr_assert(g_file_set_contents(pdb_filename, PDB_STATELESS_AND_STATEFUL_RULES, -1, &error));
+
+  patterndb = pattern_db_new();
+  pattern_db_set_emit_func(patterndb, _emit_func, NULL);
+  cr_assert(pattern_db_reload_ruleset(patterndb, cfg, pdb_filename));
+
+  synthetic_messages = g_ptr_array_new();
+  num_mismatches = 0;
+}
+
+static void
+teardown(void)
+{
+  g_ptr_array_foreach(synthetic_messages, (GFunc) log_msg_unref, NULL);
+  g_ptr_array_free(synthetic_messages, TRUE);
+  pattern_db_free(patterndb);
+
+  g_unlink(pdb_filename);
+  g_free(pdb_filename);
+  cfg_free(cfg);
+  app_shutdown();
+}
+
+TestSuite(patterndb_threads, .init = setup, .fini = teardown);
@@ -36,6 +36,7 @@ static CfgLexerKeyword diskq_keywords[] =
   { "reliable",          KW_RELIABLE },
   { "mem_buf_size",      KW_MEM_BUF_SIZE },
   { "qout_size",         KW_QOUT_SIZE },
+  { "sync_interval",     KW_SYNC_INTERVAL },
   { "dir",               KW_DIR },
   { NULL }
 };
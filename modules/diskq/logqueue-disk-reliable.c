@@ -26,6 +26,7 @@
 #include "logpipe.h"
 #include "logqueue-disk-reliable.h"
 #include "messages.h"
+#include "scratch-buffers.h"
 
 static gboolean
 _start(LogQueueDisk *s, const gchar *filename)
@@ -37,23 +38,16 @@ static gboolean
 _skip_message(LogQueueDisk *self)
 {
   GString *serialized;
-  SerializeArchive *sa;
+  ScratchBuffersMarker marker;
+  gboolean result;
 
   if (!qdisk_initialized(self->qdisk))
     return FALSE;
 
-  serialized = g_string_sized_new(64);
-  if (!qdisk_pop_head(self->qdisk, serialized))
-    {
-      g_string_free(serialized, TRUE);
-      return FALSE;
-    }
-
-  sa = serialize_string_archive_new(serialized);
-  serialize_archive_free(sa);
-
-  g_string_free(serialized, TRUE);
-  return TRUE;
+  serialized = scratch_buffers_alloc_and_mark(&marker);
+  result = qdisk_pop_head(self->qdisk, serialized);
+  scratch_buffers_reclaim_marked(marker);
+  return result;
 }
 
 static void
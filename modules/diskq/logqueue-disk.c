@@ -26,6 +26,7 @@
 #include "messages.h"
 #include "serialize.h"
 #include "logmsg/logmsg-serialize.h"
+#include "scratch-buffers.h"
 #include "stats/stats-registry.h"
 #include "reloc.h"
 #include "qdisk.h"
@@ -224,16 +225,17 @@ _pop_disk(LogQueueDisk *self, LogMessage **msg)
 {
   GString *serialized;
   SerializeArchive *sa;
+  ScratchBuffersMarker marker;
 
   *msg = NULL;
 
   if (!qdisk_initialized(self->qdisk))
     return FALSE;
 
-  serialized = g_string_sized_new(64);
+  serialized = scratch_buffers_alloc_and_mark(&marker);
   if (!qdisk_pop_head(self->qdisk, serialized))
     {
-      g_string_free(serialized, TRUE);
+      scratch_buffers_reclaim_marked(marker);
       return FALSE;
     }
 
@@ -242,7 +244,7 @@ _pop_disk(LogQueueDisk *self, LogMessage **msg)
 
   if (!log_msg_deserialize(*msg, sa))
     {
-      g_string_free(serialized, TRUE);
+      scratch_buffers_reclaim_marked(marker);
       serialize_archive_free(sa);
       log_msg_unref(*msg);
       *msg = NULL;
@@ -252,7 +254,7 @@ _pop_disk(LogQueueDisk *self, LogMessage **msg)
 
   serialize_archive_free(sa);
 
-  g_string_free(serialized, TRUE);
+  scratch_buffers_reclaim_marked(marker);
   return TRUE;
 }
 
@@ -286,15 +288,16 @@ _write_message(LogQueueDisk *self, LogMessage *msg)
 {
   GString *serialized;
   SerializeArchive *sa;
+  ScratchBuffersMarker marker;
   gboolean consumed = FALSE;
   if (qdisk_initialized(self->qdisk) && qdisk_is_space_avail(self->qdisk, 64))
     {
-      serialized = g_string_sized_new(64);
+      serialized = scratch_buffers_alloc_and_mark(&marker);
       sa = serialize_string_archive_new(serialized);
       log_msg_serialize(msg, sa);
       consumed = qdisk_push_tail(self->qdisk, serialized);
       serialize_archive_free(sa);
-      g_string_free(serialized, TRUE);
+      scratch_buffers_reclaim_marked(marker);
     }
   return consumed;
 }
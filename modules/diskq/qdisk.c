@@ -28,14 +28,20 @@
 #include "logmsg/logmsg-serialize.h"
 #include "stats/stats-registry.h"
 #include "reloc.h"
+#include "timeutils.h"
 #include "compat/lfs.h"
 
+#include <iv.h>
+#include <iv_event.h>
+
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <errno.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
 
 /* MADV_RANDOM not defined on legacy Linux systems. Could be removed in the
  * future, when support for Glibc 2.1.X drops.*/
@@ -48,6 +54,9 @@
 
 #define MAX_RECORD_LENGTH 100 * 1024 * 1024
 
+/* size of the read-ahead buffer used by qdisk_pop_head() */
+#define QDISK_READ_AHEAD_SIZE (64 * 1024)
+
 #define PATH_QDISK              PATH_LOCALSTATEDIR
 
 typedef union _QDiskFileHeader
@@ -86,6 +95,23 @@ struct _QDisk
   gint64 file_size;
   QDiskFileHeader *hdr;
   DiskQueueOptions *options;
+
+  /* read-ahead buffer, holding the file contents starting at read_ahead_pos */
+  gchar *read_ahead;
+  gint64 read_ahead_pos;
+  gsize read_ahead_len;
+
+  /* sync-interval() state, protected by sync_lock.  Writes happen in any
+   * thread, data left unsynced by the last one is synced by sync_timer,
+   * which is requested via sync_timer_requested.  Both live in the thread
+   * that first started the queue file, until qdisk_free() */
+  GStaticMutex sync_lock;
+  gint64 last_sync;
+  gboolean unsynced;
+  struct iv_event sync_timer_requested;
+  struct iv_timer sync_timer;
+  gboolean sync_timer_registered;
+  gboolean sync_timer_pending;
 };
 
 static gboolean
@@ -107,6 +133,187 @@ pwrite_strict(gint fd, const void *buf, size_t count, off_t offset)
   return result;
 }
 
+static gboolean
+pwrite_record_strict(gint fd, guint32 *len_prefix, const gchar *buf, size_t count, off_t offset)
+{
+#if SYSLOG_NG_HAVE_PWRITEV
+  struct iovec iov[2] =
+  {
+    { .iov_base = len_prefix, .iov_len = sizeof(*len_prefix) },
+    { .iov_base = (gchar *) buf, .iov_len = count },
+  };
+  ssize_t written = pwritev(fd, iov, 2, offset);
+
+  if (written != count + sizeof(*len_prefix))
+    {
+      if (written != -1)
+        {
+          msg_error("Short written",
+                    evt_tag_int("Number of bytes want to write", count + sizeof(*len_prefix)),
+                    evt_tag_int("Number of bytes written", written));
+          errno = ENOSPC;
+        }
+      return FALSE;
+    }
+  return TRUE;
+#else
+  return pwrite_strict(fd, len_prefix, sizeof(*len_prefix), offset) &&
+         pwrite_strict(fd, buf, count, offset + sizeof(*len_prefix));
+#endif
+}
+
+static void
+_invalidate_read_ahead(QDisk *self)
+{
+  self->read_ahead_len = 0;
+}
+
+/*
+ * Reads @count bytes at @position, served from the read-ahead buffer if
+ * possible. The buffer is only ever filled from the region between the
+ * read head and the write head (or the end of the file if the write head
+ * has wrapped around), as that region is not modified until read.
+ */
+static gssize
+_read_ahead(QDisk *self, gpointer buf, gsize count, gint64 position)
+{
+  gint64 valid_end;
+  gssize res;
+
+  if (position < self->read_ahead_pos ||
+      position + count > self->read_ahead_pos + self->read_ahead_len)
+    {
+      valid_end = self->hdr->write_head > position ? self->hdr->write_head : self->file_size;
+      if (valid_end - position < count || count > QDISK_READ_AHEAD_SIZE)
+        {
+          _invalidate_read_ahead(self);
+          return pread(self->fd, buf, count, position);
+        }
+
+      if (!self->read_ahead)
+        self->read_ahead = g_malloc(QDISK_READ_AHEAD_SIZE);
+
+      res = pread(self->fd, self->read_ahead, MIN(valid_end - position, QDISK_READ_AHEAD_SIZE), position);
+      if (res < 0)
+        {
+          _invalidate_read_ahead(self);
+          return res;
+        }
+      self->read_ahead_pos = position;
+      self->read_ahead_len = res;
+      if (res < count)
+        count = res;
+    }
+
+  memcpy(buf, self->read_ahead + (position - self->read_ahead_pos), count);
+  return count;
+}
+
+static gint64
+_get_monotonic_msec(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (gint64) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* must be called with sync_lock held */
+static void
+_sync(QDisk *self)
+{
+  if (fdatasync(self->fd) < 0)
+    msg_error("Error syncing disk-queue file",
+              evt_tag_errno("error", errno),
+              evt_tag_str("filename", self->filename));
+  self->last_sync = _get_monotonic_msec();
+  self->unsynced = FALSE;
+}
+
+static void
+_sync_if_needed(QDisk *self)
+{
+  if (self->options->sync_interval <= 0)
+    return;
+
+  g_static_mutex_lock(&self->sync_lock);
+  self->unsynced = TRUE;
+  if (_get_monotonic_msec() - self->last_sync >= self->options->sync_interval)
+    {
+      _sync(self);
+    }
+  else if (self->sync_timer_registered && !self->sync_timer_pending)
+    {
+      self->sync_timer_pending = TRUE;
+      iv_event_post(&self->sync_timer_requested);
+    }
+  g_static_mutex_unlock(&self->sync_lock);
+}
+
+static void
+_sync_timer_expired(gpointer s)
+{
+  QDisk *self = (QDisk *) s;
+
+  g_static_mutex_lock(&self->sync_lock);
+  self->sync_timer_pending = FALSE;
+  if (self->unsynced && qdisk_initialized(self))
+    _sync(self);
+  g_static_mutex_unlock(&self->sync_lock);
+}
+
+static void
+_arm_sync_timer(gpointer s)
+{
+  QDisk *self = (QDisk *) s;
+  gint64 remaining_msec = 0;
+
+  if (iv_timer_registered(&self->sync_timer))
+    return;
+
+  g_static_mutex_lock(&self->sync_lock);
+  if (self->options)
+    remaining_msec = self->options->sync_interval - (_get_monotonic_msec() - self->last_sync);
+  g_static_mutex_unlock(&self->sync_lock);
+
+  iv_validate_now();
+  self->sync_timer.expires = iv_now;
+  timespec_add_msec(&self->sync_timer.expires, MAX(remaining_msec, 0));
+  iv_timer_register(&self->sync_timer);
+}
+
+static void
+_register_sync_timer(QDisk *self)
+{
+  if (self->sync_timer_registered || self->options->sync_interval <= 0 || self->options->read_only)
+    return;
+
+  IV_EVENT_INIT(&self->sync_timer_requested);
+  self->sync_timer_requested.cookie = self;
+  self->sync_timer_requested.handler = _arm_sync_timer;
+  iv_event_register(&self->sync_timer_requested);
+
+  IV_TIMER_INIT(&self->sync_timer);
+  self->sync_timer.cookie = self;
+  self->sync_timer.handler = _sync_timer_expired;
+
+  g_static_mutex_lock(&self->sync_lock);
+  self->sync_timer_registered = TRUE;
+  self->sync_timer_pending = FALSE;
+  g_static_mutex_unlock(&self->sync_lock);
+}
+
+static void
+_unregister_sync_timer(QDisk *self)
+{
+  if (!self->sync_timer_registered)
+    return;
+
+  iv_event_unregister(&self->sync_timer_requested);
+  if (iv_timer_registered(&self->sync_timer))
+    iv_timer_unregister(&self->sync_timer);
+  self->sync_timer_registered = FALSE;
+}
 
 static gboolean
 _is_position_eof(QDisk *self, gint64 position)
@@ -236,13 +443,13 @@ qdisk_push_tail(QDisk *self, GString *record)
       return FALSE;
     }
 
-  if (!pwrite_strict(self->fd, (gchar *) &n, sizeof(n), self->hdr->write_head) ||
-      !pwrite_strict(self->fd, record->str, record->len, self->hdr->write_head + sizeof(n)))
+  if (!pwrite_record_strict(self->fd, &n, record->str, record->len, self->hdr->write_head))
     {
       msg_error("Error writing disk-queue file",
                 evt_tag_errno("error", errno));
       return FALSE;
     }
+  _sync_if_needed(self);
 
   self->hdr->write_head = self->hdr->write_head + record->len + sizeof(n);
 
@@ -306,13 +513,13 @@ qdisk_pop_head(QDisk *self, GString *record)
     {
       guint32 n;
       gssize res;
-      res = pread(self->fd, (gchar *) &n, sizeof(n), self->hdr->read_head);
+      res = _read_ahead(self, (gchar *) &n, sizeof(n), self->hdr->read_head);
 
       if (res == 0)
         {
           /* hmm, we are either at EOF or at hdr->qout_ofs, we need to wrap */
           self->hdr->read_head = QDISK_RESERVED_SPACE;
-          res = pread(self->fd, (gchar *) &n, sizeof(n), self->hdr->read_head);
+          res = _read_ahead(self, (gchar *) &n, sizeof(n), self->hdr->read_head);
         }
       if (res != sizeof(n))
         {
@@ -339,7 +546,7 @@ qdisk_pop_head(QDisk *self, GString *record)
         }
 
       g_string_set_size(record, n);
-      res = pread(self->fd, record->str, n, self->hdr->read_head + sizeof(n));
+      res = _read_ahead(self, record->str, n, self->hdr->read_head + sizeof(n));
       if (res != n)
         {
           msg_error("Error reading disk-queue file",
@@ -374,6 +581,7 @@ qdisk_pop_head(QDisk *self, GString *record)
             }
           self->hdr->length = 0;
           _truncate_file(self, self->hdr->write_head);
+          _invalidate_read_ahead(self);
         }
       return TRUE;
 
@@ -845,6 +1053,8 @@ qdisk_start(QDisk *self, const gchar *filename, GQueue *qout, GQueue *qbacklog,
         }
 
     }
+
+  _register_sync_timer(self);
   return TRUE;
 }
 
@@ -869,12 +1079,21 @@ qdisk_init(QDisk *self, DiskQueueOptions *options)
 void
 qdisk_deinit(QDisk *self)
 {
+  /* the sync timer may fire in another thread, it must not see a closed fd */
+  g_static_mutex_lock(&self->sync_lock);
+  if (self->unsynced && self->fd != -1)
+    _sync(self);
+
   if (self->filename)
     {
       g_free(self->filename);
       self->filename = NULL;
     }
 
+  g_free(self->read_ahead);
+  self->read_ahead = NULL;
+  _invalidate_read_ahead(self);
+
   if (self->hdr)
     {
       if (self->options->read_only)
@@ -891,6 +1110,7 @@ qdisk_deinit(QDisk *self)
     }
 
   self->options = NULL;
+  g_static_mutex_unlock(&self->sync_lock);
 }
 
 gssize
@@ -960,6 +1180,7 @@ qdisk_reset_file_if_possible(QDisk *self)
       self->hdr->write_head = QDISK_RESERVED_SPACE;
       self->hdr->backlog_head = QDISK_RESERVED_SPACE;
       _truncate_file (self, QDISK_RESERVED_SPACE);
+      _invalidate_read_ahead(self);
     }
 }
 
@@ -1009,6 +1230,7 @@ void
 qdisk_set_reader_head(QDisk *self, gint64 new_value)
 {
   self->hdr->read_head = new_value;
+  _invalidate_read_ahead(self);
 }
 
 gint64
@@ -1056,6 +1278,8 @@ qdisk_is_read_only(QDisk *self)
 void
 qdisk_free(QDisk *self)
 {
+  _unregister_sync_timer(self);
+  g_static_mutex_free(&self->sync_lock);
   g_free(self);
 }
 
@@ -1063,5 +1287,7 @@ QDisk *
 qdisk_new(void)
 {
   QDisk *self = g_new0(QDisk, 1);
+
+  g_static_mutex_init(&self->sync_lock);
   return self;
 }
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+
+#include "qdisk.h"
+#include "apphook.h"
+#include "timeutils.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <iv.h>
+
+#define NEVER_DUE_INTERVAL 3600000
+
+static gchar *filename;
+static DiskQueueOptions options;
+static QDisk *qdisk;
+static gint num_syncs;
+
+/* overrides the libc one, the tests only count the calls */
+int
+fdatasync(int fd)
+{
+  num_syncs++;
+  return 0;
+}
+
+static void
+_start_qdisk(gint sync_interval)
+{
+  memset(&options, 0, sizeof(options));
+  options.disk_buf_size = MIN_DISK_BUF_SIZE;
+  options.mem_buf_size = 1024;
+  options.reliable = TRUE;
+  options.sync_interval = sync_interval;
+
+  qdisk = qdisk_new();
+  qdisk_init(qdisk, &options);
+  cr_assert(qdisk_start(qdisk, filename, NULL, NULL, NULL));
+}
+
+static void
+_stop_qdisk(void)
+{
+  qdisk_deinit(qdisk);
+  qdisk_free(qdisk);
+}
+
+static void
+_push_record(void)
+{
+  GString *record = g_string_new("record");
+
+  cr_assert(qdisk_push_tail(qdisk, record));
+  g_string_free(record, TRUE);
+}
+
+static void
+_quit(gpointer user_data)
+{
+  iv_quit();
+}
+
+static void
+_run_main_loop(gint msec)
+{
+  struct iv_timer quit_timer;
+
+  IV_TIMER_INIT(&quit_timer);
+  quit_timer.handler = _quit;
+  iv_validate_now();
+  quit_timer.expires = iv_now;
+  timespec_add_msec(&quit_timer.expires, msec);
+  iv_timer_register(&quit_timer);
+
+  iv_main();
+}
+
+Test(qdisk_sync, sub_second_sync_interval_is_honoured)
+{
+  _start_qdisk(50);
+
+  _push_record();
+  cr_assert_eq(num_syncs, 1);
+  _push_record();
+  cr_assert_eq(num_syncs, 1);
+
+  g_usleep(60000);
+  _push_record();
+  cr_assert_eq(num_syncs, 2, "the queue file was not synced once sync-interval() elapsed");
+
+  _stop_qdisk();
+}
+
+Test(qdisk_sync, idle_queue_file_is_synced_after_sync_interval)
+{
+  _start_qdisk(50);
+
+  _push_record();
+  _push_record();
+  cr_assert_eq(num_syncs, 1);
+
+  _run_main_loop(500);
+  cr_assert_eq(num_syncs, 2, "the last write was not synced by the sync timer");
+
+  _stop_qdisk();
+  cr_assert_eq(num_syncs, 2);
+}
+
+Test(qdisk_sync, unsynced_data_is_synced_on_deinit)
+{
+  _start_qdisk(NEVER_DUE_INTERVAL);
+
+  _push_record();
+  _push_record();
+  cr_assert_eq(num_syncs, 1);
+
+  _stop_qdisk();
+  cr_assert_eq(num_syncs, 2);
+}
+
+Test(qdisk_sync, synced_queue_file_is_not_synced_again_on_deinit)
+{
+  _start_qdisk(NEVER_DUE_INTERVAL);
+
+  _push_record();
+  cr_assert_eq(num_syncs, 1);
+
+  _stop_qdisk();
+  cr_assert_eq(num_syncs, 1);
+}
+
+Test(qdisk_sync, queue_file_is_never_synced_without_sync_interval)
+{
+  _start_qdisk(0);
+
+  _push_record();
+  _push_record();
+  _run_main_loop(100);
+
+  _stop_qdisk();
+  cr_assert_eq(num_syncs, 0);
+}
+
+static void
+setup(void)
+{
+  gint fd;
+
+  app_startup();
+  num_syncs = 0;
+
+  fd = g_file_open_tmp("qdisk-syncXXXXXX", &filename, NULL);
+  cr_assert(fd >= 0);
+  close(fd);
+  unlink(filename);
+}
+
+static void
+teardown(void)
+{
+  unlink(filename);
+  g_free(filename);
+  app_shutdown();
+}
+
+TestSuite(qdisk_sync, .init = setup, .fini = teardown);
@@ -47,6 +47,10 @@ static CfgLexerKeyword http_keywords[] =
   { "peer_verify",  KW_PEER_VERIFY },
   { "timeout",      KW_TIMEOUT },
   { "tls",          KW_TLS },
+  { "body_prefix",  KW_BODY_PREFIX },
+  { "body_suffix",  KW_BODY_SUFFIX },
+  { "delimiter",    KW_DELIMITER },
+  { "batch_bytes",  KW_BATCH_BYTES },
   { NULL }
 };
 
@@ -49,6 +49,14 @@ typedef struct
   glong timeout;
   LogTemplate *body_template;
   LogTemplateOptions template_options;
+  gchar *body_prefix;
+  gchar *body_suffix;
+  gchar *delimiter;
+  glong batch_bytes;
+
+  /* the batch being collected by the worker thread */
+  GString *request_body;
+  struct curl_slist *request_headers;
 } HTTPDestinationDriver;
 
 gboolean http_dd_init(LogPipe *s);
@@ -61,6 +69,10 @@ void http_dd_set_method(LogDriver *d, const gchar *method);
 void http_dd_set_user_agent(LogDriver *d, const gchar *user_agent);
 void http_dd_set_headers(LogDriver *d, GList *headers);
 void http_dd_set_body(LogDriver *d, LogTemplate *body);
+void http_dd_set_body_prefix(LogDriver *d, const gchar *body_prefix);
+void http_dd_set_body_suffix(LogDriver *d, const gchar *body_suffix);
+void http_dd_set_delimiter(LogDriver *d, const gchar *delimiter);
+void http_dd_set_batch_bytes(LogDriver *d, glong batch_bytes);
 void http_dd_set_ca_dir(LogDriver *d, const gchar *ca_dir);
 void http_dd_set_ca_file(LogDriver *d, const gchar *ca_file);
 void http_dd_set_cert_file(LogDriver *d, const gchar *cert_file);
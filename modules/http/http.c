@@ -59,6 +59,14 @@ _http_write_cb(char *ptr, size_t size, size_t nmemb, void *userdata)
   return nmemb * size;
 }
 
+static void
+_reset_batch(HTTPDestinationDriver *self)
+{
+  g_string_truncate(self->request_body, 0);
+  curl_slist_free_all(self->request_headers);
+  self->request_headers = NULL;
+}
+
 static void
 _thread_init(LogThrDestDriver *s)
 {
@@ -73,6 +81,9 @@ _thread_init(LogThrDestDriver *s)
 static void
 _thread_deinit(LogThrDestDriver *s)
 {
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) s;
+
+  _reset_batch(self);
 }
 
 static gboolean
@@ -122,19 +133,14 @@ _get_curl_headers(HTTPDestinationDriver *self, LogMessage *msg)
   return curl_headers;
 }
 
-static const gchar *
-_get_body(HTTPDestinationDriver *self, LogMessage *msg)
+static void
+_append_body(HTTPDestinationDriver *self, LogMessage *msg, GString *body)
 {
-  GString *body_rendered = scratch_buffers_alloc();
-
   if (self->body_template)
-    {
-      log_template_format(self->body_template, msg, &self->template_options, LTZ_SEND,
-                          self->super.seq_num, NULL, body_rendered);
-      return body_rendered->str;
-    }
+    log_template_append_format(self->body_template, msg, &self->template_options, LTZ_SEND,
+                               self->super.seq_num, NULL, body);
   else
-    return log_msg_get_value(msg, LM_V_MESSAGE, NULL);
+    g_string_append(body, log_msg_get_value(msg, LM_V_MESSAGE, NULL));
 }
 
 static
@@ -227,9 +233,10 @@ _set_curl_opt(HTTPDestinationDriver *self)
 }
 
 static void
-_set_payload(HTTPDestinationDriver *self, struct curl_slist *curl_headers, const gchar *body)
+_set_payload(HTTPDestinationDriver *self, struct curl_slist *curl_headers, const gchar *body, gsize body_len)
 {
   curl_easy_setopt(self->curl, CURLOPT_HTTPHEADER, curl_headers);
+  curl_easy_setopt(self->curl, CURLOPT_POSTFIELDSIZE, (long) body_len);
   curl_easy_setopt(self->curl, CURLOPT_POSTFIELDS, body);
 }
 
@@ -261,31 +268,92 @@ _map_http_status_to_worker_status(glong http_code)
 }
 
 static worker_insert_result_t
-_insert(LogThrDestDriver *s, LogMessage *msg)
+_send_request(HTTPDestinationDriver *self, struct curl_slist *curl_headers, const gchar *body, gsize body_len)
 {
   CURLcode ret;
-  worker_insert_result_t retval;
-
-  HTTPDestinationDriver *self = (HTTPDestinationDriver *) s;
 
-  struct curl_slist *curl_headers = _get_curl_headers(self, msg);
-  const gchar *body = _get_body(self, msg);
-  _set_payload(self, curl_headers, body);
+  _set_payload(self, curl_headers, body, body_len);
 
   if ((ret = curl_easy_perform(self->curl)) != CURLE_OK)
     {
       msg_error("curl: error sending HTTP request",
                 evt_tag_str("error", curl_easy_strerror(ret)),
-                log_pipe_location_tag(&s->super.super.super));
-
-      curl_slist_free_all(curl_headers);
+                log_pipe_location_tag(&self->super.super.super.super));
 
       return WORKER_INSERT_RESULT_NOT_CONNECTED;
     }
 
   glong http_code = 0;
   curl_easy_getinfo (self->curl, CURLINFO_RESPONSE_CODE, &http_code);
-  retval = _map_http_status_to_worker_status(http_code);
+  return _map_http_status_to_worker_status(http_code);
+}
+
+static gboolean
+_is_batching_enabled(HTTPDestinationDriver *self)
+{
+  return self->super.batch_lines > 0 || self->batch_bytes > 0;
+}
+
+static worker_insert_result_t
+_flush(LogThrDestDriver *s)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) s;
+  worker_insert_result_t retval;
+
+  if (!self->request_headers)
+    return WORKER_INSERT_RESULT_SUCCESS;
+
+  if (self->body_suffix)
+    g_string_append(self->request_body, self->body_suffix);
+
+  retval = _send_request(self, self->request_headers, self->request_body->str, self->request_body->len);
+  _reset_batch(self);
+
+  return retval;
+}
+
+/*
+ * Batches are sent as a single request: body-prefix(), then the rendered
+ * messages separated by delimiter(), then body-suffix().  The X-Syslog-*
+ * headers are taken from the first message of the batch.
+ */
+static worker_insert_result_t
+_insert_batched(HTTPDestinationDriver *self, LogMessage *msg)
+{
+  /* the headers are only set while a batch is being collected, the body
+   * itself may still be empty */
+  if (!self->request_headers)
+    {
+      self->request_headers = _get_curl_headers(self, msg);
+      if (self->body_prefix)
+        g_string_append(self->request_body, self->body_prefix);
+    }
+  else
+    g_string_append(self->request_body, self->delimiter);
+
+  _append_body(self, msg, self->request_body);
+
+  if (self->batch_bytes > 0 && self->request_body->len >= self->batch_bytes)
+    return _flush(&self->super);
+
+  return WORKER_INSERT_RESULT_QUEUED;
+}
+
+static worker_insert_result_t
+_insert(LogThrDestDriver *s, LogMessage *msg)
+{
+  worker_insert_result_t retval;
+
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) s;
+
+  if (_is_batching_enabled(self))
+    return _insert_batched(self, msg);
+
+  struct curl_slist *curl_headers = _get_curl_headers(self, msg);
+  GString *body = scratch_buffers_alloc();
+
+  _append_body(self, msg, body);
+  retval = _send_request(self, curl_headers, body->str, body->len);
 
   curl_slist_free_all(curl_headers);
 
@@ -371,6 +439,41 @@ http_dd_get_template_options(LogDriver *d)
   return &self->template_options;
 }
 
+void
+http_dd_set_body_prefix(LogDriver *d, const gchar *body_prefix)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  g_free(self->body_prefix);
+  self->body_prefix = g_strdup(body_prefix);
+}
+
+void
+http_dd_set_body_suffix(LogDriver *d, const gchar *body_suffix)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  g_free(self->body_suffix);
+  self->body_suffix = g_strdup(body_suffix);
+}
+
+void
+http_dd_set_delimiter(LogDriver *d, const gchar *delimiter)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  g_free(self->delimiter);
+  self->delimiter = g_strdup(delimiter);
+}
+
+void
+http_dd_set_batch_bytes(LogDriver *d, glong batch_bytes)
+{
+  HTTPDestinationDriver *self = (HTTPDestinationDriver *) d;
+
+  self->batch_bytes = batch_bytes;
+}
+
 void
 http_dd_set_ca_dir(LogDriver *d, const gchar *ca_dir)
 {
@@ -544,7 +647,11 @@ http_dd_free(LogPipe *s)
   g_free(self->cert_file);
   g_free(self->key_file);
   g_free(self->ciphers);
+  g_free(self->body_prefix);
+  g_free(self->body_suffix);
+  g_free(self->delimiter);
   g_list_free_full(self->headers, g_free);
+  g_string_free(self->request_body, TRUE);
 
   log_threaded_dest_driver_free(s);
 }
@@ -564,6 +671,7 @@ http_dd_new(GlobalConfig *cfg)
   self->super.worker.connect = _connect;
   self->super.worker.disconnect = _disconnect;
   self->super.worker.insert = _insert;
+  self->super.worker.flush = _flush;
   self->super.super.super.super.generate_persist_name = _format_persist_name;
   self->super.format.stats_instance = _format_stats_instance;
   self->super.stats_source = SCS_HTTP;
@@ -573,6 +681,8 @@ http_dd_new(GlobalConfig *cfg)
 
   self->ssl_version = CURL_SSLVERSION_DEFAULT;
   self->peer_verify = TRUE;
+  self->delimiter = g_strdup("\n");
+  self->request_body = g_string_sized_new(32768);
 
   return &self->super.super.super;
 }
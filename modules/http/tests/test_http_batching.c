@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2018 Balabit
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include <criterion/criterion.h>
+#include <curl/curl.h>
+
+#include "http-plugin.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "logmsg/logmsg.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/*
+ * A minimal HTTP server that answers a fixed number of requests with "200
+ * OK" and records the request bodies, so that the batches can be checked
+ * exactly as they are sent by libcurl.
+ */
+typedef struct _TestServer
+{
+  gint listen_fd;
+  gint port;
+  gint num_requests;
+  GPtrArray *bodies;
+  GThread *thread;
+} TestServer;
+
+static TestServer server;
+static GlobalConfig *cfg;
+static HTTPDestinationDriver *driver;
+
+static gchar *
+_read_request_body(gint fd)
+{
+  GString *request = g_string_new("");
+  gchar buf[4096];
+  gchar *headers_end = NULL;
+  gchar *content_length;
+  gsize body_len = 0;
+  gssize rc;
+
+  while (!headers_end || request->len < (headers_end - request->str) + 4 + body_len)
+    {
+      rc = read(fd, buf, sizeof(buf));
+      if (rc <= 0)
+        break;
+      g_string_append_len(request, buf, rc);
+
+      if (!headers_end && (headers_end = strstr(request->str, "\r\n\r\n")))
+        {
+          content_length = strstr(request->str, "Content-Length:");
+          if (content_length && content_length < headers_end)
+            body_len = strtoul(content_length + strlen("Content-Length:"), NULL, 10);
+        }
+    }
+
+  cr_assert_not_null(headers_end, "incomplete HTTP request received: %s", request->str);
+  gchar *body = g_strndup(headers_end + 4, body_len);
+  g_string_free(request, TRUE);
+  return body;
+}
+
+static gpointer
+_server_thread(gpointer user_data)
+{
+  const gchar *response = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+  gint i;
+
+  for (i = 0; i < server.num_requests; i++)
+    {
+      gint fd = accept(server.listen_fd, NULL, NULL);
+
+      cr_assert(fd >= 0);
+      g_ptr_array_add(server.bodies, _read_request_body(fd));
+      cr_assert(write(fd, response, strlen(response)) == strlen(response));
+      close(fd);
+    }
+  return NULL;
+}
+
+static void
+_start_server(gint num_requests)
+{
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof(addr);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  server.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  cr_assert(server.listen_fd >= 0);
+  cr_assert(bind(server.listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+  cr_assert(listen(server.listen_fd, 4) == 0);
+  cr_assert(getsockname(server.listen_fd, (struct sockaddr *) &addr, &addrlen) == 0);
+
+  server.port = ntohs(addr.sin_port);
+  server.num_requests = num_requests;
+  server.bodies = g_ptr_array_new_with_free_func(g_free);
+  server.thread = g_thread_create(_server_thread, NULL, TRUE, NULL);
+}
+
+static void
+_stop_server(void)
+{
+  g_thread_join(server.thread);
+  close(server.listen_fd);
+}
+
+static void
+_assert_request_body(gint index, const gchar *expected)
+{
+  cr_assert(index < server.bodies->len, "request %d was not received", index);
+  cr_assert_str_eq((gchar *) g_ptr_array_index(server.bodies, index), expected);
+}
+
+static void
+_create_driver(const gchar *prefix, const gchar *delimiter, const gchar *suffix)
+{
+  gchar *url = g_strdup_printf("http://127.0.0.1:%d/", server.port);
+
+  driver = (HTTPDestinationDriver *) http_dd_new(cfg);
+  http_dd_set_url(&driver->super.super.super, url);
+  if (prefix)
+    http_dd_set_body_prefix(&driver->super.super.super, prefix);
+  if (delimiter)
+    http_dd_set_delimiter(&driver->super.super.super, delimiter);
+  if (suffix)
+    http_dd_set_body_suffix(&driver->super.super.super, suffix);
+  log_threaded_dest_driver_set_batch_lines(&driver->super.super.super, 100);
+
+  /* the worker callbacks are driven directly, without starting the thread */
+  driver->curl = curl_easy_init();
+  curl_easy_setopt(driver->curl, CURLOPT_URL, url);
+  g_free(url);
+}
+
+static worker_insert_result_t
+_insert(const gchar *message)
+{
+  LogMessage *msg = log_msg_new_empty();
+  worker_insert_result_t result;
+
+  log_msg_set_value(msg, LM_V_MESSAGE, message, -1);
+  result = driver->super.worker.insert(&driver->super, msg);
+  log_msg_unref(msg);
+  return result;
+}
+
+static worker_insert_result_t
+_flush(void)
+{
+  return driver->super.worker.flush(&driver->super);
+}
+
+Test(http_batching, messages_are_wrapped_into_prefix_delimiter_and_suffix)
+{
+  _start_server(1);
+  _create_driver("[", ",", "]");
+
+  cr_assert_eq(_insert("{\"a\":1}"), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_insert("{\"b\":2}"), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_insert("{\"c\":3}"), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_flush(), WORKER_INSERT_RESULT_SUCCESS);
+
+  _stop_server();
+  _assert_request_body(0, "[{\"a\":1},{\"b\":2},{\"c\":3}]");
+}
+
+Test(http_batching, default_delimiter_is_newline_without_prefix_and_suffix)
+{
+  _start_server(1);
+  _create_driver(NULL, NULL, NULL);
+
+  cr_assert_eq(_insert("first"), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_insert("second"), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_flush(), WORKER_INSERT_RESULT_SUCCESS);
+
+  _stop_server();
+  _assert_request_body(0, "first\nsecond");
+}
+
+Test(http_batching, each_batch_starts_with_a_new_prefix)
+{
+  _start_server(2);
+  _create_driver("[", ",", "]");
+
+  cr_assert_eq(_insert("1"), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_flush(), WORKER_INSERT_RESULT_SUCCESS);
+  cr_assert_eq(_insert("2"), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_insert("3"), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_flush(), WORKER_INSERT_RESULT_SUCCESS);
+
+  _stop_server();
+  _assert_request_body(0, "[1]");
+  _assert_request_body(1, "[2,3]");
+}
+
+Test(http_batching, batch_of_empty_messages_is_still_sent)
+{
+  _start_server(1);
+  _create_driver("[", ",", "]");
+
+  cr_assert_eq(_insert(""), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_insert(""), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_flush(), WORKER_INSERT_RESULT_SUCCESS);
+
+  _stop_server();
+  _assert_request_body(0, "[,]");
+}
+
+Test(http_batching, flush_without_messages_sends_nothing)
+{
+  _start_server(0);
+  _create_driver("[", ",", "]");
+
+  cr_assert_eq(_flush(), WORKER_INSERT_RESULT_SUCCESS);
+
+  _stop_server();
+  cr_assert_eq(server.bodies->len, 0);
+}
+
+Test(http_batching, batch_bytes_closes_the_batch_on_insert)
+{
+  _start_server(2);
+  _create_driver("[", ",", "]");
+  http_dd_set_batch_bytes(&driver->super.super.super, 8);
+
+  cr_assert_eq(_insert("aaa"), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_insert("bbb"), WORKER_INSERT_RESULT_SUCCESS);
+  cr_assert_eq(_insert("ccc"), WORKER_INSERT_RESULT_QUEUED);
+  cr_assert_eq(_flush(), WORKER_INSERT_RESULT_SUCCESS);
+
+  _stop_server();
+  _assert_request_body(0, "[aaa,bbb]");
+  _assert_request_body(1, "[ccc]");
+}
+
+static void
+setup(void)
+{
+  app_startup();
+  cfg = cfg_new_snippet();
+}
+
+static void
+teardown(void)
+{
+  log_pipe_unref(&driver->super.super.super.super);
+  g_ptr_array_free(server.bodies, TRUE);
+  cfg_free(cfg);
+  app_shutdown();
+}
+
+TestSuite(http_batching, .init = setup, .fini = teardown);
@@ -53,6 +53,8 @@ typedef struct
   GString *param2_str;
 
   redisContext *c;
+  /* commands appended to the context whose replies were not read yet */
+  gint pipelined_commands;
 } RedisDriver;
 
 /*
@@ -226,6 +228,7 @@ redis_dd_disconnect(LogThrDestDriver *s)
   if (self->c)
     redisFree(self->c);
   self->c = NULL;
+  self->pipelined_commands = 0;
 }
 
 /*
@@ -233,14 +236,8 @@ redis_dd_disconnect(LogThrDestDriver *s)
  */
 
 static worker_insert_result_t
-redis_worker_insert(LogThrDestDriver *s, LogMessage *msg)
+redis_worker_check_connection(RedisDriver *self)
 {
-  RedisDriver *self = (RedisDriver *)s;
-  redisReply *reply;
-  const char *argv[5];
-  size_t argvlen[5];
-  int argc = 2;
-
   if (!redis_dd_connect(self, TRUE))
     return WORKER_INSERT_RESULT_NOT_CONNECTED;
 
@@ -253,6 +250,14 @@ redis_worker_insert(LogThrDestDriver *s, LogMessage *msg)
       return WORKER_INSERT_RESULT_NOT_CONNECTED;
     }
 
+  return WORKER_INSERT_RESULT_SUCCESS;
+}
+
+static int
+redis_worker_format_command(RedisDriver *self, LogMessage *msg, const char **argv, size_t *argvlen)
+{
+  int argc = 2;
+
   log_template_format(self->key, msg, &self->template_options, LTZ_SEND,
                       self->super.seq_num, NULL, self->key_str);
 
@@ -282,6 +287,67 @@ redis_worker_insert(LogThrDestDriver *s, LogMessage *msg)
       argc++;
     }
 
+  return argc;
+}
+
+/*
+ * With batch-lines() set, commands are only appended to the output buffer
+ * of the context, the replies are collected by redis_worker_flush() for
+ * the whole batch.
+ */
+static worker_insert_result_t
+redis_worker_insert_pipelined(RedisDriver *self, LogMessage *msg)
+{
+  worker_insert_result_t result;
+  const char *argv[5];
+  size_t argvlen[5];
+  int argc;
+
+  if (self->pipelined_commands == 0)
+    {
+      result = redis_worker_check_connection(self);
+      if (result != WORKER_INSERT_RESULT_SUCCESS)
+        return result;
+    }
+
+  argc = redis_worker_format_command(self, msg, argv, argvlen);
+
+  if (redisAppendCommandArgv(self->c, argc, argv, argvlen) != REDIS_OK)
+    {
+      msg_error("REDIS error appending command to the pipeline, suspending",
+                evt_tag_str("driver", self->super.super.super.id),
+                evt_tag_str("command", self->command->str),
+                evt_tag_str("error", self->c->errstr),
+                evt_tag_int("time_reopen", self->super.time_reopen));
+
+      /* the commands already appended must not be sent with the next batch */
+      redis_dd_disconnect(&self->super);
+      return WORKER_INSERT_RESULT_ERROR;
+    }
+
+  self->pipelined_commands++;
+  return WORKER_INSERT_RESULT_QUEUED;
+}
+
+static worker_insert_result_t
+redis_worker_insert(LogThrDestDriver *s, LogMessage *msg)
+{
+  RedisDriver *self = (RedisDriver *)s;
+  worker_insert_result_t result;
+  redisReply *reply;
+  const char *argv[5];
+  size_t argvlen[5];
+  int argc;
+
+  if (s->batch_lines > 0)
+    return redis_worker_insert_pipelined(self, msg);
+
+  result = redis_worker_check_connection(self);
+  if (result != WORKER_INSERT_RESULT_SUCCESS)
+    return result;
+
+  argc = redis_worker_format_command(self, msg, argv, argvlen);
+
   reply = redisCommandArgv(self->c, argc, argv, argvlen);
 
   if (!reply)
@@ -308,6 +374,46 @@ redis_worker_insert(LogThrDestDriver *s, LogMessage *msg)
   return WORKER_INSERT_RESULT_SUCCESS;
 }
 
+/*
+ * Replies arrive in the order of the commands, so when the connection
+ * breaks, the messages whose reply was received are acknowledged and only
+ * the rest of the batch is rewound.
+ */
+static worker_insert_result_t
+redis_worker_flush(LogThrDestDriver *s)
+{
+  RedisDriver *self = (RedisDriver *)s;
+  redisReply *reply;
+  gint i;
+
+  for (i = 0; i < self->pipelined_commands; i++)
+    {
+      if (redisGetReply(self->c, (void **) &reply) != REDIS_OK)
+        {
+          msg_error("REDIS server error while reading pipelined replies, suspending",
+                    evt_tag_str("driver", self->super.super.super.id),
+                    evt_tag_str("command", self->command->str),
+                    evt_tag_int("replies_received", i),
+                    evt_tag_int("commands_pipelined", self->pipelined_commands),
+                    evt_tag_str("error", self->c->errstr),
+                    evt_tag_int("time_reopen", self->super.time_reopen));
+
+          log_threaded_dest_driver_accept_batch_head(s, i);
+          redis_dd_disconnect(s);
+          return WORKER_INSERT_RESULT_ERROR;
+        }
+      freeReplyObject(reply);
+    }
+
+  msg_debug("REDIS pipelined commands sent",
+            evt_tag_str("driver", self->super.super.super.id),
+            evt_tag_str("command", self->command->str),
+            evt_tag_int("commands", self->pipelined_commands));
+  self->pipelined_commands = 0;
+
+  return WORKER_INSERT_RESULT_SUCCESS;
+}
+
 static void
 redis_worker_thread_init(LogThrDestDriver *d)
 {
@@ -400,6 +506,7 @@ redis_dd_new(GlobalConfig *cfg)
   self->super.worker.thread_deinit = redis_worker_thread_deinit;
   self->super.worker.disconnect = redis_dd_disconnect;
   self->super.worker.insert = redis_worker_insert;
+  self->super.worker.flush = redis_worker_flush;
 
   self->super.format.stats_instance = redis_dd_format_stats_instance;
   self->super.stats_source = SCS_REDIS;
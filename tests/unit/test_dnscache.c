@@ -238,3 +238,64 @@ Test(dnscache, test_lru_lists)
   _fill_dns_cache(cache, cache_size);
   dns_cache_free(cache);
 }
+
+static gpointer
+_lookup_in_a_different_thread(gpointer user_data)
+{
+  guint32 ni = htonl(GPOINTER_TO_UINT(user_data));
+  const gchar *hn = NULL;
+  gsize hn_len;
+  gboolean positive = FALSE;
+  gboolean found;
+
+  dns_caching_thread_init();
+  found = dns_caching_lookup(AF_INET, (void *) &ni, &hn, &hn_len, &positive);
+  if (found)
+    found = strcmp(hn, positive_hostname) == 0 && positive;
+  dns_caching_thread_deinit();
+  return GUINT_TO_POINTER(found);
+}
+
+Test(dnscache, test_entries_are_shared_between_threads)
+{
+  guint32 ni = htonl(1);
+  GThread *thread;
+
+  dns_caching_store(AF_INET, (void *) &ni, positive_hostname, TRUE);
+
+  thread = g_thread_create(_lookup_in_a_different_thread, GUINT_TO_POINTER(1), TRUE, NULL);
+  cr_assert(GPOINTER_TO_UINT(g_thread_join(thread)), "entry stored by another thread was not found");
+
+  thread = g_thread_create(_lookup_in_a_different_thread, GUINT_TO_POINTER(2), TRUE, NULL);
+  cr_assert_not(GPOINTER_TO_UINT(g_thread_join(thread)), "an entry was found that was never stored");
+}
+
+static gboolean
+_is_found_by_a_different_thread(guint32 addr)
+{
+  GThread *thread = g_thread_create(_lookup_in_a_different_thread, GUINT_TO_POINTER(addr), TRUE, NULL);
+
+  return GPOINTER_TO_UINT(g_thread_join(thread));
+}
+
+Test(dnscache, test_shared_cache_is_shrunk_when_cache_size_is_reduced)
+{
+  DNSCacheOptions options;
+  gint i;
+
+  for (i = 100; i < 110; i++)
+    {
+      guint32 ni = htonl(i);
+      dns_caching_store(AF_INET, (void *) &ni, positive_hostname, TRUE);
+    }
+
+  dns_cache_options_defaults(&options);
+  options.cache_size = 2;
+  dns_caching_update_options(&options);
+  dns_cache_options_destroy(&options);
+
+  cr_assert_not(_is_found_by_a_different_thread(100), "the oldest entry was kept after reducing dns-cache-size()");
+  cr_assert_not(_is_found_by_a_different_thread(107), "the shared cache is larger than dns-cache-size()");
+  cr_assert(_is_found_by_a_different_thread(108));
+  cr_assert(_is_found_by_a_different_thread(109));
+}